@@ -1,35 +1,26 @@
 #include <assert.h>
 #include <math.h>
+#include <pthread.h>
+#include <stddef.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 //#define DEBUG
 #include "board.h"
+#include "board_kernel.h"
 #include "debug.h"
 #include "fbook.h"
 #include "mq.h"
-#include "random.h"
 #include "ownermap.h"
-#include "dcnn.h"
 
 #ifdef BOARD_PAT3
 #include "pattern3.h"
 #endif
 
-#if 0
-#define profiling_noinline __attribute__((noinline))
-#else
-#define profiling_noinline
-#endif
-
 #define gi_granularity 4
 #define gi_allocsize(gids) ((1 << gi_granularity) + ((gids) >> gi_granularity) * (1 << gi_granularity))
 
-static int  board_play_f(board_t *board, move_t *m, int f);
-static void board_addf(board_t *b, coord_t c);
-static void board_rmf(board_t *b, int f);
-
 
 static void
 board_setup(board_t *b)
@@ -79,11 +70,149 @@ board_copy(board_t *b2, board_t *b1)
 	b2->ps = NULL;
 }
 
+/* Copy a coord-indexed goban map, live region only. */
+#define copy_map(b2, b1, map, n)  memcpy((b2)->map, (b1)->map, (n) * sizeof((b1)->map[0]))
+
+/* Like board_copy() but goban maps are only copied for the live region
+ * (board_max_coords() points), group table for board_max_groups() ids,
+ * lists only up to their length.
+ * Much less to copy on small boards. Contents of @b2 outside the live
+ * region are undefined so this is not suitable for board_cmp(). */
+void
+board_copy_live(board_t *b2, board_t *b1)
+{
+	int max = board_max_coords(b1);
+	memcpy(b2, b1, offsetof(board_t, b));
+	copy_map(b2, b1, b, max);
+	copy_map(b2, b1, n, max);
+	copy_map(b2, b1, g, max);
+	copy_map(b2, b1, p, max);
+	copy_map(b2, b1, gi, board_max_groups(b1));
+	copy_map(b2, b1, gfree, b1->gfree_n);
+	b2->gfree_n = b1->gfree_n;
+#ifdef BOARD_PAT3
+	copy_map(b2, b1, pat3, max);
+#endif
+	copy_map(b2, b1, f, b1->flen);
+	b2->flen = b1->flen;
+	copy_map(b2, b1, fmap, max);
+#ifdef WANT_BOARD_C
+	copy_map(b2, b1, c, b1->clen);
+	b2->clen = b1->clen;
+#endif
+	memcpy(&b2->playout_board, &b1->playout_board,
+	       sizeof(board_t) - offsetof(board_t, playout_board));
+
+	// XXX: Special semantics.
+	b2->fbook = NULL;
+	b2->ps = NULL;
+}
+
+/* Per-thread free lists of playout state blocks, one per size class
+ * (powers of two from BOARD_PS_MIN), so each policy recycles blocks of
+ * its own size. Only a few boards are alive at a time in each thread,
+ * cap each list anyway. */
+#define BOARD_PS_CACHE    16
+#define BOARD_PS_MIN      64
+#define BOARD_PS_CLASSES  16   /* Up to 2Mb */
+
+#ifndef NO_THREAD_LOCAL
+
+/* Block header, state follows. */
+typedef struct board_ps_block {
+	struct board_ps_block *next;   /* Free list */
+	int cls;
+} __attribute__((aligned(16))) board_ps_block_t;
+
+typedef struct {
+	board_ps_block_t *head[BOARD_PS_CLASSES];
+	int n[BOARD_PS_CLASSES];
+	bool registered;
+} board_ps_cache_t;
+
+static __thread board_ps_cache_t ps_cache;
+static pthread_key_t ps_cache_key;
+static pthread_once_t ps_cache_once = PTHREAD_ONCE_INIT;
+
+/* Thread exit: free cached blocks. */
+static void
+board_ps_cache_done(void *data)
+{
+	board_ps_cache_t *cache = (board_ps_cache_t*)data;
+	for (int cls = 0; cls < BOARD_PS_CLASSES; cls++) {
+		while (cache->head[cls]) {
+			board_ps_block_t *block = cache->head[cls];
+			cache->head[cls] = block->next;
+			free(block);
+		}
+		cache->n[cls] = 0;
+	}
+}
+
+static void
+board_ps_cache_key_init(void)
+{
+	pthread_key_create(&ps_cache_key, board_ps_cache_done);
+}
+
+void *
+board_ps_alloc(size_t size)
+{
+	int cls = 0;
+	while ((size_t)(BOARD_PS_MIN << cls) < size)  cls++;
+	assert(cls < BOARD_PS_CLASSES);
+
+	board_ps_block_t *block = ps_cache.head[cls];
+	if (block) {
+		ps_cache.head[cls] = block->next;
+		ps_cache.n[cls]--;
+	} else {
+		block = (board_ps_block_t*)cmalloc(sizeof(*block) + (BOARD_PS_MIN << cls));
+		block->cls = cls;
+	}
+	return block + 1;
+}
+
+static void
+board_ps_free(void *ps)
+{
+	board_ps_block_t *block = (board_ps_block_t*)ps - 1;
+	int cls = block->cls;
+	if (ps_cache.n[cls] >= BOARD_PS_CACHE) {
+		free(block);
+		return;
+	}
+	if (unlikely(!ps_cache.registered)) {
+		pthread_once(&ps_cache_once, board_ps_cache_key_init);
+		pthread_setspecific(ps_cache_key, &ps_cache);
+		ps_cache.registered = true;
+	}
+	block->next = ps_cache.head[cls];
+	ps_cache.head[cls] = block;
+	ps_cache.n[cls]++;
+}
+
+#else  /* NO_THREAD_LOCAL: no cache */
+
+void *
+board_ps_alloc(size_t size)
+{
+	return cmalloc(size);
+}
+
+static void
+board_ps_free(void *ps)
+{
+	free(ps);
+}
+
+#endif
+
 void
 board_done(board_t *board)
 {
 	if (board->fbook) fbook_done(board->fbook);
-	if (board->ps) free(board->ps);
+	if (board->ps) board_ps_free(board->ps);
 }
 
 void
@@ -111,6 +240,7 @@ board_statics_init(board_t *board)
 	bs->rsize = size;
 	bs->stride = stride;
 	bs->max_coords = stride * stride;
+	bs->max_groups = size * size * 4 / 5 + 2;
 
 	bs->bits2 = 1;
 	while ((1 << bs->bits2) < bs->max_coords)  bs->bits2++;
@@ -130,12 +260,23 @@ board_statics_init(board_t *board)
 	bs->dnei[2] = stride*2 - 2;
 	bs->dnei[3] = 2;
 
+#ifdef BOARD_KERNELS
+	bs->kernel = board_kernel_index(size);
+#endif
+
 	/* Set up coordinate cache */
 	foreach_point(board) {
 		bs->coord[c][0] = c % stride;
 		bs->coord[c][1] = c / stride;
 	} foreach_point_end;
 
+	/* On-board points bitboard */
+	foreach_point(board) {
+		int x = c % stride, y = c / stride;
+		if (x >= 1 && x <= size && y >= 1 && y <= size)
+			bitboard_set(&bs->onboard, c);
+	} foreach_point_end;
+
 	/* Initialize zobrist hashtable. */
 	/* We will need these to be stable across Pachi runs for certain kinds
 	 * of pattern matching, thus we do not use fast_random() for this. */
@@ -209,11 +350,17 @@ board_init_data(board_t *board)
 
 	/* All positions are free! Except the margin. */
 	foreach_point(board) {
-		if (board_at(board, c) == S_NONE)
-			board_addf(board, c);
+		if (board_at(board, c) == S_NONE) {
+			board->fmap[c] = board->flen;
+			board->f[board->flen++] = c;
+		}
 	} foreach_point_end;
 	assert(board->flen == size * size);
 
+	/* All group ids are free, lowest ones get used first. */
+	for (group_t g = board_max_groups(board) - 1; g > 0; g--)
+		board->gfree[board->gfree_n++] = g;
+
 #ifdef BOARD_PAT3
 	/* Initialize 3x3 pattern codes. */
 	foreach_point(board) {
@@ -365,7 +512,7 @@ board_hprint(board_t *board, FILE *f, board_print_handler handler, void *data)
 static void
 cprint_group(board_t *board, coord_t c, strbuf_t *buf, void *data)
 {
-	sbprintf(buf, "%d ", group_base(group_at(board, c)));
+	sbprintf(buf, "%d ", group_base(board, group_at(board, c)));
 }
 
 void
@@ -544,41 +691,6 @@ board_permit(board_t *b, move_t *m, void *data)
 	return true;
 }
 
-static inline bool
-board_try_random_move(board_t *b, enum stone color, coord_t *coord, int f, ppr_permit permit, void *permit_data)
-{
-	*coord = b->f[f];
-	move_t m = { *coord, color };
-	if (DEBUGL(6))
-		fprintf(stderr, "trying random move %d: %d,%d %s %d\n", f, coord_x(*coord), coord_y(*coord), coord2sstr(*coord), board_is_valid_move(b, &m));
-	permit = (permit ? permit : board_permit);
-	if (!permit(b, &m, permit_data))
-		return false;
-	if (m.coord == *coord)
-		return likely(board_play_f(b, &m, f) >= 0);
-	*coord = m.coord; // permit modified the coordinate
-	return likely(board_play(b, &m) >= 0);
-}
-
-void
-board_play_random(board_t *b, enum stone color, coord_t *coord, ppr_permit permit, void *permit_data)
-{
-	if (likely(b->flen)) {
-		int base = fast_random(b->flen), f;
-		for (f = base; f < b->flen; f++)
-			if (board_try_random_move(b, color, coord, f, permit, permit_data))
-				return;
-		for (f = 0; f < base; f++)
-			if (board_try_random_move(b, color, coord, f, permit, permit_data))
-				return;
-	}
-
-	*coord = pass;
-	move_t m = { pass, color };
-	board_play(b, &m);
-}
-
-
 /********************************************************************************************************/
 
 /* XXX: We attempt false eye detection but we will yield false
@@ -614,18 +726,35 @@ board_eye_color(board_t *b, coord_t c)
 	return S_NONE;
 }
 
+void
+board_eye_bits(board_t *b, bitboard_t eyes[S_MAX])
+{
+	bitboard_t *onboard = &board_statics.onboard;
+	bitboard_t empty, walls;
+	bitboard_andnot(&empty, onboard, board_stone_bits(b, S_BLACK));
+	bitboard_andnot(&empty, &empty, board_stone_bits(b, S_WHITE));
+
+	for (enum stone color = S_BLACK; color <= S_WHITE; color++) {
+		bitboard_ornot(&walls, board_stone_bits(b, color), onboard);
+		bitboard_surrounded(&eyes[color], &walls, board_stride(b));
+		bitboard_and(&eyes[color], &eyes[color], &empty);
+	}
+}
+
 floating_t
 board_fast_score(board_t *board)
 {
 	int scores[S_MAX] = { 0, };
 	
-	foreach_point(board) {
-		enum stone color = board_at(board, c);
-		if (color == S_NONE && board->rules != RULES_STONES_ONLY)
-			color = board_eye_color(board, c);
-		scores[color]++;
-		// fprintf(stderr, "%d, %d ++%d = %d\n", coord_x(c), coord_y(c), color, scores[color]);
-	} foreach_point_end;
+	for (enum stone color = S_BLACK; color <= S_WHITE; color++)
+		scores[color] = bitboard_popcount(board_stone_bits(board, color));
+
+	if (board->rules != RULES_STONES_ONLY) {
+		bitboard_t eyes[S_MAX];
+		board_eye_bits(board, eyes);
+		for (enum stone color = S_BLACK; color <= S_WHITE; color++)
+			scores[color] += bitboard_popcount(&eyes[color]);
+	}
 
 	return board_score(board, scores);
 }
@@ -837,187 +966,3 @@ rules2str(enum rules rules)
 	}
 	return NULL;
 }
-
-
-/********************************************************************************************************/
-/* board_play() implementation */
-
-static inline void
-board_addf(board_t *b, coord_t c)
-{
-	b->fmap[c] = b->flen; 
-	b->f[b->flen++] = c;
-}
-
-static inline void
-board_rmf(board_t *b, int f)
-{
-	/* Not bothering to delete fmap records,
-	 * Just keep the valid ones up to date. */
-	coord_t c = b->f[f] = b->f[--b->flen];
-	b->fmap[c] = f;
-}
-
-static void
-board_commit_move(board_t *b, move_t *m)
-{
-	if (!playout_board(b)) {
-#ifdef DCNN_DARKFOREST
-		if (darkforest_dcnn && !is_pass(m->coord))
-			b->moveno[m->coord] = b->moves;
-#endif
-	}
-
-	b->last_move_i = last_move_nexti(b);
-	last_move(b) = *m;
-
-	b->moves++;
-}
-
-/* Update board hash with given coordinate. */
-static void profiling_noinline
-board_hash_update(board_t *board, coord_t coord, enum stone color)
-{
-	if (!playout_board(board)) {
-		board->hash ^= hash_at(coord, color);
-		if (DEBUGL(8))
-			fprintf(stderr, "board_hash_update(%d,%d,%d) ^ %" PRIhash " -> %" PRIhash "\n", color, coord_x(coord), coord_y(coord), hash_at(coord, color), board->hash);
-	}
-
-#if defined(BOARD_PAT3)
-	/* @color is not what we need in case of capture. */
-	static const int ataribits[8] = { -1, 0, -1, 1, 2, -1, 3, -1 };
-	enum stone new_color = board_at(board, coord);
-	bool in_atari = false;
-	if (new_color == S_NONE)
-		board->pat3[coord] = pattern3_hash(board, coord);
-	else
-		in_atari = (board_group_info(board, group_at(board, coord)).libs == 1);
-	foreach_8neighbor(board, coord) {
-		/* Internally, the loop uses fn__i=[0..7]. We can use
-		 * it directly to address bits within the bitmap of the
-		 * neighbors since the bitmap order is reverse to the
-		 * loop order. */
-		if (board_at(board, c) != S_NONE)
-			continue;
-		board->pat3[c] &= ~(3 << (fn__i*2));
-		board->pat3[c] |= new_color << (fn__i*2);
-		if (ataribits[fn__i] >= 0) {
-			board->pat3[c] &= ~(1 << (16 + ataribits[fn__i]));
-			board->pat3[c] |= in_atari << (16 + ataribits[fn__i]);
-		}
-	} foreach_8neighbor_end;
-#endif
-}
-
-/* Commit current board hash to history. */
-static void profiling_noinline
-board_hash_commit(board_t *b)
-{
-	if (playout_board(b))  return;
-
-	if (DEBUGL(8)) fprintf(stderr, "board_hash_commit %" PRIhash "\n", b->hash);
-
-	for (int i = 0; i < BOARD_HASH_HISTORY; i++) {
-		if (b->hash_history[i] == b->hash) {
-			if (DEBUGL(5))  fprintf(stderr, "SUPERKO VIOLATION noted at %s\n", coord2sstr(last_move(b).coord));
-			b->superko_violation = true;
-			return;
-		}
-	}
-
-	int i = b->hash_history_next;
-	b->hash_history[i] = b->hash;
-	b->hash_history_next = (i+1) % BOARD_HASH_HISTORY;
-}
-
-static inline void
-board_pat3_reset(board_t *b, coord_t c)
-{
-#ifdef BOARD_PAT3
-	b->pat3[c] = pattern3_hash(b, c);
-#endif
-}
-
-static inline void
-board_pat3_fix(board_t *b, group_t group_from, group_t group_to)
-{
-#ifdef BOARD_PAT3
-	group_info_t *gi_from = &board_group_info(b, group_from);
-	group_info_t *gi_to = &board_group_info(b, group_to);
-	
-	if (gi_to->libs == 1) {
-		coord_t lib = board_group_info(b, group_to).lib[0];
-		if (gi_from->libs == 1) {
-			/* We removed group_from from capturable groups,
-			 * therefore switching the atari flag off.
-			 * We need to set it again since group_to is also
-			 * capturable. */
-			int fn__i = 0;
-			foreach_neighbor(b, lib, {
-				b->pat3[lib] |= (group_at(b, c) == group_from) << (16 + 3 - fn__i);
-				fn__i++;
-			});
-		}
-	}
-#endif /* BOARD_PAT3 */
-}
-
-static void
-board_capturable_add(board_t *board, group_t group, coord_t lib)
-{
-	//fprintf(stderr, "group %s cap %s\n", coord2sstr(group), coord2sstr(lib));
-
-#ifdef BOARD_PAT3
-	int fn__i = 0;
-	foreach_neighbor(board, lib, {
-		board->pat3[lib] |= (group_at(board, c) == group) << (16 + 3 - fn__i);
-		fn__i++;
-	});
-#endif
-
-#ifdef WANT_BOARD_C
-	/* Update the list of capturable groups. */
-	assert(group);
-	assert(board->clen < BOARD_MAX_GROUPS);
-	board->c[board->clen++] = group;
-#endif
-}
-
-static void
-board_capturable_rm(board_t *board, group_t group, coord_t lib)
-{
-	//fprintf(stderr, "group %s nocap %s\n", coord2sstr(group), coord2sstr(lib));
-#ifdef BOARD_PAT3
-	int fn__i = 0;
-	foreach_neighbor(board, lib, {
-		board->pat3[lib] &= ~((group_at(board, c) == group) << (16 + 3 - fn__i));
-		fn__i++;
-	});
-#endif
-
-#ifdef WANT_BOARD_C
-	/* Update the list of capturable groups. */
-	for (int i = 0; i < board->clen; i++)
-		if (unlikely(board->c[i] == group)) {
-			board->c[i] = board->c[--board->clen];
-			return;
-		}
-	fprintf(stderr, "rm of bad group %s\n", coord2sstr(group_base(group)));
-	assert(0);
-#endif
-}
-
-
-#define FULL_BOARD
-#include "board_play.h"
-
-int
-board_play(board_t *b, move_t *m)
-{
-#ifdef BOARD_UNDO_CHECKS
-        assert(!b->quicked);
-#endif
-
-	return board_play_(b, m);
-}
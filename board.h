@@ -19,8 +19,9 @@ struct ownermap;
 
 //#define BOARD_SIZE 9            /* Fixed board size, allows better optimization */
 
-//#define BOARD_PAT3              /* Incremental 3x3 pattern codes */
-                                  /* XXX faster without ?! */
+//#define BOARD_PAT3              /* Incremental 3x3 pattern codes (Makefile option) */
+
+//#define BOARD_LIBMAP            /* Exact liberties bitboard for each group (Makefile option) */
 
 //#define BOARD_HASH_COMPAT	  /* Enable to get same hashes as old Pachi versions. */
 
@@ -37,8 +38,12 @@ struct ownermap;
 
 #define BOARD_MAX_COORDS  ((BOARD_MAX_SIZE+2) * (BOARD_MAX_SIZE+2))
 #define BOARD_MAX_MOVES   (BOARD_MAX_SIZE * BOARD_MAX_SIZE)
-#define BOARD_MAX_GROUPS  (BOARD_MAX_SIZE * BOARD_MAX_SIZE * 2 / 3)
-/* For 19x19, max 19*2*6 = 228 groups (stacking b&w stones, each third line empty) */
+#define BOARD_MAX_GROUPS  (BOARD_MAX_SIZE * BOARD_MAX_SIZE * 4 / 5 + 2)
+/* Group ids are < BOARD_MAX_GROUPS (0 == no group). Each group needs a liberty
+ * and an empty point is liberty of at most 4 groups so max 4/5 of the points
+ * are groups, +1 for a suicide in progress. (19x19: 289 groups) */
+
+#include "bitboard.h"
 
 enum symmetry {
 		SYM_FULL,
@@ -67,7 +72,8 @@ typedef uint64_t hash_t;
                              /* XXX This really belongs in pattern3.h, unfortunately that would mean a dependency hell. */
 typedef uint32_t hash3_t;    /* 3x3 pattern hash */
 
-typedef coord_t group_t;     /* Note that "group" is only chain of stones that is solidly connected for us. */
+typedef int group_t;         /* Note that "group" is only chain of stones that is solidly connected for us.
+			      * Group id: small integer, index in gi[]. 0 == no group */
 
 
 typedef struct {              /* Keep track of only up to GROUP_KEEP_LIBS. over that, we don't care. */
@@ -78,6 +84,10 @@ typedef struct {              /* Keep track of only up to GROUP_KEEP_LIBS. over
 			       * It denotes only number of items in lib[], thus you can rely
 			       * on it to store real liberties only up to <= GROUP_REFILL_LIBS. */
 	coord_t lib[GROUP_KEEP_LIBS];  
+	coord_t base;         /* First stone of the group, see group_base() */
+#ifdef BOARD_LIBMAP
+	bitboard_t libmap;    /* All liberties, lib[] gets refilled from here. */
+#endif
 } group_info_t;
 
 
@@ -127,6 +137,7 @@ typedef struct {
 	int rsize;                          /* real board size     (19x19: 19) */
 	int stride;                         /* padded board size   (19x19: 21) */
 	int max_coords;                     /* stride^2 */
+	int max_groups;                     /* Group ids in use are < max_groups */
 	int bits2;                          /* ceiling(log2(size2)) */
 	
 	int nei8[8], dnei[4];               /* Iterator offsets for foreach_neighbor*() */
@@ -134,6 +145,10 @@ typedef struct {
 	hash_t h[BOARD_MAX_COORDS][2];      /* Fixed zobrist hashes for all coords (black and white) */
 	
 	uint8_t coord[BOARD_MAX_COORDS][2]; /* Cached x-y coord info so we avoid division. */
+
+	bitboard_t onboard;                 /* Bitboard of on-board points */
+
+	int kernel;                         /* Size specialized code to use, see board_kernel.h */
 } board_statics_t;
 
 /* Only one board size in use at any given time so don't need array */
@@ -168,13 +183,18 @@ FB_ONLY(bool superko_violation);  /* Whether we tried to add a hash twice; board
 	 * speed up some internal loops. Some of the foreach iterators below might
 	 * include these points; you need to handle them yourselves, if you need to. */	
 	
+	bitboard_t bits[2];                /* Black / white stones, mirrors b[]. Use board_stone_bits() */
 	enum stone b[BOARD_MAX_COORDS];    /* Stones played on the board */
 	neighbors_t n[BOARD_MAX_COORDS];   /* Neighboring colors; numbers of neighbors of index color */
 	
 	group_t g[BOARD_MAX_COORDS];       /* Group id the stones are part of; 0 == no group */	
-	group_info_t gi[BOARD_MAX_COORDS]; /* Group information - indexed by gid (which is coord of base group stone) */
 	coord_t p[BOARD_MAX_COORDS];       /* Positions of next stones in the stone group; 0 == last stone */
 
+	/* Groups are indexed by group id (not a goban map) */
+	group_info_t gi[BOARD_MAX_GROUPS]; /* Group information */
+	group_t gfree[BOARD_MAX_GROUPS + 4];  /* Free group ids (stack), +4 for board_undo_t */
+	int gfree_n;
+
 #ifdef BOARD_PAT3       
 FB_ONLY(hash3_t pat3)[BOARD_MAX_COORDS];   /* 3x3 pattern hash for each position; see pattern3.h for encoding
 					    * specification. The information is only valid for empty points. */
@@ -190,9 +210,10 @@ FB_ONLY(int clen);
 #endif
 
 FB_ONLY(bool playout_board);
+FB_ONLY(bool playout_hash);                /* Keep maintaining hash in playouts (for cycle detection) */
 
 /*************************************************************************************************************/
-/* Not maintained during playouts: */
+/* Not maintained during playouts (except hash if playout_hash is set): */
 	
 FB_ONLY(board_symmetry_t symmetry);               /* Symmetry information */
 
@@ -220,7 +241,8 @@ FB_ONLY(int moveno)[BOARD_MAX_COORDS];     /* Move number for each coord */
 					    * reset only at clear_board. */
 	
 	void *ps;                          /* Playout-specific state; persistent through board development,
-					    * initialized by play_random_game() and free()'d at board destroy time */
+					    * allocated by policy setboard() with board_ps_alloc(), released
+					    * at board destroy time */
 } board_t;
 
 
@@ -229,11 +251,13 @@ FB_ONLY(int moveno)[BOARD_MAX_COORDS];     /* Move number for each coord */
 #define the_board_rsize()       BOARD_SIZE
 #define the_board_stride()        (BOARD_SIZE + 2)
 #define board_max_coords(b)       (board_stride(b) * board_stride(b))
+#define board_max_groups(b)       (BOARD_SIZE * BOARD_SIZE * 4 / 5 + 2)
 #else
 #define board_rsize(b)          ((b)->rsize)
 #define the_board_rsize()       (board_statics.rsize)
 #define the_board_stride()        (board_statics.stride)
 #define board_max_coords(b)       (board_statics.max_coords)
+#define board_max_groups(b)       (board_statics.max_groups)
 #endif
 
 #define board_stride(b)           (board_rsize(b) + 2)
@@ -267,6 +291,13 @@ FB_ONLY(int moveno)[BOARD_MAX_COORDS];     /* Move number for each coord */
 #define board_at(b_, c)      ((b_)->b[c])
 #define board_atxy(b_, x, y) ((b_)->b[coord_xy(x, y)])
 
+#define board_stone_bits(b_, color)  (&(b_)->bits[(color) - 1])
+
+#ifdef BOARD_LIBMAP
+/* Exact number of liberties of group @g_ */
+#define board_group_libs_exact(b_, g_)  (bitboard_popcount(&board_group_info(b_, g_).libmap))
+#endif
+
 #define group_at(b_, c)      ((b_)->g[c])
 #define group_atxy(b_, x, y) ((b_)->g[coord_xy(x, y)])
 
@@ -279,8 +310,8 @@ FB_ONLY(int moveno)[BOARD_MAX_COORDS];     /* Move number for each coord */
 
 #define groupnext_at(b_, c) ((b_)->p[c])
 
-#define group_base(g_) (g_)
-#define group_is_onestone(b_, g_) (groupnext_at(b_, group_base(g_)) == 0)
+#define group_base(b_, g_) (board_group_info(b_, g_).base)
+#define group_is_onestone(b_, g_) (groupnext_at(b_, group_base(b_, g_)) == 0)
 #define board_group_info(b_, g_) ((b_)->gi[(g_)])
 #define board_group_captured(b_, g_) (board_group_info(b_, g_).libs == 0)
 /* board_group_other_lib() makes sense only for groups with two liberties. */
@@ -297,8 +328,14 @@ FB_ONLY(int moveno)[BOARD_MAX_COORDS];     /* Move number for each coord */
 board_t *board_new(int size, char *fbookfile);
 void board_delete(board_t **board);
 void board_copy(board_t *board2, board_t *board1);
+void board_copy_live(board_t *board2, board_t *board1);
 void board_done(board_t *board);
 
+/* Playout state (b->ps) allocation.
+ * A board is created and destroyed for every playout, so blocks are
+ * recycled through per-thread free lists instead of malloc() / free(). */
+void *board_ps_alloc(size_t size);
+
 void board_resize(board_t *b, int size);
 void board_clear(board_t *board);
 
@@ -354,6 +391,9 @@ bool board_is_false_eyelike(board_t *b, coord_t coord, enum stone eye_color);
 bool board_is_one_point_eye(board_t *b, coord_t c, enum stone eye_color);
 /* Returns 1pt eye color (can be false-eye) */
 enum stone board_eye_color(board_t *board, coord_t c);
+/* Empty points that are eyelike for black / white in @eyes[S_BLACK] / @eyes[S_WHITE],
+ * board_eye_color() for the whole board at once. */
+void board_eye_bits(board_t *b, bitboard_t eyes[S_MAX]);
 
 /* board_official_score() is the scoring method for yielding score suitable
  * for external presentation. For fast scoring of entirely filled boards
@@ -395,7 +435,7 @@ const char *rules2str(enum rules rules);
 #define foreach_in_group(board_, group_) \
 	do { \
 		board_t *board__ = board_; \
-		for (coord_t c = group_base(group_); c; c = groupnext_at(board__, c))
+		for (coord_t c = group_base(board__, group_); c; c = groupnext_at(board__, c))
 #define foreach_in_group_end \
 	} while (0)
 
@@ -0,0 +1,61 @@
+#ifndef PACHI_BOARD_KERNEL_H
+#define PACHI_BOARD_KERNEL_H
+
+/* Board size specialized code.
+ *
+ * Knowing board size at compile time (BOARD_SIZE) gives faster code
+ * (constant stride, board_bits2() ...) but then Pachi can only play on
+ * one board size. With BOARD_KERNELS (Makefile), hot code is compiled
+ * for 9x9, 13x13 and 19x19 in addition to the generic version, and the
+ * generic version forwards calls to the specialized one when there is
+ * one for current board size (picked in board_statics_init()).
+ *
+ * Kernel sources (board_play.c, board_undo.c, playout/moggy.c) get
+ * compiled once normally (generic version) and once for each size with
+ * BOARD_KERNEL and BOARD_SIZE set to the size (foo.c -> foo_9.o etc).
+ * Kernel functions are named with KERNEL(): foo() in generic version,
+ * foo_9() in 9x9 version. Generic version dispatches with:
+ *
+ *	#ifdef BOARD_KERNEL_DISPATCH
+ *	BOARD_KERNEL_TABLE(int, foo, (args));
+ *	#endif
+ *	...
+ *	#ifdef BOARD_KERNEL_DISPATCH
+ *		if (board_statics.kernel)
+ *			return board_kernel(foo)(args);
+ *	#endif
+ *
+ * Code that isn't hot enough to need specialization must be compiled in
+ * the generic version only (#ifndef BOARD_KERNEL). */
+
+#include "board.h"
+
+/* Board sizes with specialized code: kernel index for board size,
+ * 0 means generic version. */
+#define BOARD_KERNELS_MAX  4
+#define board_kernel_index(size)  ((size) == 9 ? 1 : (size) == 13 ? 2 : (size) == 19 ? 3 : 0)
+
+#define KERNEL_NAME_(name, size)  name##_##size
+#define KERNEL_NAME(name, size)   KERNEL_NAME_(name, size)
+
+#ifdef BOARD_KERNEL
+#define KERNEL(name)              KERNEL_NAME(name, BOARD_KERNEL)
+#define kernel_static                      /* Needs to be visible from generic version */
+#else
+#define KERNEL(name)              name
+#define kernel_static             static
+#endif
+
+#if defined(BOARD_KERNELS) && !defined(BOARD_KERNEL)
+#define BOARD_KERNEL_DISPATCH
+
+/* Declare specialized versions of kernel function @name, and define its dispatch table. */
+#define BOARD_KERNEL_TABLE(ret, name, args) \
+	ret name##_9 args;  ret name##_13 args;  ret name##_19 args; \
+	static ret (* const name##_kernels[BOARD_KERNELS_MAX]) args = { NULL, name##_9, name##_13, name##_19 }
+
+/* Specialized version of kernel function @name for current board size. */
+#define board_kernel(name)        (name##_kernels[board_statics.kernel])
+#endif
+
+#endif
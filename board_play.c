@@ -0,0 +1,273 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "board.h"
+#include "board_kernel.h"
+#include "debug.h"
+#include "random.h"
+#include "dcnn.h"
+
+#ifdef BOARD_PAT3
+#include "pattern3.h"
+#endif
+
+/* board_play() and playout moves. Size specialized, see board_kernel.h */
+
+#if 0
+#define profiling_noinline __attribute__((noinline))
+#else
+#define profiling_noinline
+#endif
+
+#ifdef BOARD_KERNEL_DISPATCH
+BOARD_KERNEL_TABLE(int,  board_play, (board_t *b, move_t *m));
+BOARD_KERNEL_TABLE(void, board_play_random, (board_t *b, enum stone color, coord_t *coord, ppr_permit permit, void *permit_data));
+#endif
+
+/********************************************************************************************************/
+/* board_play() implementation */
+
+static inline void
+board_addf(board_t *b, coord_t c)
+{
+	b->fmap[c] = b->flen; 
+	b->f[b->flen++] = c;
+}
+
+static inline void
+board_rmf(board_t *b, int f)
+{
+	/* Not bothering to delete fmap records,
+	 * Just keep the valid ones up to date. */
+	coord_t c = b->f[f] = b->f[--b->flen];
+	b->fmap[c] = f;
+}
+
+static void
+board_commit_move(board_t *b, move_t *m)
+{
+	if (!playout_board(b)) {
+#ifdef DCNN_DARKFOREST
+		if (darkforest_dcnn && !is_pass(m->coord))
+			b->moveno[m->coord] = b->moves;
+#endif
+	}
+
+	b->last_move_i = last_move_nexti(b);
+	last_move(b) = *m;
+
+	b->moves++;
+}
+
+/* Update board hash with given coordinate. */
+static void profiling_noinline
+board_hash_update(board_t *board, coord_t coord, enum stone color)
+{
+	if (!playout_board(board) || board->playout_hash) {
+		board->hash ^= hash_at(coord, color);
+		if (DEBUGL(8))
+			fprintf(stderr, "board_hash_update(%d,%d,%d) ^ %" PRIhash " -> %" PRIhash "\n", color, coord_x(coord), coord_y(coord), hash_at(coord, color), board->hash);
+	}
+
+#ifdef BOARD_PAT3
+	/* Stone placed or removed: only color fields of 8-neighbors change
+	 * (from / to S_NONE, so xor works both ways). Atari bits are taken
+	 * care of by board_capturable_add() / rm(), captured points get
+	 * recomputed by board_pat3_captured(). Codes are only meaningful
+	 * for empty points, stones' codes get updated too (cheaper). */
+	int s = board_stride(board);
+	hash3_t *pat3 = &board->pat3[coord];
+	pat3[-s - 1] ^= color;
+	pat3[-s    ] ^= color << 2;
+	pat3[-s + 1] ^= color << 4;
+	pat3[-1    ] ^= color << 6;
+	pat3[ 1    ] ^= color << 8;
+	pat3[ s - 1] ^= color << 10;
+	pat3[ s    ] ^= color << 12;
+	pat3[ s + 1] ^= color << 14;
+#endif
+}
+
+/* Commit current board hash to history. */
+static void profiling_noinline
+board_hash_commit(board_t *b)
+{
+	if (playout_board(b))  return;
+
+	if (DEBUGL(8)) fprintf(stderr, "board_hash_commit %" PRIhash "\n", b->hash);
+
+	for (int i = 0; i < BOARD_HASH_HISTORY; i++) {
+		if (b->hash_history[i] == b->hash) {
+			if (DEBUGL(5))  fprintf(stderr, "SUPERKO VIOLATION noted at %s\n", coord2sstr(last_move(b).coord));
+			b->superko_violation = true;
+			return;
+		}
+	}
+
+	int i = b->hash_history_next;
+	b->hash_history[i] = b->hash;
+	b->hash_history_next = (i+1) % BOARD_HASH_HISTORY;
+}
+
+#ifdef BOARD_PAT3
+/* Atari bits of @lib's code for stones of @group around it. */
+static inline hash3_t
+board_pat3_atari_bits(board_t *b, coord_t lib, group_t group)
+{
+	int s = board_stride(b);
+	return ((group_at(b, lib - s) == group) << 19 |
+		(group_at(b, lib - 1) == group) << 18 |
+		(group_at(b, lib + 1) == group) << 17 |
+		(group_at(b, lib + s) == group) << 16);
+}
+#endif
+
+/* Group got captured: compute codes of freed points once all stones
+ * are gone and surrounding groups got their liberties. */
+static inline void
+board_pat3_captured(board_t *b, group_t group)
+{
+#ifdef BOARD_PAT3
+	foreach_in_group(b, group) {
+		b->pat3[c] = pattern3_hash(b, c);
+	} foreach_in_group_end;
+#endif
+}
+
+static inline void
+board_pat3_fix(board_t *b, group_t group_from, group_t group_to)
+{
+#ifdef BOARD_PAT3
+	group_info_t *gi_from = &board_group_info(b, group_from);
+	group_info_t *gi_to = &board_group_info(b, group_to);
+	
+	if (gi_to->libs == 1) {
+		coord_t lib = board_group_info(b, group_to).lib[0];
+		if (gi_from->libs == 1) {
+			/* We removed group_from from capturable groups,
+			 * therefore switching the atari flag off.
+			 * We need to set it again since group_to is also
+			 * capturable. */
+			b->pat3[lib] |= board_pat3_atari_bits(b, lib, group_from);
+		}
+	}
+#endif /* BOARD_PAT3 */
+}
+
+/* Stone @coord joined @group: if group is in atari, liberty's atari bit
+ * for @coord is missing (board_capturable_add() was called before). */
+static inline void
+board_pat3_add_to_group(board_t *b, group_t group, coord_t coord)
+{
+#ifdef BOARD_PAT3
+	group_info_t *gi = &board_group_info(b, group);
+	if (gi->libs != 1)
+		return;
+	coord_t lib = gi->lib[0];
+	int s = board_stride(b);
+	b->pat3[lib] |= ((coord == lib - s) << 19 | (coord == lib - 1) << 18 |
+			 (coord == lib + 1) << 17 | (coord == lib + s) << 16);
+#endif
+}
+
+static void
+board_capturable_add(board_t *board, group_t group, coord_t lib)
+{
+	//fprintf(stderr, "group %s cap %s\n", coord2sstr(group), coord2sstr(lib));
+
+#ifdef BOARD_PAT3
+	board->pat3[lib] |= board_pat3_atari_bits(board, lib, group);
+#endif
+
+#ifdef WANT_BOARD_C
+	/* Update the list of capturable groups. */
+	assert(group);
+	assert(board->clen < BOARD_MAX_GROUPS);
+	board->c[board->clen++] = group;
+#endif
+}
+
+static void
+board_capturable_rm(board_t *board, group_t group, coord_t lib)
+{
+	//fprintf(stderr, "group %s nocap %s\n", coord2sstr(group), coord2sstr(lib));
+#ifdef BOARD_PAT3
+	board->pat3[lib] &= ~board_pat3_atari_bits(board, lib, group);
+#endif
+
+#ifdef WANT_BOARD_C
+	/* Update the list of capturable groups. */
+	for (int i = 0; i < board->clen; i++)
+		if (unlikely(board->c[i] == group)) {
+			board->c[i] = board->c[--board->clen];
+			return;
+		}
+	fprintf(stderr, "rm of bad group %s\n", coord2sstr(group_base(board, group)));
+	assert(0);
+#endif
+}
+
+
+#define FULL_BOARD
+#include "board_play.h"
+
+int
+KERNEL(board_play)(board_t *b, move_t *m)
+{
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel)
+		return board_kernel(board_play)(b, m);
+#endif
+
+#ifdef BOARD_UNDO_CHECKS
+        assert(!b->quicked);
+#endif
+
+	return board_play_(b, m);
+}
+
+
+/********************************************************************************************************/
+/* playout moves */
+
+static inline bool
+board_try_random_move(board_t *b, enum stone color, coord_t *coord, int f, ppr_permit permit, void *permit_data)
+{
+	*coord = b->f[f];
+	move_t m = { *coord, color };
+	if (DEBUGL(6))
+		fprintf(stderr, "trying random move %d: %d,%d %s %d\n", f, coord_x(*coord), coord_y(*coord), coord2sstr(*coord), board_is_valid_move(b, &m));
+	permit = (permit ? permit : board_permit);
+	if (!permit(b, &m, permit_data))
+		return false;
+	if (m.coord == *coord)
+		return likely(board_play_f(b, &m, f) >= 0);
+	*coord = m.coord; // permit modified the coordinate
+	return likely(KERNEL(board_play)(b, &m) >= 0);
+}
+
+void
+KERNEL(board_play_random)(board_t *b, enum stone color, coord_t *coord, ppr_permit permit, void *permit_data)
+{
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel) {
+		board_kernel(board_play_random)(b, color, coord, permit, permit_data);
+		return;
+	}
+#endif
+
+	if (likely(b->flen)) {
+		int base = fast_random(b->flen), f;
+		for (f = base; f < b->flen; f++)
+			if (board_try_random_move(b, color, coord, f, permit, permit_data))
+				return;
+		for (f = 0; f < base; f++)
+			if (board_try_random_move(b, color, coord, f, permit, permit_data))
+				return;
+	}
+
+	*coord = pass;
+	move_t m = { pass, color };
+	KERNEL(board_play)(b, &m);
+}
@@ -5,10 +5,13 @@ board_group_addlib(board_t *board, group_t group, coord_t coord)
 {
 	if (DEBUGL(7))
 		fprintf(stderr, "Group %d[%s] %d: Adding liberty %s\n",
-			group_base(group), coord2sstr(group_base(group)),
+			group, coord2sstr(group_base(board, group)),
 			board_group_info(board, group).libs, coord2sstr(coord));
 
 	group_info_t *gi = &board_group_info(board, group);
+#ifdef BOARD_LIBMAP
+	bitboard_set(&gi->libmap, coord);
+#endif
 	if (gi->libs < GROUP_KEEP_LIBS) {
 		for (int i = 0; i < GROUP_KEEP_LIBS; i++) {
 #if 0                   /* Seems extra branch just slows it down */
@@ -25,6 +28,24 @@ board_group_addlib(board_t *board, group_t group, coord_t coord)
 	}
 }
 
+#ifdef BOARD_LIBMAP
+static void
+board_group_find_extra_libs(board_t *board, group_t group, group_info_t *gi, coord_t avoid)
+{
+	/* Add liberties from libmap we don't have in lib[] yet.
+	 * (@avoid is gone from libmap already) */
+	bitboard_t extra = gi->libmap;
+	for (int i = 0; i < gi->libs; i++)
+		bitboard_unset(&extra, gi->lib[i]);
+
+	for (int i = 0; i < BITBOARD_WORDS; i++)
+		for (uint64_t w = extra.w[i]; w; w &= w - 1) {
+			gi->lib[gi->libs++] = i * 64 + __builtin_ctzll(w);
+			if (unlikely(gi->libs >= GROUP_KEEP_LIBS))
+				return;
+		}
+}
+#else
 static void
 board_group_find_extra_libs(board_t *board, group_t group, group_info_t *gi, coord_t avoid)
 {
@@ -52,16 +73,20 @@ board_group_find_extra_libs(board_t *board, group_t group, group_info_t *gi, coo
 #undef watermark_get
 #undef watermark_set
 }
+#endif /* BOARD_LIBMAP */
 
 static void
 board_group_rmlib(board_t *board, group_t group, coord_t coord)
 {
 	if (DEBUGL(7))
 		fprintf(stderr, "Group %d[%s] %d: Removing liberty %s\n",
-			group_base(group), coord2sstr(group_base(group)),
+			group, coord2sstr(group_base(board, group)),
 			board_group_info(board, group).libs, coord2sstr(coord));
 
 	group_info_t *gi = &board_group_info(board, group);
+#ifdef BOARD_LIBMAP
+	bitboard_unset(&gi->libmap, coord);
+#endif
 	for (int i = 0; i < GROUP_KEEP_LIBS; i++) {
 #if 0           /* Seems extra branch just slows it down */
 		if (!gi->lib[i]) break;
@@ -101,6 +126,7 @@ board_remove_stone(board_t *board, group_t group, coord_t c)
 {
 	enum stone color = board_at(board, c);
 	board_at(board, c) = S_NONE;
+	bitboard_unset(board_stone_bits(board, color), c);
 	group_at(board, c) = 0;
 #ifdef FULL_BOARD
 	board_hash_update(board, c, color);
@@ -116,10 +142,6 @@ board_remove_stone(board_t *board, group_t group, coord_t c)
 	});
 
 #ifdef FULL_BOARD	
-	/* board_hash_update() might have seen the freed up point as able
-	 * to capture another group in atari that only after the loop
-	 * above gained enough liberties. Reset pat3 again. */
-	board_pat3_reset(board, c);
 	board_addf(board, c);	
 #endif
 }
@@ -134,10 +156,14 @@ board_group_capture(board_t *board, group_t group)
 		board_remove_stone(board, group, c);
 		stones++;
 	} foreach_in_group_end;
+#ifdef FULL_BOARD
+	board_pat3_captured(board, group);
+#endif
 
 	group_info_t *gi = &board_group_info(board, group);
 	assert(gi->libs == 0);
 	memset(gi, 0, sizeof(*gi));
+	board->gfree[board->gfree_n++] = group;
 
 	return stones;
 }
@@ -154,11 +180,14 @@ add_to_group(board_t *board, group_t group, coord_t prevstone, coord_t coord)
 		if (board_at(board, c) == S_NONE)
 			board_group_addlib(board, group, c);
 	});
+#ifdef FULL_BOARD
+	board_pat3_add_to_group(board, group, coord);
+#endif
 
 	if (DEBUGL(8))
 		fprintf(stderr, "add_to_group: added (%s ->) %s (-> %s) to group %s\n",
 			coord2sstr(prevstone), coord2sstr(coord), coord2sstr(groupnext_at(board, coord)),
-			coord2sstr(group_base(group)));
+			coord2sstr(group_base(board, group)));
 }
 
 static void profiling_noinline
@@ -166,7 +195,7 @@ merge_groups(board_t *board, group_t group_to, group_t group_from)
 {
 	if (DEBUGL(7))
 		fprintf(stderr, "board_play_raw: merging groups %d -> %d\n",
-			group_base(group_from), group_base(group_to));
+			group_from, group_to);
 	group_info_t *gi_from = &board_group_info(board, group_from);
 	group_info_t *gi_to = &board_group_info(board, group_to);
 #ifdef FULL_BOARD
@@ -176,6 +205,10 @@ merge_groups(board_t *board, group_t group_to, group_t group_from)
 
 	if (DEBUGL(7))  fprintf(stderr,"---- (froml %d, tol %d)\n", gi_from->libs, gi_to->libs);
 
+#ifdef BOARD_LIBMAP
+	bitboard_or(&gi_to->libmap, &gi_to->libmap, &gi_from->libmap);
+#endif
+
 	if (gi_to->libs < GROUP_KEEP_LIBS) {
 		for (int i = 0; i < gi_from->libs; i++) {
 			for (int j = 0; j < gi_to->libs; j++)
@@ -196,7 +229,7 @@ next_from_lib:;
 	board_pat3_fix(board, group_from, group_to);
 #endif
 
-	coord_t last_in_group;
+	coord_t last_in_group = 0;
 	foreach_in_group(board, group_from) {
 		last_in_group = c;
 		group_at(board, c) = group_to;
@@ -206,25 +239,32 @@ next_from_lib:;
 	board_undo_t *u = board->u;
 	u->merged[++u->nmerged_tmp].last = last_in_group;
 #endif
-	groupnext_at(board, last_in_group) = groupnext_at(board, group_base(group_to));
-	groupnext_at(board, group_base(group_to)) = group_base(group_from);
+	groupnext_at(board, last_in_group) = groupnext_at(board, group_base(board, group_to));
+	groupnext_at(board, group_base(board, group_to)) = group_base(board, group_from);
 	memset(gi_from, 0, sizeof(group_info_t));
+	board->gfree[board->gfree_n++] = group_from;
 
-	if (DEBUGL(7))  fprintf(stderr, "board_play_raw: merged group: %d\n", group_base(group_to));
+	if (DEBUGL(7))  fprintf(stderr, "board_play_raw: merged group: %d\n", group_to);
 }
 
 static group_t profiling_noinline
 new_group(board_t *board, coord_t coord)
 {
-	group_t group = coord;
+	assert(board->gfree_n > 0);
+	group_t group = board->gfree[--board->gfree_n];
 	group_info_t *gi = &board_group_info(board, group);
+	gi->base = coord;
 	foreach_neighbor(board, coord, {
-		if (board_at(board, c) == S_NONE)
+		if (board_at(board, c) == S_NONE) {
 			/* board_group_addlib is ridiculously expensive for us */
+#ifdef BOARD_LIBMAP
+			bitboard_set(&gi->libmap, c);
+#endif
 #if GROUP_KEEP_LIBS < 4
 			if (gi->libs < GROUP_KEEP_LIBS)
 #endif
 			gi->lib[gi->libs++] = c;
+		}
 	});
 
 	group_at(board, coord) = group;
@@ -236,7 +276,7 @@ new_group(board_t *board, coord_t coord)
 
 	if (DEBUGL(8))
 		fprintf(stderr, "new_group: added %d,%d to group %d\n",
-			coord_x(coord), coord_y(coord), group_base(group));
+			coord_x(coord), coord_y(coord), group);
 
 	return group;
 }
@@ -255,7 +295,7 @@ play_one_neighbor(board_t *board,
 
 	board_group_rmlib(board, ngroup, coord);
 	if (DEBUGL(7))  fprintf(stderr, "board_play_raw: reducing libs for group %d (%d:%d,%d)\n",
-				group_base(ngroup), ncolor, color, other_color);
+				ngroup, ncolor, color, other_color);
 
 	if (ncolor == color && ngroup != group) {
 		if (!group) {
@@ -266,7 +306,7 @@ play_one_neighbor(board_t *board,
 	} else if (ncolor == other_color) {
 		if (DEBUGL(8)) {
 			group_info_t *gi = &board_group_info(board, ngroup);
-			fprintf(stderr, "testing captured group %d[%s]: ", group_base(ngroup), coord2sstr(group_base(ngroup)));
+			fprintf(stderr, "testing captured group %d[%s]: ", ngroup, coord2sstr(group_base(board, ngroup)));
 			for (int i = 0; i < GROUP_KEEP_LIBS; i++)
 				fprintf(stderr, "%s ", coord2sstr(gi->lib[i]));
 			fprintf(stderr, "\n");
@@ -299,6 +339,7 @@ board_play_outside(board_t *board, move_t *m, int f)
 	});
 
 	board_at(board, coord) = color;
+	bitboard_set(board_stone_bits(board, color), coord);
 	if (unlikely(!group))
 		group = new_group(board, coord);
 
@@ -369,7 +410,7 @@ board_play_in_eye(board_t *board, move_t *m, int f)
 		board_group_rmlib(board, group, coord);
 		if (DEBUGL(7))
 			fprintf(stderr, "board_play_raw: reducing libs for group %d\n",
-				group_base(group));
+				group);
 
 		if (board_group_captured(board, group)) {
 			ko_caps += board_group_capture(board, group);
@@ -386,6 +427,7 @@ board_play_in_eye(board_t *board, move_t *m, int f)
 	}
 
 	board_at(board, coord) = color;
+	bitboard_set(board_stone_bits(board, color), coord);
 	group_t group = new_group(board, coord);
 
 	board_commit_move(board, m);
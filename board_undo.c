@@ -1,8 +1,15 @@
 
 #include "board.h"
+#include "board_kernel.h"
 #include "debug.h"
 #include "board_undo.h"
 
+/* Size specialized, see board_kernel.h */
+#ifdef BOARD_KERNEL_DISPATCH
+BOARD_KERNEL_TABLE(int,  board_quick_play, (board_t *b, move_t *m, board_undo_t *u));
+BOARD_KERNEL_TABLE(void, board_quick_undo, (board_t *b, move_t *m, board_undo_t *u));
+#endif
+
 #if 0
 #define profiling_noinline __attribute__((noinline))
 #else
@@ -23,6 +30,8 @@ undo_init(board_t *b, move_t *m, board_undo_t *u)
 	u->ko = b->ko;
 	u->last_ko = b->last_ko;
 	u->last_ko_age = b->last_ko_age;
+	u->gfree_n = b->gfree_n;
+	memcpy(u->gfree, &b->gfree[b->gfree_n], sizeof(u->gfree));
 	u->captures_end = &u->captures[0];
 	u->ncaptures = 0;
 	
@@ -111,8 +120,13 @@ board_commit_move(board_t *b, move_t *m)
 #include "board_play.h"
 
 int
-board_quick_play(board_t *b, move_t *m, board_undo_t *u)
+KERNEL(board_quick_play)(board_t *b, move_t *m, board_undo_t *u)
 {
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel)
+		return board_kernel(board_quick_play)(b, m, u);
+#endif
+
 	assert(!is_resign(m->coord));  // XXX remove
 	
 	undo_init(b, m, u);
@@ -145,7 +159,7 @@ undo_merge(board_t *b, board_undo_t *u, move_t *m)
 			
 		board_group_info(b, old_group) = merged[i].info;
 			
-		groupnext_at(b, group_base(group)) = groupnext_at(b, merged[i].last);
+		groupnext_at(b, group_base(b, group)) = groupnext_at(b, merged[i].last);
 		groupnext_at(b, merged[i].last) = 0;
 
 #if 0
@@ -192,6 +206,7 @@ restore_enemies(board_t *b, board_undo_t *u, move_t *m)
 
 		for (int j = 0; stones[j]; j++) {
 			board_at(b, stones[j]) = other_color;
+			bitboard_set(board_stone_bits(b, other_color), stones[j]);
 			group_at(b, stones[j]) = old_group;
 			groupnext_at(b, stones[j]) = stones[j + 1];
 
@@ -230,6 +245,7 @@ board_undo_stone(board_t *b, board_undo_t *u, move_t *m)
 		memset(&board_group_info(b, group_at(b, coord)), 0, sizeof(group_info_t));
 	
 	board_at(b, coord) = S_NONE;
+	bitboard_unset(board_stone_bits(b, color), coord);
 	group_at(b, coord) = 0;
 	groupnext_at(b, coord) = u->next_at;
 	
@@ -261,6 +277,7 @@ restore_suicide(board_t *b, board_undo_t *u, move_t *m)
 
 		for (int j = 0; stones[j]; j++) {
 			board_at(b, stones[j]) = other_color;
+			bitboard_set(board_stone_bits(b, other_color), stones[j]);
 			group_at(b, stones[j]) = old_group;
 			groupnext_at(b, stones[j]) = stones[j + 1];
 
@@ -298,6 +315,7 @@ board_undo_suicide(board_t *b, board_undo_t *u, move_t *m)
 	undo_merge(b, u, m);
 
 	board_at(b, coord) = S_NONE;
+	bitboard_unset(board_stone_bits(b, m->color), coord);
 	group_at(b, coord) = 0;
 	groupnext_at(b, coord) = u->next_at;
 
@@ -308,8 +326,15 @@ board_undo_suicide(board_t *b, board_undo_t *u, move_t *m)
 }
 
 void
-board_quick_undo(board_t *b, move_t *m, board_undo_t *u)
+KERNEL(board_quick_undo)(board_t *b, move_t *m, board_undo_t *u)
 {
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel) {
+		board_kernel(board_quick_undo)(b, m, u);
+		return;
+	}
+#endif
+
 #ifdef BOARD_UNDO_CHECKS
 	b->quicked--;
 #endif
@@ -319,6 +344,8 @@ board_quick_undo(board_t *b, move_t *m, board_undo_t *u)
 	b->ko = u->ko;
 	b->last_ko = u->last_ko;
 	b->last_ko_age = u->last_ko_age;
+	b->gfree_n = u->gfree_n;
+	memcpy(&b->gfree[b->gfree_n], u->gfree, sizeof(u->gfree));
 	b->moves--;
 	
 	if (unlikely(is_pass(m->coord))) {
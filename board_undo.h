@@ -20,6 +20,8 @@ typedef struct board_undo {
 	int    last_ko_age;
 	
 	coord_t next_at;
+	int     gfree_n;     /* A move frees up to 4 group ids before taking at most one, */
+	group_t gfree[4];    /* only the free stack top changes. */
 	
 	coord_t	inserted;
 	undo_merge_t merged[4];
@@ -93,26 +93,43 @@ caffe_done()
 	net_size = 0;
 }
 	
+/* Evaluate @n positions at once: @data holds n inputs of @planes planes,
+ * @result gets n outputs of size * size values. */
 void
-caffe_get_data(float *data, float *result, int size, int planes, int psize)
+caffe_get_data_batch(float *data, float *result, int n, int size, int planes, int psize)
 {
 	assert(net && net_size == size);
-	Blob<float> *blob = new Blob<float>(1, planes, psize, psize);
+	Blob<float> *input = net->input_blobs()[0];
+	if (input->shape(0) != n) {  /* Batch size changed */
+		input->Reshape(n, planes, psize, psize);
+		net->Reshape();
+	}
+	
+	Blob<float> *blob = new Blob<float>(n, planes, psize, psize);
 	blob->set_cpu_data(data);
 	vector<Blob<float>*> bottom;
 	bottom.push_back(blob);
 	const vector<Blob<float>*>& rr = net->Forward(bottom);
-	assert(shape_size(rr[0]->shape()) >= size * size);
+	int stride = shape_size(rr[0]->shape()) / n;
+	assert(stride >= size * size);
 	
+	for (int k = 0; k < n; k++)
 	for (int i = 0; i < size * size; i++) {
-		result[i] = rr[0]->cpu_data()[i];
-		if (result[i] < 0.00001)
-			result[i] = 0.00001;
+		float *r = &result[k * size * size + i];
+		*r = rr[0]->cpu_data()[k * stride + i];
+		if (*r < 0.00001)
+			*r = 0.00001;
 	}
 	
 	delete blob;
 }
 
+void
+caffe_get_data(float *data, float *result, int size, int planes, int psize)
+{
+	caffe_get_data_batch(data, result, 1, size, planes, psize);
+}
+
 	
 } /* extern "C" */
 
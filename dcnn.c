@@ -1,5 +1,7 @@
 #define DEBUG
 #include <assert.h>
+#include <pthread.h>
+#include <string.h>
 #include <unistd.h>
 
 #include "debug.h"
@@ -10,7 +12,7 @@
 #include "dcnn.h"
 #include "timeinfo.h"
 
-typedef void (*dcnn_evaluate_t)(board_t *b, enum stone color, float result[]);
+typedef void (*dcnn_data_t)(board_t *b, enum stone color, float *data);
 typedef bool (*dcnn_supported_board_size_t)(board_t *b);
 
 typedef struct {
@@ -20,7 +22,8 @@ typedef struct {
 	char *weights_filename;
 	int  default_size;
 	dcnn_supported_board_size_t supported_board_size;
-	dcnn_evaluate_t             eval;
+	int                         planes;  /* Input planes */
+	dcnn_data_t                 data;    /* Fill input planes */
 	int  *global_var;
 } dcnn_t;
 
@@ -31,26 +34,26 @@ static bool board_15x15(board_t *b)        {  return (board_rsize(b) == 15);  }
 static bool board_13x13_and_up(board_t *b) {  return (board_rsize(b) >= 13);  }
 
 #ifdef DCNN_DETLEF
-static void detlef54_dcnn_eval(board_t *b, enum stone color, float result[]);
-static void detlef44_dcnn_eval(board_t *b, enum stone color, float result[]);
+static void detlef54_dcnn_data(board_t *b, enum stone color, float *data);
+static void detlef44_dcnn_data(board_t *b, enum stone color, float *data);
 #endif
 #ifdef DCNN_DARKFOREST
-static void darkforest_dcnn_eval(board_t *b, enum stone color, float result[]);
+static void darkforest_dcnn_data(board_t *b, enum stone color, float *data);
 #endif
 
 int darkforest_dcnn = 0;
 
 static dcnn_t dcnns[] = {
 #ifdef DCNN_DETLEF
-{  "detlef",     "Detlef's 54%", "detlef54.prototxt",  "detlef54.trained", 19, board_13x13_and_up,   detlef54_dcnn_eval },
-{  "detlef54",   "Detlef's 54%", "detlef54.prototxt",  "detlef54.trained", 19, board_13x13_and_up,   detlef54_dcnn_eval },
-{  "detlef44",   "Detlef's 44%", "detlef44.prototxt",  "detlef44.trained", 19, board_19x19,          detlef44_dcnn_eval },
+{  "detlef",     "Detlef's 54%", "detlef54.prototxt",  "detlef54.trained", 19, board_13x13_and_up, 13, detlef54_dcnn_data },
+{  "detlef54",   "Detlef's 54%", "detlef54.prototxt",  "detlef54.trained", 19, board_13x13_and_up, 13, detlef54_dcnn_data },
+{  "detlef44",   "Detlef's 44%", "detlef44.prototxt",  "detlef44.trained", 19, board_19x19,         2, detlef44_dcnn_data },
 #endif
 #ifdef DCNN_DARKFOREST
-{  "df",         "Darkforest",   "df2.prototxt",       "df2.trained",      19, board_19x19,          darkforest_dcnn_eval,  &darkforest_dcnn },
-{  "darkforest", "Darkforest",   "df2.prototxt",       "df2.trained",      19, board_19x19,          darkforest_dcnn_eval,  &darkforest_dcnn },
-{  "df",         "Darkforest",   "df2_15x15.prototxt", "df2.trained",      15, board_15x15,          darkforest_dcnn_eval,  &darkforest_dcnn },
-{  "darkforest", "Darkforest",   "df2_15x15.prototxt", "df2.trained",      15, board_15x15,          darkforest_dcnn_eval,  &darkforest_dcnn },
+{  "df",         "Darkforest",   "df2.prototxt",       "df2.trained",      19, board_19x19,        25, darkforest_dcnn_data,  &darkforest_dcnn },
+{  "darkforest", "Darkforest",   "df2.prototxt",       "df2.trained",      19, board_19x19,        25, darkforest_dcnn_data,  &darkforest_dcnn },
+{  "df",         "Darkforest",   "df2_15x15.prototxt", "df2.trained",      15, board_15x15,        25, darkforest_dcnn_data,  &darkforest_dcnn },
+{  "darkforest", "Darkforest",   "df2_15x15.prototxt", "df2.trained",      15, board_15x15,        25, darkforest_dcnn_data,  &darkforest_dcnn },
 #endif
 {  0, }
 };
@@ -124,17 +127,44 @@ dcnn_init(board_t *b)
 	if (dcnn_required && !caffe_ready())  die("dcnn required, aborting.\n");
 }
 
+/* Caffe net isn't thread-safe. */
+static pthread_mutex_t caffe_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+int
+dcnn_input_size(board_t *b)
+{
+	return dcnn->planes * board_rsize(b) * board_rsize(b);
+}
+
+void
+dcnn_encode(board_t *b, enum stone color, float *data)
+{
+	assert(dcnn_supported_board_size(b));
+	memset(data, 0, dcnn_input_size(b) * sizeof(float));
+	dcnn->data(b, color, data);
+}
+
+void
+dcnn_evaluate_batch(int size, float *data, float *result, int n)
+{
+	pthread_mutex_lock(&caffe_mutex);
+	caffe_get_data_batch(data, result, n, size, dcnn->planes, size);
+	pthread_mutex_unlock(&caffe_mutex);
+}
+
 void
 dcnn_evaluate_quiet(board_t *b, enum stone color, float result[])
 {
-	dcnn->eval(b, color, result);
+	float data[dcnn_input_size(b)];
+	dcnn_encode(b, color, data);
+	dcnn_evaluate_batch(board_rsize(b), data, result, 1);
 }
 
 void
 dcnn_evaluate(board_t *b, enum stone color, float result[])
 {
 	double time_start = time_now();	
-	dcnn->eval(b, color, result);
+	dcnn_evaluate_quiet(b, color, result);
 	if (DEBUGL(2))  fprintf(stderr, "dcnn in %.2fs\n", time_now() - time_start);	
 }
 
@@ -148,13 +178,12 @@ dcnn_evaluate(board_t *b, enum stone color, float result[])
  * http://physik.de/CNNlast.tar.gz */
 
 static void
-detlef54_dcnn_eval(board_t *b, enum stone color, float result[])
+detlef54_dcnn_data(board_t *b, enum stone color, float *data_)
 {
 	assert(dcnn_supported_board_size(b));
 
 	int size = board_rsize(b);
-	float data[13][size][size];
-	memset(data, 0, sizeof(data));
+	float (*data)[size][size] = (float (*)[size][size])data_;
 
 	for (int x = 0; x < size; x++)
 	for (int y = 0; y < size; y++) {
@@ -173,8 +202,6 @@ detlef54_dcnn_eval(board_t *b, enum stone color, float result[])
 		else if (c == last_move3(b).coord)   data[11][y][x] = 1.0;
 		else if (c == last_move4(b).coord)   data[12][y][x] = 1.0;
 	}
-
-	caffe_get_data((float*)data, result, size, 13, size);
 }
 
 
@@ -186,13 +213,12 @@ detlef54_dcnn_eval(board_t *b, enum stone color, float result[])
  * http://physik.de/net.tgz */
 
 static void
-detlef44_dcnn_eval(board_t *b, enum stone color, float result[])
+detlef44_dcnn_data(board_t *b, enum stone color, float *data_)
 {
 	enum stone other_color = stone_other(color);
 
 	int size = board_rsize(b);
-	float data[2][size][size];
-	memset(data, 0, sizeof(data));
+	float (*data)[size][size] = (float (*)[size][size])data_;
 
 	for (int y = 0; y < size; y++)
 	for (int x = 0; x < size; x++) {
@@ -200,8 +226,6 @@ detlef44_dcnn_eval(board_t *b, enum stone color, float result[])
 		if (board_at(b, c) == color)        data[0][y][x] = 1;
 		if (board_at(b, c) == other_color)  data[1][y][x] = 1;			
 	}
-
-	caffe_get_data((float*)data, result, size, 2, size);
 }
 #endif /* DCNN_DETLEF */
 
@@ -259,12 +283,11 @@ df_board_history_decay(board_t *b, coord_t coord, enum stone color)
 }
 
 static void
-darkforest_dcnn_eval(board_t *b, enum stone color, float result[])
+darkforest_dcnn_data(board_t *b, enum stone color, float *data_)
 {
 	enum stone other_color = stone_other(color);
 	int size = board_rsize(b);
-	float data[25][size][size];
-	memset(data, 0, sizeof(data));
+	float (*data)[size][size] = (float (*)[size][size])data_;
 	
 	float our_dist[size * size];
 	float opponent_dist[size * size];
@@ -325,8 +348,6 @@ darkforest_dcnn_eval(board_t *b, enum stone color, float result[])
 		/* planes 16-24: encode rank - set 9th plane for 9d */
 		data[24][y][x] = 1.0;
 	}
-
-	caffe_get_data((float*)data, result, size, 25, size);
 }
 #endif /* DCNN_DARKFOREST */
 
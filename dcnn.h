@@ -17,6 +17,13 @@ void disable_dcnn(void);
 
 void dcnn_evaluate(board_t *b, enum stone color, float result[]);
 void dcnn_evaluate_quiet(board_t *b, enum stone color, float result[]);
+
+/* Batch evaluation: dcnn_encode() positions into consecutive
+ * dcnn_input_size() float buffers, then evaluate @n of them at once.
+ * @result gets n * size * size values. */
+int  dcnn_input_size(board_t *b);
+void dcnn_encode(board_t *b, enum stone color, float *data);
+void dcnn_evaluate_batch(int size, float *data, float *result, int n);
 bool using_dcnn(board_t *b);
 void dcnn_init(board_t *b);
 void get_dcnn_best_moves(board_t *b, float *r, coord_t *best_c, float *best_r, int nbest);
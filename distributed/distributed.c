@@ -448,7 +448,7 @@ distributed_dead_group_list(engine_t *e, board_t *b, move_queue_t *mq)
 	char *dead = gtp_replies[best_reply];
 	dead = strchr(dead, ' '); // skip "id "
 	while (dead && *++dead != '\n') {
-		mq_add(mq, str2coord(dead), 0);
+		mq_add(mq, group_at(b, str2coord(dead)), 0);
 		dead = strchr(dead, '\n');
 	}
 	protocol_unlock();
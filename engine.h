@@ -92,7 +92,7 @@ struct engine {
 						     * simulate each move from b->f[i] for time @ti, then set
 						     * 1-max(opponent_win_likelihood) in vals[i]. */
 
-	engine_dead_group_list_t dead_group_list;   /* One dead group per queued move (coord_t is (ab)used as group_t). */
+	engine_dead_group_list_t dead_group_list;   /* One dead group id per queued move (not a coord !) */
 	engine_ownermap_t        ownermap;	    /* Return current ownermap, if engine supports it. */
 	engine_result_t          result;
 
@@ -10,6 +10,7 @@
 #include "../joseki.h"
 #include "playout/moggy.h"
 #include "playout/light.h"
+#include "playout/softmax.h"
 #include "engines/montecarlo.h"
 #include "playout.h"
 #include "timeinfo.h"
@@ -146,7 +147,7 @@ montecarlo_genmove(engine_t *e, board_t *b, time_info_t *ti, enum stone color, b
 		if (DEBUGL(3))
 			fprintf(stderr, "[%d,%d color %d] playing random game\n", coord_x(coord), coord_y(coord), color);
 
-		playout_setup_t ps = playout_setup(mc->gamelen, 0);
+		playout_setup_t ps = playout_setup(mc->gamelen, 0, false);
 		int result = playout_play_game(&ps, &b2, color, NULL, NULL, mc->playout);
 
 		board_done(&b2);
@@ -258,6 +259,8 @@ montecarlo_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 			mc->playout = playout_moggy_init(playoutarg, b);
 		else if (!strcasecmp(optval, "light"))
 			mc->playout = playout_light_init(playoutarg, b);
+		else if (!strcasecmp(optval, "softmax"))
+			mc->playout = playout_softmax_init(playoutarg, b);
 		else
 			option_error("MonteCarlo: Invalid playout policy %s\n", optval);
 	}
@@ -11,6 +11,7 @@
 #include "../joseki.h"
 #include "playout/light.h"
 #include "playout/moggy.h"
+#include "playout/softmax.h"
 #include "engines/replay.h"
 
 /* Internal engine state. */
@@ -168,6 +169,8 @@ replay_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 			r->playout = playout_moggy_init(playoutarg, b);
 		else if (!strcasecmp(optval, "light"))
 			r->playout = playout_light_init(playoutarg, b);
+		else if (!strcasecmp(optval, "softmax"))
+			r->playout = playout_softmax_init(playoutarg, b);
 		else
 			option_error("Replay: Invalid playout policy %s\n", optval);
 	}
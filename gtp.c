@@ -20,6 +20,7 @@
 #include "timeinfo.h"
 #include "ownermap.h"
 #include "gogui.h"
+#include "playout/moggy.h"
 #include "t-predict/predict.h"
 #include "t-unit/test.h"
 #include "fifo.h"
@@ -686,7 +687,7 @@ cmd_final_status_list_alive(char *arg, board_t *b, engine_t *e, gtp_t *gtp)
 	
 	foreach_point(b) { // foreach_group, effectively
 		group_t g = group_at(b, c);
-		if (!g || g != c) continue;
+		if (!g || group_base(b, g) != c) continue;
 
 		for (unsigned int i = 0; i < q.moves; i++)
 			if (q.move[i] == g)  goto next_group;
@@ -882,6 +883,29 @@ cmd_pachi_result(board_t *b, engine_t *e, time_info_t *ti, gtp_t *gtp)
 	return P_OK;
 }
 
+/* Moggy rule statistics, summed over all threads.
+ * "pachi-moggy_stats reset" clears them. */
+static enum parse_code
+cmd_pachi_moggy_stats(board_t *b, engine_t *e, time_info_t *ti, gtp_t *gtp)
+{
+	char *arg;
+	gtp_arg_optional(arg);
+	if (*arg) {
+		if (strcasecmp(arg, "reset")) {
+			gtp_error(gtp, "usage: pachi-moggy_stats [reset]");
+			return P_OK;
+		}
+		playout_moggy_stats_reset();
+		return P_OK;
+	}
+
+	strbuf(buf, 4096);
+	playout_moggy_stats(buf);
+	buf->str[strlen(buf->str) - 1] = 0;  /* No trailing newline */
+	gtp_reply(gtp, buf->str);
+	return P_OK;
+}
+
 static enum parse_code
 cmd_pachi_tunit(board_t *b, engine_t *e, time_info_t *ti, gtp_t *gtp)
 {
@@ -1012,6 +1036,7 @@ static gtp_command_t gtp_commands[] =
 	{ "pachi-evaluate",         cmd_pachi_evaluate },
 	{ "pachi-result",           cmd_pachi_result },
 	{ "pachi-score_est",        cmd_pachi_score_est },
+	{ "pachi-moggy_stats",      cmd_pachi_moggy_stats },
 	{ "pachi-setoption",	    cmd_pachi_setoption },  /* Set/change engine option */
 	{ "pachi-getoption",	    cmd_pachi_getoption },  /* Get engine option(s) */
 
@@ -3,8 +3,8 @@
 
 /* Move queues; in fact, they are more like move lists, usually used
  * to accumulate equally good move candidates, then choosing from them
- * randomly. But they are also used to juggle group lists (using the
- * fact that coord_t == group_t). */
+ * randomly. But they are also used to juggle group lists (group ids
+ * fit in a coord_t). */
 
 #include <assert.h>
 #include "fixp.h"
@@ -54,6 +54,22 @@ ownermap_fill(ownermap_t *ownermap, board_t *b)
 	} foreach_point_end;
 }
 
+void
+ownermap_merge(board_t *b, ownermap_t *dst, ownermap_t *src)
+{
+	if (!src->playouts)  return;
+	__sync_fetch_and_add(&dst->playouts, src->playouts);
+	foreach_point(b) {
+		if (board_at(b, c) == S_OFFBOARD)  continue;
+		for (enum stone color = S_NONE; color <= S_WHITE; color++) {
+			if (!src->map[c][color])  continue;
+			__sync_fetch_and_add(&dst->map[c][color], src->map[c][color]);
+			src->map[c][color] = 0;
+		}
+	} foreach_point_end;
+	src->playouts = 0;
+}
+
 float
 ownermap_estimate_point(ownermap_t *ownermap, coord_t c)
 {
@@ -126,7 +142,7 @@ groups_of_status(board_t *b, group_judgement_t *judge, enum gj_state s, move_que
 {
 	foreach_point(b) { /* foreach_group, effectively */
 		group_t g = group_at(b, c);
-		if (!g || g != c) continue;
+		if (!g || group_base(b, g) != c) continue;
 
 		assert(judge->gs[g] != GS_NONE);
 		if (judge->gs[g] == s)
@@ -47,6 +47,10 @@ typedef struct ownermap {
 void ownermap_init(ownermap_t *ownermap);
 void board_print_ownermap(board_t *b, FILE *f, ownermap_t *ownermap);
 void ownermap_fill(ownermap_t *ownermap, board_t *b);
+/* Add @src counts to @dst and clear @src. @dst may be shared with other
+ * threads: updates are atomic, and playouts are added first so readers
+ * may underestimate ownership for a moment but never overestimate it. */
+void ownermap_merge(board_t *b, ownermap_t *dst, ownermap_t *src);
 
 /* Coord ownermap status: dame / black / white / unclear */
 enum point_judgement ownermap_judge_point(ownermap_t *ownermap, coord_t c, floating_t thres);
@@ -20,6 +20,7 @@
 #include "engines/josekiplay.h"
 #include "engines/dcnn.h"
 #include "t-unit/test.h"
+#include "t-bench/bench.h"
 #include "uct/uct.h"
 #include "distributed/distributed.h"
 #include "gtp.h"
@@ -91,6 +92,8 @@ usage()
 	fprintf(stderr, "Usage: pachi [OPTIONS] [ENGINE_ARGS]\n\n");
 	fprintf(stderr,
 		"Options: \n"
+		"      --bench[=SIZE]                time hot code paths on fixed positions, json output \n"
+		"                                    (default size 19, or fixed board size) \n"
                 "      --compile-flags               show pachi's compile flags \n"
 		"  -e, --engine ENGINE               select engine (default uct). Supported engines: \n"
 		"                                    uct, dcnn, patternplay, replay, random, montecarlo, distributed \n"
@@ -197,7 +200,9 @@ show_version(FILE *s)
 #define OPT_KGS           268
 #define OPT_NAME          269
 #define OPT_LIST_DCNNS    270
+#define OPT_BENCH         271
 static struct option longopts[] = {
+	{ "bench",       optional_argument, 0, OPT_BENCH },
 	{ "fuseki-time", required_argument, 0, OPT_FUSEKI_TIME },
 	{ "fuseki",      required_argument, 0, OPT_FUSEKI },
 	{ "chatfile",    required_argument, 0, 'c' },
@@ -242,6 +247,7 @@ int main(int argc, char *argv[])
 	time_info_t ti_default = ti_none;
 	int  seed = time(NULL) ^ getpid();
 	char *testfile = NULL;
+	int  bench_size = 0;
 	char *log_port = NULL;
 	char *chatfile = NULL;
 	char *fbookfile = NULL;
@@ -261,6 +267,17 @@ int main(int argc, char *argv[])
 	/* Leading ':' -> we handle error messages. */
 	while ((opt = getopt_long(argc, argv, ":c:e:d:Df:g:hl:o:r:s:t:u:v::", longopts, &option_index)) != -1) {
 		switch (opt) {
+			case OPT_BENCH:
+#ifdef BOARD_SIZE
+				bench_size = (optarg ? atoi(optarg) : BOARD_SIZE);
+				if (bench_size != BOARD_SIZE)
+					die("%s: This Pachi only plays on %ix%i.\n", argv[0], BOARD_SIZE, BOARD_SIZE);
+#else
+				bench_size = (optarg ? atoi(optarg) : 19);
+				if (bench_size < 2 || bench_size > BOARD_MAX_SIZE)
+					die("%s: Invalid --bench size %s\n", argv[0], optarg);
+#endif
+				break;
 			case 'c':
 				chatfile = strdup(optarg);
 				break;
@@ -402,6 +419,7 @@ int main(int argc, char *argv[])
 	if (!verbose_caffe)      quiet_caffe(argc, argv);
 	if (log_port)            open_log_port(log_port);
 	if (testfile)		 return unit_test(testfile);
+	if (bench_size)		 return pachi_bench(bench_size);
 	if (DEBUGL(0))           show_version(stderr);
 	if (getenv("DATA_DIR"))
 		if (DEBUGL(1))   fprintf(stderr, "Using data dir %s\n", getenv("DATA_DIR"));
@@ -362,8 +362,8 @@ pattern_match_selfatari(board_t *b, move_t *m)
 static bool
 cutting_stones(board_t *b, group_t g)
 {
-	assert(g && group_at(b, g));
-	enum stone color = board_at(b, g);
+	assert(g && group_at(b, group_base(b, g)));
+	enum stone color = board_at(b, group_base(b, g));
 	enum stone other_color = stone_other(color);
 
 	foreach_in_group(b, g) {
@@ -389,9 +389,10 @@ cutting_stones_and_can_capture_other_after_atari(board_t *b, move_t *m, group_t
 {
 	bool found = false;
 	enum stone other_color = stone_other(m->color);
+	coord_t other_base = group_base(b, other);
 	
 	with_move(b, m->coord, m->color, {
-		assert(group_at(b, atariable) == atariable);
+		assert(group_at(b, group_base(b, atariable)) == atariable);
 		if (!cutting_stones(b, atariable))		break;
 		if (!cutting_stones(b, other))			break;
 		
@@ -403,7 +404,7 @@ cutting_stones_and_can_capture_other_after_atari(board_t *b, move_t *m, group_t
 		/* try possible replies, must work for all of them */
 		for (unsigned int i = 0; i < mq.moves; i++) {
 			with_move(b, mq.move[i], other_color, {
-				group_t g = group_at(b, other);
+				group_t g = group_at(b, other_base);
 				if (g && board_group_info(b, g).libs == 2 &&
 				    can_capture_2lib_group(b, g, NULL, 0))
 					found = true;
@@ -460,8 +461,8 @@ pattern_match_atari(board_t *b, move_t *m, ownermap_t *ownermap)
 				group_t g = group_at(b, m->coord);
 				group_t atari_neighbor;
 				if (g && capturing_group_is_snapback(b, g) &&
-				    (atari_neighbor = board_get_atari_neighbor(b, g, other_color)) &&
-				    ownermap_color(ownermap, atari_neighbor, 0.67) != m->color)  // XXX check other stones in group ?)
+				    (atari_neighbor = board_get_atari_neighbor(b, m->coord, other_color)) &&
+				    ownermap_color(ownermap, group_base(b, atari_neighbor), 0.67) != m->color)  // XXX check other stones in group ?)
 					snapback = true;
 		});
 	}
@@ -485,7 +486,7 @@ pattern_match_atari(board_t *b, move_t *m, ownermap_t *ownermap)
 		
 		if (wouldbe_ladder_any(b, g, m->coord)) {
 			ladder_atari = true;
-			enum stone gown = ownermap_color(ownermap, g, 0.67);
+			enum stone gown = ownermap_color(ownermap, group_base(b, g), 0.67);
 			enum stone aown = owner_around(b, ownermap, m->coord);
 			// capturing big group not dead yet
 			if (gown != color && group_stone_count(b, g, 5) >= 4)   ladder_big = true;
@@ -502,7 +503,7 @@ pattern_match_atari(board_t *b, move_t *m, ownermap_t *ownermap)
 
 	/* Can capture other group after atari ? */
 	if (g3libs && !ladder_atari &&
-	    ownermap_color(ownermap, g3libs, 0.67) != color &&
+	    ownermap_color(ownermap, group_base(b, g3libs), 0.67) != color &&
 	    cutting_stones_and_can_capture_other_after_atari(b, m, g1, g3libs))
 		atari_and_cap = true;
 
@@ -629,7 +630,7 @@ pattern_match_cut(board_t *b, move_t *m, ownermap_t *ownermap)
 		int found = 0;
 		for (int i = 0; i < ngroups; i++) {
 			group_t g = groups[i];
-			enum stone gown = ownermap_color(ownermap, g, 0.67);
+			enum stone gown = ownermap_color(ownermap, group_base(b, g), 0.67);
 			if (board_group_info(b, g).libs <= 3 && gown != m->color)
 				found++;
 		}
@@ -963,7 +964,7 @@ static void
 mcowner_playouts_(board_t *b, enum stone color, ownermap_t *ownermap, int playouts)
 {
 	static playout_policy_t *policy = NULL;
-	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0);
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
 	
 	if (!policy)  policy = playout_moggy_init(NULL, b);
 	ownermap_init(ownermap);
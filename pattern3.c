@@ -6,10 +6,53 @@
 #include "board.h"
 #include "debug.h"
 #include "pattern3.h"
+#include "util.h"
 
 
+/* Patterns get generated into a plain hash table first,
+ * then compiled into the compact pattern3s_t table. */
+
+typedef struct {
+	hash3_t pattern;
+	unsigned char value;
+} pattern2p_t;
+
+typedef struct {
+	/* In case of a collision, following hash entries are
+	 * used. value==0 indicates an unoccupied hash entry. */
+	/* The hash indices are zobrist hashes based on p3hashes. */
+#define pattern3_hash_bits 19
+#define pattern3_hash_size (1 << pattern3_hash_bits)
+#define pattern3_hash_mask (pattern3_hash_size - 1)
+	pattern2p_t hash[pattern3_hash_size];
+} pattern3_htable_t;
+
+/* Zobrist hashes for the various 3x3 points. */
+/* [point][is_atari][color] */
+static hash3_t p3hashes[8][2][S_MAX];
+
+static hash3_t
+hash3_to_hash(hash3_t pat)
+{
+	hash3_t h = 0;
+	static const int ataribits[8] = { -1, 0, -1, 1, 2, -1, 3, -1 };
+	for (int i = 0; i < 8; i++) {
+		h ^= p3hashes[i][ataribits[i] >= 0 ? (pat >> (16 + ataribits[i])) & 1 : 0][(pat >> (i*2)) & 3];
+	}
+	return (h & pattern3_hash_mask);
+}
+
+static int
+htable_value(pattern3_htable_t *p, hash3_t pat)
+{
+	hash3_t h = hash3_to_hash(pat);
+	while (p->hash[h].pattern != pat && p->hash[h].value)
+		h = (h + 1) & pattern3_hash_mask;
+	return p->hash[h].value;
+}
+
 static void
-pattern_record(pattern3s_t *p, int pi, char *str, hash3_t pat, int fixed_color)
+pattern_record(pattern3_htable_t *p, int pi, char *str, hash3_t pat, int fixed_color)
 {
 	hash3_t h = hash3_to_hash(pat);
 	while (p->hash[h].pattern != pat && p->hash[h].value)
@@ -106,7 +149,7 @@ pattern3_transpose(hash3_t pat, hash3_t (*transp)[8])
 }
 
 static void
-pattern_gen(pattern3s_t *p, int pi, hash3_t pat, char *src, int srclen, int fixed_color)
+pattern_gen(pattern3_htable_t *p, int pi, hash3_t pat, char *src, int srclen, int fixed_color)
 {
 	for (; srclen > 0; src++, srclen--) {
 		if (srclen == 5)
@@ -218,7 +261,7 @@ pattern_gen(pattern3s_t *p, int pi, hash3_t pat, char *src, int srclen, int fixe
 }
 
 static void
-patterns_gen(pattern3s_t *p, char src[][11], int src_n)
+patterns_gen(pattern3_htable_t *p, char src[][11], int src_n)
 {
 	for (int i = 0; i < src_n; i++) {
 		//printf("<%s>\n", src[i]);
@@ -257,6 +300,43 @@ error:
 	return false;
 }
 
+/* Compile hash table into compact table. */
+static void
+pattern3s_compile(pattern3s_t *p, pattern3_htable_t *h)
+{
+	/* Values by color configuration / atari bits. */
+	typedef uint8_t block_t[16];
+	block_t *values = calloc2(1 << 16, block_t);
+	for (int i = 0; i < pattern3_hash_size; i++)
+		if (h->hash[i].value)
+			values[h->hash[i].pattern & 0xffff][h->hash[i].pattern >> 16] = h->hash[i].value;
+
+	memset(p, 0, sizeof(*p));
+	int n = 0, blocks = 0;
+	for (int colors = 0; colors < (1 << 16); colors++) {
+		if (!(colors & 63))
+			p->rank[colors >> 6] = n;
+
+		uint8_t zero[16] = { 0, };
+		if (!memcmp(values[colors], zero, sizeof(zero)))
+			continue;
+
+		int b;
+		for (b = 0; b < blocks; b++)
+			if (!memcmp(p->values[b], values[colors], 16))
+				break;
+		if (b == blocks) {
+			if (blocks == PAT3_MAX_BLOCKS)
+				die("pattern3: too many different pattern blocks, max %i\n", PAT3_MAX_BLOCKS);
+			memcpy(p->values[blocks++], values[colors], 16);
+		}
+
+		p->colors[colors >> 6] |= 1ULL << (colors & 63);
+		p->block[n++] = b;
+	}
+	free(values);
+}
+
 void
 pattern3s_init(pattern3s_t *p, char src[][11], int src_n)
 {
@@ -268,10 +348,36 @@ pattern3s_init(pattern3s_t *p, char src[][11], int src_n)
 			strcpy(nsrc[i], src[i]);
 	}
 
-	patterns_gen(p, nsrc, src_n);
+	pattern3_htable_t *h = calloc2(1, pattern3_htable_t);
+	patterns_gen(h, nsrc, src_n);
+	pattern3s_compile(p, h);
+	free(h);
 }
 
-hash3_t p3hashes[8][2][S_MAX];
+bool
+pattern3s_check(char src[][11], int src_n)
+{
+	char nsrc[src_n][11];
+	memcpy(nsrc, src, sizeof(nsrc));   /* patterns_gen() needs writable copy */
+
+	pattern3_htable_t *h = calloc2(1, pattern3_htable_t);
+	pattern3s_t *p = calloc2(1, pattern3s_t);
+	patterns_gen(h, nsrc, src_n);
+	pattern3s_compile(p, h);
+
+	int errors = 0;
+	for (hash3_t pat = 0; pat < (1 << 20); pat++) {
+		int value = htable_value(h, pat);
+		if (pattern3_value(p, pat) == value)
+			continue;
+		if (errors++ < 10)
+			fprintf(stderr, "pattern3: %05x: value %#x, expected %#x\n", pat, pattern3_value(p, pat), value);
+	}
+
+	free(p);
+	free(h);
+	return !errors;
+}
 
 static __attribute__((constructor)) void
 p3hashes_init(void)
@@ -20,25 +20,22 @@
 
 /* XXX: See <board.h> for hash3_t typedef. */
 
-typedef struct {
-	hash3_t pattern;
-	unsigned char value;
-} pattern2p_t;
+/* Compact pattern table: maps hash3_t pattern to value (0: no match).
+ * Color part of the pattern (16 bits) selects a block of 16 values,
+ * indexed by atari bits. Only color configurations matching some pattern
+ * get a block: bitmap + rank lookup, identical blocks are shared.
+ * Moggy patterns use ~45k (16k color configurations, 80 blocks) so it
+ * stays in cache, and there are no collisions. */
+#define PAT3_COLORS_WORDS  ((1 << 16) / 64)
+#define PAT3_MAX_BLOCKS    4096
 
 typedef struct {
-	/* In case of a collision, following hash entries are
-	 * used. value==0 indicates an unoccupied hash entry. */
-	/* The hash indices are zobrist hashes based on p3hashes. */
-#define pattern3_hash_bits 19
-#define pattern3_hash_size (1 << pattern3_hash_bits)
-#define pattern3_hash_mask (pattern3_hash_size - 1)
-	pattern2p_t hash[pattern3_hash_size];
+	uint64_t colors[PAT3_COLORS_WORDS];      /* Color configurations with some match */
+	uint16_t rank[PAT3_COLORS_WORDS];        /* Bits set in colors[] before each word */
+	uint16_t block[1 << 16];                 /* Block of each color configuration (by rank) */
+	uint8_t  values[PAT3_MAX_BLOCKS][16];    /* Pattern value for each atari bits combination */
 } pattern3s_t;
 
-/* Zobrist hashes for the various 3x3 points. */
-/* [point][is_atari][color] */
-extern hash3_t p3hashes[8][2][S_MAX];
-
 /* Source pattern encoding:
  * X: black;  O: white;  .: empty;  #: edge
  * x: !black; o: !white; ?: any
@@ -52,9 +49,16 @@ extern hash3_t p3hashes[8][2][S_MAX];
 
 void pattern3s_init(pattern3s_t *p, char src[][11], int src_n);
 
+/* Check table built from @src gives same results as a plain hash table
+ * of all patterns for every possible hash3_t. */
+bool pattern3s_check(char src[][11], int src_n);
+
 /* Compute pattern3 hash at local position. */
 static hash3_t pattern3_hash(board_t *b, coord_t c);
 
+/* Pattern value for given pattern3 hash (0: no match). */
+static int pattern3_value(pattern3s_t *p, hash3_t pat);
+
 /* Check if we match any 3x3 pattern centered on given move. */
 static bool pattern3_move_here(pattern3s_t *p, board_t *b, move_t *m, char *idx);
 
@@ -97,20 +101,30 @@ pattern3_hash(board_t *b, coord_t c)
 #undef atari_at
 }
 
-static inline __attribute__((const)) hash3_t
-hash3_to_hash(hash3_t pat)
+static inline int
+pattern3_value(pattern3s_t *p, hash3_t pat)
 {
-	hash3_t h = 0;
-	static const int ataribits[8] = { -1, 0, -1, 1, 2, -1, 3, -1 };
-	for (int i = 0; i < 8; i++) {
-		h ^= p3hashes[i][ataribits[i] >= 0 ? (pat >> (16 + ataribits[i])) & 1 : 0][(pat >> (i*2)) & 3];
-	}
-	return (h & pattern3_hash_mask);
+	int colors = pat & 0xffff;
+	uint64_t word = p->colors[colors >> 6];
+	uint64_t bit = 1ULL << (colors & 63);
+	if (!(word & bit))
+		return 0;
+	int i = p->rank[colors >> 6] + __builtin_popcountll(word & (bit - 1));
+	return p->values[p->block[i]][pat >> 16];
 }
 
 static inline bool
 pattern3_move_here(pattern3s_t *p, board_t *b, move_t *m, char *idx)
 {
+#ifdef BOARD_PAT3
+	hash3_t pat = b->pat3[m->coord];
+#ifdef PAT3_SHORT_CIRCUIT
+	/* Nothing can match if there's no black stones or no white stones around.
+	 * (black: 01, white: 10, offboard: 11) */
+	if (!(pat & ~(pat >> 1) & 0x5555) || !((pat >> 1) & ~pat & 0x5555))
+		return false;
+#endif
+#else
 	coord_t c = m->coord;
 	int stride = board_stride(b);
 	int c1 = board_at(b, c - stride - 1);
@@ -125,17 +139,11 @@ pattern3_move_here(pattern3s_t *p, board_t *b, move_t *m, char *idx)
 		return false;
 #endif
 
-#ifdef BOARD_PAT3
-	hash3_t pat = b->pat3[m->coord];
-#else
 	hash3_t pat = pattern3_hash(b, m->coord);
 #endif
-	hash3_t h = hash3_to_hash(pat);
-
-	while (p->hash[h].pattern != pat && p->hash[h].value)
-		h = (h + 1) & pattern3_hash_mask;
-	if (p->hash[h].value & m->color) {
-		*idx = p->hash[h].value >> 2;
+	int value = pattern3_value(p, pat);
+	if (value & m->color) {
+		*idx = value >> 2;
 		return true;
 	}
 
@@ -168,114 +168,243 @@ fill_bent_four(board_t *b, enum stone color, coord_t *other, coord_t *kill)
 	return pass;
 }
 
-#define random_game_loop_stuff  \
-		if (PLDEBUGL(7)) { \
-			fprintf(stderr, "%s %s\n", stone2str(color), coord2sstr(coord)); \
-			if (PLDEBUGL(8)) board_print(b, stderr); \
-		} \
-\
-		if (unlikely(is_pass(coord)))  passes++; \
-		else                           passes = 0; \
-\
-		if (amafmap) { \
-			assert(amafmap->gamelen < MAX_GAMELEN); \
-			amafmap->is_ko_capture[amafmap->gamelen] = board_playing_ko_threat(b); \
-			amafmap->game[amafmap->gamelen++] = coord; \
-		} \
-\
-		if (setup->mercymin && abs(b->captures[S_BLACK] - b->captures[S_WHITE]) > setup->mercymin) \
-			break; \
-\
-		color = stone_other(color);
-
+/* Recent playout positions, for cycle detection (setup->cycle_check).
+ * Only short cycles matter (triple ko, sending two returning one ...)
+ * A position can come back by accident (captures then refill), so
+ * playout stops only after a few repetitions: real cycles go on forever. */
+#define PLAYOUT_CYCLE_HISTORY 16
+#define PLAYOUT_CYCLE_REPEATS 3
+
+typedef struct {
+	hash_t hash[PLAYOUT_CYCLE_HISTORY];
+	int next;
+	int repeats;
+} playout_cycles_t;
+
+static void
+playout_cycles_init(playout_cycles_t *cy, board_t *b)
+{
+	memset(cy, 0, sizeof(*cy));
+	cy->hash[cy->next++] = b->hash;
+}
 
+/* Record new position, returns true if we're going around in circles. */
+static bool
+playout_cycle(playout_cycles_t *cy, hash_t hash)
+{
+	for (int i = 0; i < PLAYOUT_CYCLE_HISTORY; i++)
+		if (unlikely(cy->hash[i] == hash))
+			return (++cy->repeats >= PLAYOUT_CYCLE_REPEATS);
+	cy->hash[cy->next] = hash;
+	cy->next = (cy->next + 1) % PLAYOUT_CYCLE_HISTORY;
+	return false;
+}
 
-int
-playout_play_game(playout_setup_t *setup,
-		  board_t *b, enum stone starting_color,
-		  playout_amafmap_t *amafmap,
-		  ownermap_t *ownermap,
-		  playout_policy_t *policy)
+/* Playout state, so that games can also be played one move at a time
+ * (playout_play_games()). */
+typedef struct {
+	board_t *b;
+	enum stone starting_color;
+	enum stone color;
+	playout_amafmap_t *amafmap;
+	ownermap_t *ownermap;
+	int gamelen;
+	int passes;
+	int starting_passes[S_MAX];
+	bool bent4_phase;  /* Play some more handling bent-fours, see below */
+	int bent4_moves;
+	coord_t bent4_other;
+	coord_t bent4_kill;
+	playout_cycles_t cycles_, *cycles;
+} playout_game_t;
+
+static void
+playout_game_start(playout_game_t *g, playout_setup_t *setup,
+		   board_t *b, enum stone starting_color,
+		   playout_amafmap_t *amafmap,
+		   ownermap_t *ownermap,
+		   playout_policy_t *policy)
 {
 	b->playout_board = true;   // don't need board hash, history, symmetry...
 
-	int starting_passes[S_MAX];
-	memcpy(starting_passes, b->passes, sizeof(starting_passes));
+	g->b = b;
+	g->starting_color = g->color = starting_color;
+	g->amafmap = amafmap;
+	g->ownermap = ownermap;
+	memcpy(g->starting_passes, b->passes, sizeof(g->starting_passes));
 
 	assert(setup && policy);
-	int gamelen = setup->gamelen - b->moves;
+	g->gamelen = setup->gamelen - b->moves;
+
+	g->cycles = NULL;
+	if (setup->cycle_check) {
+		b->playout_hash = true;
+		g->cycles = &g->cycles_;
+		playout_cycles_init(g->cycles, b);
+	}
 
 	if (policy->setboard)
 		policy->setboard(policy, b);
-#ifdef DEBUGL_BY_PLAYOUT
-	int debug_level_orig = debug_level;
-	debug_level = policy->debug_level;
-#endif
 
-	enum stone color = starting_color;
-	int passes = is_pass(last_move(b).coord) && b->moves > 0;
+	g->passes = is_pass(last_move(b).coord) && b->moves > 0;
+	g->bent4_phase = false;
+	g->bent4_moves = -2;
+	g->bent4_other = g->bent4_kill = pass;
+}
+
+/* Stop current phase: on to bent-four phase, or game over. */
+static bool
+playout_game_break(playout_game_t *g)
+{
+	if (g->bent4_phase)
+		return false;
+	g->bent4_phase = true;
+	g->passes = 0;
+	return true;
+}
+
+/* Play one move. Returns false when game is over. */
+static inline bool
+playout_game_step(playout_game_t *g, playout_setup_t *setup, playout_policy_t *policy)
+{
+	board_t *b = g->b;
+	enum stone color = g->color;
 
 	/* Play until both sides pass, or we hit threshold. */
-	while (gamelen-- > 0 && passes < 2) {
-		coord_t coord = playout_play_move(setup, b, color, policy);		
-		random_game_loop_stuff
-	}	
-
-	int bent4_moves = -2;
-	coord_t bent4_other = pass;
-	coord_t bent4_kill = pass;
-
-	/* Play some more, handling bent-fours this time ...
-	 * FIXME bent-four code really belongs in moggy but needs to be handled here.
-	 *       Add some hooks and move this to moggy.c ... */
-	passes = 0;
-	while (gamelen-- > 0 && passes < 2) {
-		coord_t coord;
-		
+	while (!(g->gamelen-- > 0 && g->passes < 2))
+		if (!playout_game_break(g))
+			return false;
+
+	coord_t coord;
+	if (!g->bent4_phase)
+		coord = playout_play_move(setup, b, color, policy);
+	else {
+		/* Play some more, handling bent-fours this time ...
+		 * FIXME bent-four code really belongs in moggy but needs to be handled here.
+		 *       Add some hooks and move this to moggy.c ... */
+
 		/* Kill bent-four group after filling. */
-		if (b->moves == bent4_moves + 1) {
+		if (b->moves == g->bent4_moves + 1) {
 			/* Capture or kill group. */
-			coord = (board_at(b, bent4_other) == S_NONE ? bent4_other : bent4_kill);
+			coord = (board_at(b, g->bent4_other) == S_NONE ? g->bent4_other : g->bent4_kill);
 			move_t m = move(coord, color);
 			int r = board_play(b, &m);  assert(r == 0);
 		}
 		else    coord = playout_play_move(setup, b, color, policy);
-		
+
 		/* Fill bent-fours */
-		if (coord == pass && (coord = fill_bent_four(b, stone_other(color), &bent4_other, &bent4_kill)) != pass) {
+		if (coord == pass && (coord = fill_bent_four(b, stone_other(color), &g->bent4_other, &g->bent4_kill)) != pass) {
 			move_t m = move(coord, color);
 			int r = board_play(b, &m);  assert(r == 0);
-			bent4_moves = b->moves;
+			g->bent4_moves = b->moves;
 		}
+	}
 
-		random_game_loop_stuff
+	if (PLDEBUGL(7)) {
+		fprintf(stderr, "%s %s\n", stone2str(color), coord2sstr(coord));
+		if (PLDEBUGL(8)) board_print(b, stderr);
 	}
-	
+
+	if (unlikely(is_pass(coord)))  g->passes++;
+	else                           g->passes = 0;
+
+	playout_amafmap_t *amafmap = g->amafmap;
+	if (amafmap) {
+		assert(amafmap->gamelen < MAX_GAMELEN);
+		amafmap->is_ko_capture[amafmap->gamelen] = board_playing_ko_threat(b);
+		amafmap->game[amafmap->gamelen++] = coord;
+	}
+
+	/* Color doesn't change on break: same player starts next phase. */
+	if (setup->mercymin && abs(b->captures[S_BLACK] - b->captures[S_WHITE]) > setup->mercymin)
+		return playout_game_break(g);
+
+	/* Position repeats, playout would go on forever. */
+	if (g->cycles && !is_pass(coord) && playout_cycle(g->cycles, b->hash)) {
+		g->gamelen = 0;
+		return playout_game_break(g);
+	}
+
+	g->color = stone_other(color);
+
+	return true;
+}
+
+static int
+playout_game_result(playout_game_t *g)
+{
+	board_t *b = g->b;
+
 	/* Territory scoring: score starting board, using playouts as confirmation phase.
 	 * Like in a real game where players disagree about life and death:
 	 * They play it out and rewind state for scoring once agreement is reached.
 	 * Trying to score final boards directly is too noisy, random passes change the score...
 	 * TODO: handle eyes in seki according to japanese rules. */
 	if (b->rules == RULES_JAPANESE) {
-		memcpy(b->passes, starting_passes, sizeof(starting_passes));
-		last_move(b).color = stone_other(starting_color);
+		memcpy(b->passes, g->starting_passes, sizeof(g->starting_passes));
+		last_move(b).color = stone_other(g->starting_color);
 	}
 	
 	floating_t score = board_fast_score(b);
-	int result = (starting_color == S_WHITE ? score * 2 : - (score * 2));
+	int result = (g->starting_color == S_WHITE ? score * 2 : - (score * 2));
 
 	if (DEBUGL(6)) {
 		fprintf(stderr, "Random playout result: %d (W %f)\n", result, score);
 		if (DEBUGL(7))  board_print(b, stderr);
 	}
 
-	if (ownermap)  ownermap_fill(ownermap, b);
+	if (g->ownermap)  ownermap_fill(g->ownermap, b);
+
+	return result;
+}
+
+int
+playout_play_game(playout_setup_t *setup,
+		  board_t *b, enum stone starting_color,
+		  playout_amafmap_t *amafmap,
+		  ownermap_t *ownermap,
+		  playout_policy_t *policy)
+{
+	playout_game_t g;
+	playout_game_start(&g, setup, b, starting_color, amafmap, ownermap, policy);
+#ifdef DEBUGL_BY_PLAYOUT
+	int debug_level_orig = debug_level;
+	debug_level = policy->debug_level;
+#endif
+
+	while (playout_game_step(&g, setup, policy))
+		;
 
 #ifdef DEBUGL_BY_PLAYOUT
 	debug_level = debug_level_orig;
 #endif
+	return playout_game_result(&g);
+}
 
-	return result;
+void
+playout_play_games(playout_setup_t *setup, int n,
+		   board_t **b, enum stone *starting_color,
+		   playout_amafmap_t **amafmap,
+		   ownermap_t *ownermap,
+		   playout_policy_t *policy, int *result)
+{
+	assert(n > 0 && n <= PLAYOUT_LOCKSTEP_MAX);
+	playout_game_t games[PLAYOUT_LOCKSTEP_MAX];
+	playout_game_t *live[PLAYOUT_LOCKSTEP_MAX];
+	for (int i = 0; i < n; i++) {
+		playout_game_start(&games[i], setup, b[i], starting_color[i],
+				   (amafmap ? amafmap[i] : NULL), ownermap, policy);
+		live[i] = &games[i];
+	}
+
+	/* One move in each game in turn, drop finished games. */
+	for (int nlive = n; nlive; )
+		for (int i = 0; i < nlive; )
+			if (playout_game_step(live[i], setup, policy))  i++;
+			else					live[i] = live[--nlive];
+
+	for (int i = 0; i < n; i++)
+		result[i] = playout_game_result(&games[i]);
 }
 
 
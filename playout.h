@@ -18,8 +18,8 @@ typedef struct playout_setup playout_setup_t;
  * (but not assess/permit calls!) will all be made on the same board; if
  * setboard is used, it is guaranteed that choose will pick all moves played
  * on the board subsequently. The routine is expected to initialize b->ps
- * with internal data. b->ps will be simply free()d when board is destroyed,
- * so make sure all data is within single allocated block. */
+ * with internal data, in a single block from board_ps_alloc(). It is
+ * released when board is destroyed. */
 typedef void (*playoutp_setboard)(playout_policy_t *playout_policy, board_t *b);
 
 /* Pick the next playout simulation move. */
@@ -70,9 +70,12 @@ struct playout_setup {
 	/* Minimal difference between captures to terminate the playout.
 	 * 0 means don't check. */
 	int mercymin;
+	/* Stop playout when a position repeats (long ko fights, triple kos...)
+	 * instead of going on until gamelen. Maintains board hash in playouts. */
+	bool cycle_check;
 };
 
-#define playout_setup(gamelen, mercymin)  { gamelen, mercymin }
+#define playout_setup(gamelen, mercymin, cycle_check)  { gamelen, mercymin, cycle_check }
 
 typedef struct {
 	/* We keep record of the game so that we can
@@ -98,6 +101,17 @@ int playout_play_game(playout_setup_t *setup,
 		      ownermap_t *ownermap,
 		      playout_policy_t *policy);
 
+/* Play @n games in lockstep, one move in each game in turn, instead of
+ * one game after the other. Same as calling playout_play_game() on each
+ * board, @result gets the return values. Policy must keep its playout
+ * state in b->ps (setboard) if it has any. */
+#define PLAYOUT_LOCKSTEP_MAX 16
+void playout_play_games(playout_setup_t *setup, int n,
+			board_t **b, enum stone *starting_color,
+			playout_amafmap_t **amafmap,
+			ownermap_t *ownermap,
+			playout_policy_t *policy, int *result);
+
 /* Play move returned by playout policy, or a randomly picked move if there was none. */
 coord_t playout_play_move(playout_setup_t *setup,
 			  board_t *b, enum stone color,
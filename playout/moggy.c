@@ -2,12 +2,15 @@
  * the description of the Mogo engine. */
 
 #include <assert.h>
+#include <inttypes.h>
 #include <math.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 
 #define DEBUG
 #include "board.h"
+#include "board_kernel.h"
 #include "debug.h"
 #include "joseki.h"
 #include "mq.h"
@@ -22,10 +25,18 @@
 #include "tactics/nakade.h"
 #include "tactics/selfatari.h"
 #include "tactics/seki.h"
+#include "timeinfo.h"
 #include "uct/prior.h"
 
 #define PLDEBUGL(n) DEBUGL_(p->debug_level, n)
 
+/* Playout code is size specialized, see board_kernel.h */
+#ifdef BOARD_KERNEL_DISPATCH
+BOARD_KERNEL_TABLE(coord_t, playout_moggy_seqchoose, (playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play));
+BOARD_KERNEL_TABLE(coord_t, playout_moggy_fullchoose, (playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play));
+BOARD_KERNEL_TABLE(bool,    playout_moggy_permit, (playout_policy_t *p, board_t *b, move_t *m, bool alt, bool random_move));
+#endif
+
 /* Use joseki moves in moggy ? */
 //#define MOGGY_JOSEKI 1
 
@@ -99,13 +110,75 @@ typedef struct {
 	double mq_prob[MQ_MAX], tenuki_prob;
 } moggy_policy_t;
 
+/* Rule statistics (pachi-moggy_stats): for each rule, how many times it
+ * was tried, candidate moves found, moves it picked and time spent in it.
+ * Counters are per thread (no locking in playouts), summed when reported.
+ * Only 1 in MOGGY_STATS_SAMPLE calls of each rule is timed. */
+enum moggy_rule {
+	MR_KO = 0,
+	MR_LATARI,
+	MR_LADDER,
+	MR_SELFATARI,	/* 2lib capture after rejected selfatari */
+	MR_L2LIB,
+	MR_LNLIB,
+	MR_EYEFIX,
+	MR_NAKADE,
+	MR_PAT3,
+	MR_GATARI,
+	MR_JOSEKI,
+	MR_FILLBOARD,
+	MR_PERMIT,	/* permit(): hits = moves rejected, candidates = redirects */
+	MR_MAX
+};
+
+#define MOGGY_STATS_SAMPLE 16
+
+typedef struct {
+	uint64_t tried, candidates, hits;
+	uint64_t timed, ticks;
+} moggy_rule_stats_t;
+
+typedef struct moggy_stats {
+	uint64_t playouts, moves, random;
+	moggy_rule_stats_t rule[MR_MAX];
+	struct moggy_stats *next;
+} moggy_stats_t;
+
+/* Returns start time if this call is timed, 0 otherwise. */
+static inline uint64_t
+rule_start(moggy_stats_t *s, enum moggy_rule r)
+{
+	return (s->rule[r].tried++ % MOGGY_STATS_SAMPLE ? 0 : ticks_now());
+}
+
+static inline void
+rule_end(moggy_stats_t *s, enum moggy_rule r, uint64_t start, int candidates)
+{
+	moggy_rule_stats_t *rs = &s->rule[r];
+	rs->candidates += candidates;
+	if (start) {
+		rs->ticks += ticks_now() - start;
+		rs->timed++;
+	}
+}
+
+static inline coord_t
+rule_hit(moggy_stats_t *s, enum moggy_rule r, coord_t c)
+{
+	s->rule[r].hits++;
+	return c;
+}
+
 /* Per simulation state (moggy_policy is shared by all threads) */
 typedef struct {
 	/* Selfatari move rejected by permit() during the last move(s).
 	 * Logic may not kick in immediately so we have room for both colors. */
 	coord_t last_selfatari[S_MAX];
+	/* Current thread's rule statistics. */
+	moggy_stats_t *stats;
 } moggy_state_t;
 
+#ifndef BOARD_KERNEL
 static char moggy_patterns_src[PAT3_N][11] = {
 	/* hane pattern - enclosing hane */	/* 0.52 */
 	"XOX"
@@ -185,6 +258,7 @@ static char moggy_patterns_src[PAT3_N][11] = {
 #endif
 };
 #define moggy_patterns_src_n sizeof(moggy_patterns_src) / sizeof(moggy_patterns_src[0])
+#endif
 
 static inline bool
 test_pattern3_here(playout_policy_t *p, board_t *b, move_t *m, bool middle_ladder, fixp_t *gamma)
@@ -270,7 +344,7 @@ global_atari_check(playout_policy_t *p, board_t *b, enum stone to_play, move_que
 	moggy_policy_t *pp = (moggy_policy_t*)p->data;
 	if (pp->capcheckall) {
 		for (int g = 0; g < b->clen; g++)
-			group_atari_check(pp->alwaysccaprate, b, group_at(b, group_base(b->c[g])), to_play, q, NULL, pp->middle_ladder, 1<<MQ_GATARI);
+			group_atari_check(pp->alwaysccaprate, b, b->c[g], to_play, q, NULL, pp->middle_ladder, 1<<MQ_GATARI);
 		if (PLDEBUGL(5))
 			mq_print(q, "Global atari");
 		if (pp->fullchoose)
@@ -279,7 +353,7 @@ global_atari_check(playout_policy_t *p, board_t *b, enum stone to_play, move_que
 
 	int g_base = fast_random(b->clen);
 	for (int g = g_base; g < b->clen; g++) {
-		group_atari_check(pp->alwaysccaprate, b, group_at(b, group_base(b->c[g])), to_play, q, NULL, pp->middle_ladder, 1<<MQ_GATARI);
+		group_atari_check(pp->alwaysccaprate, b, b->c[g], to_play, q, NULL, pp->middle_ladder, 1<<MQ_GATARI);
 		if (q->moves > 0) {
 			/* XXX: Try carrying on. */
 			if (PLDEBUGL(5))
@@ -289,7 +363,7 @@ global_atari_check(playout_policy_t *p, board_t *b, enum stone to_play, move_que
 		}
 	}
 	for (int g = 0; g < g_base; g++) {
-		group_atari_check(pp->alwaysccaprate, b, group_at(b, group_base(b->c[g])), to_play, q, NULL, pp->middle_ladder, 1<<MQ_GATARI);
+		group_atari_check(pp->alwaysccaprate, b, b->c[g], to_play, q, NULL, pp->middle_ladder, 1<<MQ_GATARI);
 		if (q->moves > 0) {
 			/* XXX: Try carrying on. */
 			if (PLDEBUGL(5))
@@ -318,7 +392,7 @@ local_atari_check(playout_policy_t *p, board_t *b, move_t *m, move_queue_t *q)
 
 		// Always defend big groups
 		enum stone to_play = stone_other(m->color);
-		enum stone color = board_at(b, group_base(g));
+		enum stone color = board_at(b, group_base(b, g));
 		if (to_play == color &&			// Defender
 		    group_stone_count(b, g, 5) >= 3)
 			force = true;
@@ -597,13 +671,21 @@ next_try:
 	return pass;
 }
 
-static coord_t
-playout_moggy_seqchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play)
+kernel_static coord_t
+KERNEL(playout_moggy_seqchoose)(playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play)
 {
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel)
+		return board_kernel(playout_moggy_seqchoose)(p, s, b, to_play);
+#endif
+
 	moggy_policy_t *pp = (moggy_policy_t*)p->data;
 	moggy_state_t *ps = (moggy_state_t*)b->ps;
+	moggy_stats_t *st = ps->stats;
 	enum stone other_color = stone_other(to_play);
 
+	st->moves++;
+
 	if (PLDEBUGL(5))
 		board_print(b, stderr);
 
@@ -611,9 +693,12 @@ playout_moggy_seqchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, enu
 	if (!is_pass(b->last_ko.coord) && is_pass(b->ko.coord)
 	    && b->moves - b->last_ko_age < pp->koage
 	    && pp->korate > fast_random(100)) {
-		if (board_is_valid_play(b, to_play, b->last_ko.coord)
-		    && !is_bad_selfatari(b, to_play, b->last_ko.coord))
-			return b->last_ko.coord;
+		uint64_t t = rule_start(st, MR_KO);
+		bool ok = (board_is_valid_play(b, to_play, b->last_ko.coord)
+			   && !is_bad_selfatari(b, to_play, b->last_ko.coord));
+		rule_end(st, MR_KO, t, ok);
+		if (ok)
+			return rule_hit(st, MR_KO, b->last_ko.coord);
 	}
 
 	/* Local checks */
@@ -621,17 +706,21 @@ playout_moggy_seqchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, enu
 		/* Local group in atari? */
 		if (true) {  // pp->lcapturerate check in local_atari_check()
 			move_queue_t q;  mq_init(&q);
-			if (local_atari_check(p, b, &last_move(b), &q) && 
-			    q.moves > 0)
-				return mq_pick(&q);
+			uint64_t t = rule_start(st, MR_LATARI);
+			bool force = local_atari_check(p, b, &last_move(b), &q);
+			rule_end(st, MR_LATARI, t, q.moves);
+			if (force && q.moves > 0)
+				return rule_hit(st, MR_LATARI, mq_pick(&q));
 		}
 
 		/* Local group trying to escape ladder? */
 		if (pp->ladderrate > fast_random(100)) {
 			move_queue_t q;  mq_init(&q);
+			uint64_t t = rule_start(st, MR_LADDER);
 			local_ladder_check(p, b, &last_move(b), &q);
+			rule_end(st, MR_LADDER, t, q.moves);
 			if (q.moves > 0)
-				return mq_pick(&q);
+				return rule_hit(st, MR_LADDER, mq_pick(&q));
 		}
 
 		/* Did we just reject selfatari move as opponent ?
@@ -641,52 +730,64 @@ playout_moggy_seqchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, enu
 			move_queue_t q;  mq_init(&q);
 			move_t m = move(ps->last_selfatari[other_color], other_color);			
 			ps->last_selfatari[other_color] = 0;  /* Clear */
+			uint64_t t = rule_start(st, MR_SELFATARI);
 			local_2lib_capture_check(p, b, &m, &q);
+			rule_end(st, MR_SELFATARI, t, q.moves);
 			if (q.moves > 0)
-				return mq_pick(&q);
+				return rule_hit(st, MR_SELFATARI, mq_pick(&q));
 		}
 
 		/* Local group can be PUT in atari? */
 		if (pp->atarirate > fast_random(100)) {
 			move_queue_t q;  mq_init(&q);
+			uint64_t t = rule_start(st, MR_L2LIB);
 			local_2lib_check(p, b, &last_move(b), &q);
+			rule_end(st, MR_L2LIB, t, q.moves);
 			if (q.moves > 0)
-				return mq_pick(&q);
+				return rule_hit(st, MR_L2LIB, mq_pick(&q));
 		}
 
 		/* Local group reduced some of our groups to 3 libs? */
 		if (pp->nlibrate > fast_random(100)) {
 			move_queue_t q;  mq_init(&q);
+			uint64_t t = rule_start(st, MR_LNLIB);
 			local_nlib_check(p, b, &last_move(b), &q);
+			rule_end(st, MR_LNLIB, t, q.moves);
 			if (q.moves > 0)
-				return mq_pick(&q);
+				return rule_hit(st, MR_LNLIB, mq_pick(&q));
 		}
 
 		/* Some other semeai-ish shape checks */
 		if (pp->eyefixrate > fast_random(100)) {
 			move_queue_t q;  mq_init(&q);
+			uint64_t t = rule_start(st, MR_EYEFIX);
 			eye_fix_check(p, b, &last_move(b), to_play, &q);
+			rule_end(st, MR_EYEFIX, t, q.moves);
 			if (q.moves > 0)
-				return mq_pick(&q);
+				return rule_hit(st, MR_EYEFIX, mq_pick(&q));
 		}
 
 		/* Nakade check */
 		if (pp->nakaderate > fast_random(100)
 		    && immediate_liberty_count(b, last_move(b).coord) > 0) {
+			uint64_t t = rule_start(st, MR_NAKADE);
 			coord_t nakade = nakade_check(p, b, &last_move(b), to_play);
+			rule_end(st, MR_NAKADE, t, !is_pass(nakade));
 			if (!is_pass(nakade))
-				return nakade;
+				return rule_hit(st, MR_NAKADE, nakade);
 		}
 
 		/* Check for patterns we know */
 		if (pp->patternrate > fast_random(100)) {
 			move_queue_t q;  mq_init(&q);
 			fixp_t gammas[MQL];
+			uint64_t t = rule_start(st, MR_PAT3);
 			apply_pattern(p, b, &last_move(b),
 			                  pp->pattern2 && last_move2(b).coord >= 0 ? &last_move2(b) : NULL,
 					  &q, gammas);
+			rule_end(st, MR_PAT3, t, q.moves);
 			if (q.moves > 0)
-				return mq_gamma_pick(&q, gammas);
+				return rule_hit(st, MR_PAT3, mq_gamma_pick(&q, gammas));
 		}
 	}
 
@@ -695,28 +796,35 @@ playout_moggy_seqchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, enu
 	/* Any groups in atari? */
 	if (pp->capturerate > fast_random(100)) {
 		move_queue_t q;  mq_init(&q);
+		uint64_t t = rule_start(st, MR_GATARI);
 		global_atari_check(p, b, to_play, &q);
+		rule_end(st, MR_GATARI, t, q.moves);
 		if (q.moves > 0)
-			return mq_pick(&q);
+			return rule_hit(st, MR_GATARI, mq_pick(&q));
 	}
 
 #ifdef MOGGY_JOSEKI
 	/* Joseki moves? */
 	if (pp->josekirate > fast_random(100)) {
 		move_queue_t q;  mq_init(&q);
+		uint64_t t = rule_start(st, MR_JOSEKI);
 		joseki_check(p, b, to_play, &q);
+		rule_end(st, MR_JOSEKI, t, q.moves);
 		if (q.moves > 0)
-			return mq_pick(&q);
+			return rule_hit(st, MR_JOSEKI, mq_pick(&q));
 	}
 #endif
 
 	/* Fill board */
 	if (pp->fillboardtries > 0) {
+		uint64_t t = rule_start(st, MR_FILLBOARD);
 		coord_t c = fillboard_check(p, b);
+		rule_end(st, MR_FILLBOARD, t, !is_pass(c));
 		if (!is_pass(c))
-			return c;
+			return rule_hit(st, MR_FILLBOARD, c);
 	}
 
+	st->random++;
 	return pass;
 }
 
@@ -778,20 +886,62 @@ mq_tagged_choose(playout_policy_t *p, board_t *b, enum stone to_play, move_queue
 	return pass;
 }
 
-static coord_t
-playout_moggy_fullchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play)
+/* Count hits for rules which tagged the move picked by mq_tagged_choose().
+ * Moves found by several rules count for each of them, eyefix and ladder
+ * candidates aren't tagged. */
+static void
+mq_tagged_stats(moggy_stats_t *st, move_queue_t *q, coord_t c)
 {
+	static const enum moggy_rule tag_rules[MQ_MAX] = {
+		[MQ_KO] = MR_KO, [MQ_LATARI] = MR_LATARI, [MQ_L2LIB] = MR_L2LIB, [MQ_LNLIB] = MR_LNLIB,
+		[MQ_PAT3] = MR_PAT3, [MQ_GATARI] = MR_GATARI, [MQ_JOSEKI] = MR_JOSEKI, [MQ_NAKADE] = MR_NAKADE,
+	};
+	if (is_pass(c)) {
+		st->random++;
+		return;
+	}
+	for (unsigned int i = 0; i < q->moves; i++) {
+		if (q->move[i] != c)
+			continue;
+		for (int j = 0; j < MQ_MAX; j++)
+			if (q->tag[i] & (1 << j))
+				st->rule[tag_rules[j]].hits++;
+		return;
+	}
+}
+
+/* Run queue check @call as rule @r (fullchoose). */
+#define rule_check(r, call)  do { \
+		unsigned int n_ = q.moves;  uint64_t t_ = rule_start(st, r); \
+		call; \
+		rule_end(st, r, t_, q.moves - n_); \
+	} while (0)
+
+kernel_static coord_t
+KERNEL(playout_moggy_fullchoose)(playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play)
+{
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel)
+		return board_kernel(playout_moggy_fullchoose)(p, s, b, to_play);
+#endif
+
 	moggy_policy_t *pp = (moggy_policy_t*)p->data;
+	moggy_stats_t *st = ((moggy_state_t*)b->ps)->stats;
 	move_queue_t q;  mq_init(&q);
 
+	st->moves++;
+
 	if (PLDEBUGL(5))
 		board_print(b, stderr);
 
 	/* Ko fight check */
 	if (pp->korate > 0 && !is_pass(b->last_ko.coord) && is_pass(b->ko.coord)
 	    && b->moves - b->last_ko_age < pp->koage) {
-		if (board_is_valid_play(b, to_play, b->last_ko.coord)
-		    && !is_bad_selfatari(b, to_play, b->last_ko.coord))
+		uint64_t t = rule_start(st, MR_KO);
+		bool ok = (board_is_valid_play(b, to_play, b->last_ko.coord)
+			   && !is_bad_selfatari(b, to_play, b->last_ko.coord));
+		rule_end(st, MR_KO, t, ok);
+		if (ok)
 			mq_add(&q, b->last_ko.coord, 1<<MQ_KO);
 	}
 
@@ -799,27 +949,29 @@ playout_moggy_fullchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, en
 	if (!is_pass(last_move(b).coord)) {
 		/* Local group in atari? */
 		if (pp->lcapturerate > 0)
-			local_atari_check(p, b, &last_move(b), &q);
+			rule_check(MR_LATARI, local_atari_check(p, b, &last_move(b), &q));
 
 		/* Local group trying to escape ladder? */
 		if (pp->ladderrate > 0)
-			local_ladder_check(p, b, &last_move(b), &q);
+			rule_check(MR_LADDER, local_ladder_check(p, b, &last_move(b), &q));
 
 		/* Local group can be PUT in atari? */
 		if (pp->atarirate > 0)
-			local_2lib_check(p, b, &last_move(b), &q);
+			rule_check(MR_L2LIB, local_2lib_check(p, b, &last_move(b), &q));
 
 		/* Local group reduced some of our groups to 3 libs? */
 		if (pp->nlibrate > 0)
-			local_nlib_check(p, b, &last_move(b), &q);
+			rule_check(MR_LNLIB, local_nlib_check(p, b, &last_move(b), &q));
 
 		/* Some other semeai-ish shape checks */
 		if (pp->eyefixrate > 0)
-			eye_fix_check(p, b, &last_move(b), to_play, &q);
+			rule_check(MR_EYEFIX, eye_fix_check(p, b, &last_move(b), to_play, &q));
 
 		/* Nakade check */
 		if (pp->nakaderate > 0 && immediate_liberty_count(b, last_move(b).coord) > 0) {
+			uint64_t t = rule_start(st, MR_NAKADE);
 			coord_t nakade = nakade_check(p, b, &last_move(b), to_play);
+			rule_end(st, MR_NAKADE, t, !is_pass(nakade));
 			if (!is_pass(nakade))
 				mq_add(&q, nakade, 1<<MQ_NAKADE);
 		}
@@ -827,9 +979,9 @@ playout_moggy_fullchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, en
 		/* Check for patterns we know */
 		if (pp->patternrate > 0) {
 			fixp_t gammas[MQL];
-			apply_pattern(p, b, &last_move(b),
-					pp->pattern2 && last_move2(b).coord >= 0 ? &last_move2(b) : NULL,
-					&q, gammas);
+			rule_check(MR_PAT3, apply_pattern(p, b, &last_move(b),
+							  pp->pattern2 && last_move2(b).coord >= 0 ? &last_move2(b) : NULL,
+							  &q, gammas));
 			/* FIXME: Use the gammas. */
 		}
 	}
@@ -838,12 +990,12 @@ playout_moggy_fullchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, en
 
 	/* Any groups in atari? */
 	if (pp->capturerate > 0)
-		global_atari_check(p, b, to_play, &q);
+		rule_check(MR_GATARI, global_atari_check(p, b, to_play, &q));
 
 #ifdef MOGGY_JOSEKI
 	/* Joseki moves? */
 	if (pp->josekirate > 0)
-		joseki_check(p, b, to_play, &q);
+		rule_check(MR_JOSEKI, joseki_check(p, b, to_play, &q));
 #endif
 
 #if 0
@@ -854,20 +1006,30 @@ playout_moggy_fullchoose(playout_policy_t *p, playout_setup_t *s, board_t *b, en
 	printf("\n");
 #endif
 
-	if (q.moves > 0)
-		return mq_tagged_choose(p, b, to_play, &q);
+	if (q.moves > 0) {
+		coord_t c = mq_tagged_choose(p, b, to_play, &q);
+		mq_tagged_stats(st, &q, c);
+		return c;
+	}
 
 	/* Fill board */
 	if (pp->fillboardtries > 0) {
+		uint64_t t = rule_start(st, MR_FILLBOARD);
 		coord_t c = fillboard_check(p, b);
+		rule_end(st, MR_FILLBOARD, t, !is_pass(c));
 		if (!is_pass(c))
-			return c;
+			return rule_hit(st, MR_FILLBOARD, c);
 	}
 
+	st->random++;
 	return pass;
 }
 
 
+#undef rule_check
+
+#ifndef BOARD_KERNEL
+
 static void
 playout_moggy_assess_group(playout_policy_t *p, prior_map_t *map, group_t g, int games)
 {
@@ -879,14 +1041,14 @@ playout_moggy_assess_group(playout_policy_t *p, prior_map_t *map, group_t g, int
 		return;
 
 	if (PLDEBUGL(5)) {
-		fprintf(stderr, "ASSESS of group %s:\n", coord2sstr(g));
+		fprintf(stderr, "ASSESS of group %s:\n", coord2sstr(group_base(b, g)));
 		board_print(b, stderr);
 	}
 
 	if (board_group_info(b, g).libs > 2) {
 		if (!pp->nlibrate)
 			return;
-		if (board_at(b, g) != map->to_play)
+		if (board_at(b, group_base(b, g)) != map->to_play)
 			return; // we do only defense
 		group_nlib_defense_check(b, g, map->to_play, &q, 0);
 		while (q.moves--) {
@@ -942,7 +1104,7 @@ playout_moggy_assess_group(playout_policy_t *p, prior_map_t *map, group_t g, int
 			 * group (but we don't encourage it either). Such
 			 * a move can simplify tactical situations if we
 			 * can afford it. */
-			if (map->to_play != board_at(b, g))
+			if (map->to_play != board_at(b, group_base(b, g)))
 				continue;
 			/* FIXME: We give the malus even if this move
 			 * captures another group. */
@@ -1017,8 +1179,8 @@ playout_moggy_assess(playout_policy_t *p, prior_map_t *map, int games)
 	moggy_policy_t *pp = (moggy_policy_t*)p->data;
 
 	/* First, go through all endangered groups. */
-	for (group_t g = 1; g < board_max_coords(map->b); g++)
-		if (group_at(map->b, g) == g)
+	for (group_t g = 1; g < board_max_groups(map->b); g++)
+		if (group_base(map->b, g))
 			playout_moggy_assess_group(p, map, g, games);
 
 	/* Then, assess individual moves. */
@@ -1031,6 +1193,9 @@ playout_moggy_assess(playout_policy_t *p, prior_map_t *map, int games)
 }
 
 
+#endif /* BOARD_KERNEL */
+
+
 #define permit_move(c)  playout_permit(p, b, c, m->color, random_move)
 
 /* alt parameter tells permit if we just want a yes/no answer for this move
@@ -1040,7 +1205,7 @@ playout_moggy_assess(playout_policy_t *p, prior_map_t *map, int games)
  * permit() needs to call permit() again on that move. This time alt will be
  * false though (we just want a yes/no answer) so it won't recurse again. */
 static bool
-playout_moggy_permit(playout_policy_t *p, board_t *b, move_t *m, bool alt, bool random_move)
+moggy_permit(playout_policy_t *p, board_t *b, move_t *m, bool alt, bool random_move)
 {
 	moggy_policy_t *pp = (moggy_policy_t*)p->data;
 	moggy_state_t *ps = (moggy_state_t*)b->ps;
@@ -1125,13 +1290,141 @@ eyefill_skip:
 	return true;
 }
 
+kernel_static bool
+KERNEL(playout_moggy_permit)(playout_policy_t *p, board_t *b, move_t *m, bool alt, bool random_move)
+{
+#ifdef BOARD_KERNEL_DISPATCH
+	if (board_statics.kernel)
+		return board_kernel(playout_moggy_permit)(p, b, m, alt, random_move);
+#endif
+
+	moggy_stats_t *st = ((moggy_state_t*)b->ps)->stats;
+	coord_t coord = m->coord;
+	uint64_t t = rule_start(st, MR_PERMIT);
+	bool ok = moggy_permit(p, b, m, alt, random_move);
+	rule_end(st, MR_PERMIT, t, ok && m->coord != coord);
+	st->rule[MR_PERMIT].hits += !ok;
+	return ok;
+}
+
+#ifndef BOARD_KERNEL
+
+static const char *moggy_rule_names[MR_MAX] = {
+	"ko", "latari", "ladder", "selfatari", "2lib", "nlib", "eyefix",
+	"nakade", "pattern", "gatari", "joseki", "fillboard", "permit"
+};
+
+/* Live threads' stats, and stats of threads which exited. */
+static moggy_stats_t *moggy_stats_threads = NULL;
+static moggy_stats_t moggy_stats_exited;
+static pthread_mutex_t moggy_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t moggy_stats_key;
+static pthread_once_t moggy_stats_once = PTHREAD_ONCE_INIT;
+
+static void
+moggy_stats_add(moggy_stats_t *to, moggy_stats_t *s)
+{
+	to->playouts += s->playouts;
+	to->moves += s->moves;
+	to->random += s->random;
+	for (int r = 0; r < MR_MAX; r++) {
+		to->rule[r].tried += s->rule[r].tried;
+		to->rule[r].candidates += s->rule[r].candidates;
+		to->rule[r].hits += s->rule[r].hits;
+		to->rule[r].timed += s->rule[r].timed;
+		to->rule[r].ticks += s->rule[r].ticks;
+	}
+}
+
+/* Thread exit: keep its stats, unregister. */
+static void
+moggy_stats_thread_done(void *data)
+{
+	moggy_stats_t *s = (moggy_stats_t*)data;
+	pthread_mutex_lock(&moggy_stats_mutex);
+	moggy_stats_add(&moggy_stats_exited, s);
+	for (moggy_stats_t **p = &moggy_stats_threads; *p; p = &(*p)->next)
+		if (*p == s) {
+			*p = s->next;
+			break;
+		}
+	pthread_mutex_unlock(&moggy_stats_mutex);
+	free(s);
+}
+
+static void
+moggy_stats_key_init(void)
+{
+	pthread_key_create(&moggy_stats_key, moggy_stats_thread_done);
+}
+
+/* Current thread's stats (once per playout, so no need for __thread). */
+static moggy_stats_t *
+moggy_stats_thread(void)
+{
+	pthread_once(&moggy_stats_once, moggy_stats_key_init);
+	moggy_stats_t *s = (moggy_stats_t*)pthread_getspecific(moggy_stats_key);
+	if (likely(s))
+		return s;
+
+	s = calloc2(1, moggy_stats_t);
+	pthread_setspecific(moggy_stats_key, s);
+	pthread_mutex_lock(&moggy_stats_mutex);
+	s->next = moggy_stats_threads;
+	moggy_stats_threads = s;
+	pthread_mutex_unlock(&moggy_stats_mutex);
+	return s;
+}
+
+/* Running threads' counters are read without synchronization,
+ * numbers may be slightly off while a search is running. */
+uint64_t
+playout_moggy_stats(strbuf_t *buf)
+{
+	moggy_stats_t total = { 0, };
+	pthread_mutex_lock(&moggy_stats_mutex);
+	moggy_stats_add(&total, &moggy_stats_exited);
+	for (moggy_stats_t *s = moggy_stats_threads; s; s = s->next)
+		moggy_stats_add(&total, s);
+	pthread_mutex_unlock(&moggy_stats_mutex);
+
+	uint64_t moves = (total.moves ? total.moves : 1);
+	sbprintf(buf, "moggy: %" PRIu64 " playouts, %" PRIu64 " moves, %.1f%% random\n",
+		 total.playouts, total.moves, 100.0 * total.random / moves);
+	sbprintf(buf, "%-10s %12s %12s %12s %6s %8s\n", "rule", "tried", "candidates", "hits", "hits%", TICKS_UNIT);
+	for (int r = 0; r < MR_MAX; r++) {
+		moggy_rule_stats_t *rs = &total.rule[r];
+		if (!rs->tried)
+			continue;
+		sbprintf(buf, "%-10s %12" PRIu64 " %12" PRIu64 " %12" PRIu64 " %5.1f%% %8.0f\n",
+			 moggy_rule_names[r], rs->tried, rs->candidates, rs->hits,
+			 100.0 * rs->hits / moves, (rs->timed ? (double)rs->ticks / rs->timed : 0.0));
+	}
+	return total.moves;
+}
+
+void
+playout_moggy_stats_reset(void)
+{
+	pthread_mutex_lock(&moggy_stats_mutex);
+	memset(&moggy_stats_exited, 0, sizeof(moggy_stats_exited));
+	for (moggy_stats_t *s = moggy_stats_threads; s; s = s->next) {
+		moggy_stats_t *next = s->next;
+		memset(s, 0, sizeof(*s));
+		s->next = next;
+	}
+	pthread_mutex_unlock(&moggy_stats_mutex);
+}
+
 static void
 playout_moggy_setboard(playout_policy_t *playout_policy, board_t *b)
 {
 	if (b->ps)
 		return;
-	moggy_state_t *ps = malloc2(moggy_state_t);
+	moggy_state_t *ps = (moggy_state_t*)board_ps_alloc(sizeof(moggy_state_t));
 	ps->last_selfatari[S_BLACK] = ps->last_selfatari[S_WHITE] = 0;
+	ps->stats = moggy_stats_thread();
+	ps->stats->playouts++;
 	b->ps = ps;
 }
 
@@ -1314,3 +1607,11 @@ playout_moggy_init(char *arg, board_t *b)
 
 	return p;
 }
+
+bool
+playout_moggy_check_patterns(void)
+{
+	return pattern3s_check(moggy_patterns_src, moggy_patterns_src_n);
+}
+
+#endif /* BOARD_KERNEL */
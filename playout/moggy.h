@@ -2,7 +2,16 @@
 #define PACHI_PLAYOUT_MOGGY_H
 
 #include "playout.h"
+#include "util.h"
 
 struct playout_policy *playout_moggy_init(char *arg, board_t *b);
 
+/* Check 3x3 pattern table for default moggy patterns (t-unit) */
+bool playout_moggy_check_patterns(void);
+
+/* Per rule hit / time counters summed over all threads (pachi-moggy_stats).
+ * Returns number of moves played by moggy since last reset. */
+uint64_t playout_moggy_stats(strbuf_t *buf);
+void playout_moggy_stats_reset(void);
+
 #endif
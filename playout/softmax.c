@@ -0,0 +1,418 @@
+#include <assert.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "debug.h"
+#include "pattern.h"
+#include "pattern3.h"
+#include "patternsp.h"
+#include "patternprob.h"
+#include "playout.h"
+#include "playout/softmax.h"
+#include "random.h"
+#include "tactics/util.h"
+
+/* Softmax playout policy: moves are sampled with probability proportional
+ * to a gamma computed from the point's 3x3 neighborhood: MM gamma of the
+ * 3x3 spatial (patterns_mm.gamma), times capture / atari escape gammas
+ * for neighbors in atari. Own one-point eyes get 0. Points near the last
+ * move get the distance gamma on top when sampling.
+ *
+ * Gammas live in a sum tree per color to play, so sampling is O(log n).
+ * Since gammas only depend on 3x3 codes, after a move only points whose
+ * code may have changed get updated: 8-neighborhood of points that got
+ * a stone or lost one (stone bitboards diff), and liberties of groups
+ * in atari before and after (atari bits). */
+
+#define PLDEBUGL(n) DEBUGL_(p->debug_level, n)
+
+/* Sum tree leaves, one per coord */
+#define SOFTMAX_LEAVES 512
+/* Illegal moves (suicide, ko) picked before giving up */
+#define SOFTMAX_TRIES  16
+/* Points with distance gamma around last move (gridcular distance 2..4) */
+#define SOFTMAX_NEAR   12
+
+typedef struct {
+	float gamma3[1 << 16];   /* 3x3 colors part of hash3_t, black to play */
+	float capture;           /* Neighbor group in atari: opponent */
+	float aescape;           /*                          own */
+	float dist_extra[5];     /* Gridcular distance to last move: gamma - 1 */
+} softmax_policy_t;
+
+/* Per simulation state (b->ps) */
+typedef struct {
+	/* Sum trees for black and white to play: node i has children
+	 * 2i and 2i+1, leaf of coord c is SOFTMAX_LEAVES + c. */
+	float tree[2][2 * SOFTMAX_LEAVES];
+	bitboard_t bits[2];      /* Stones at last update */
+	bitboard_t atari_libs;   /* Liberties of groups in atari at last update */
+} softmax_state_t;
+
+
+static inline void
+tree_set(float *t, coord_t c, float val)
+{
+	int i = SOFTMAX_LEAVES + c;
+	if (t[i] == val)
+		return;
+	t[i] = val;
+	for (i >>= 1; i; i >>= 1)
+		t[i] = t[2 * i] + t[2 * i + 1];
+}
+
+/* Leaf where cumulated weight reaches @r (0 <= r < t[1]). */
+static inline coord_t
+tree_find(float *t, float r)
+{
+	int i = 1;
+	while (i < SOFTMAX_LEAVES) {
+		i *= 2;
+		/* Rounding errors: never descend into an empty subtree. */
+		if (r >= t[i] && t[i + 1] > 0) {
+			r -= t[i];
+			i++;
+		}
+	}
+	return i - SOFTMAX_LEAVES;
+}
+
+/* Gamma of empty point with 3x3 code @pat, black to play
+ * (use pattern3_reverse() for white). */
+static inline float
+softmax_gamma(softmax_policy_t *pp, hash3_t pat)
+{
+	float gamma = pp->gamma3[pat & 0xffff];
+	if (likely(!(pat >> 16)) || !gamma)
+		return gamma;
+
+	/* Atari bits 16..19: neighbors at color shifts 2, 6, 8, 12 (see pattern3.h) */
+	static const int shift[4] = { 2, 6, 8, 12 };
+	bool capture = false, aescape = false;
+	for (int i = 0; i < 4; i++) {
+		if (!(pat & (1 << (16 + i))))
+			continue;
+		enum stone color = (enum stone)((pat >> shift[i]) & 3);
+		if (color == S_BLACK)  aescape = true;
+		else                   capture = true;
+	}
+	if (capture)  gamma *= pp->capture;
+	if (aescape)  gamma *= pp->aescape;
+	return gamma;
+}
+
+static inline hash3_t
+point_pat3(board_t *b, coord_t c)
+{
+#ifdef BOARD_PAT3
+	return b->pat3[c];
+#else
+	return pattern3_hash(b, c);
+#endif
+}
+
+static void
+softmax_atari_libs(board_t *b, bitboard_t *libs)
+{
+	bitboard_clear(libs);
+	for (int i = 0; i < b->clen; i++)
+		bitboard_set(libs, board_group_info(b, b->c[i]).lib[0]);
+}
+
+/* Bring gammas up to date with the board: only points whose 3x3 code
+ * may have changed since last update. */
+static void
+softmax_update(softmax_policy_t *pp, softmax_state_t *ps, board_t *b)
+{
+	bitboard_t changed, dirty, atari_libs;
+	for (int i = 0; i < BITBOARD_WORDS; i++)
+		changed.w[i] = ((b->bits[0].w[i] ^ ps->bits[0].w[i]) |
+				(b->bits[1].w[i] ^ ps->bits[1].w[i]));
+	bitboard_dilate(&dirty, &changed, board_stride(b));
+
+	softmax_atari_libs(b, &atari_libs);
+	bitboard_or(&dirty, &dirty, &atari_libs);
+	bitboard_or(&dirty, &dirty, &ps->atari_libs);
+	bitboard_and(&dirty, &dirty, &board_statics.onboard);
+
+	/* Update leaves, then their ancestors level by level: dirty points
+	 * are clustered, many share ancestors. Indices stay sorted. */
+	float *black = ps->tree[S_BLACK - 1], *white = ps->tree[S_WHITE - 1];
+	int idx[SOFTMAX_LEAVES], n = 0;
+	for (int i = 0; i < BITBOARD_WORDS; i++)
+		for (uint64_t w = dirty.w[i]; w; w &= w - 1) {
+			coord_t c = i * 64 + __builtin_ctzll(w);
+			float gb = 0, gw = 0;
+			if (board_at(b, c) == S_NONE) {
+				hash3_t pat = point_pat3(b, c);
+				gb = softmax_gamma(pp, pat);
+				gw = softmax_gamma(pp, pattern3_reverse(pat));
+			}
+			int leaf = SOFTMAX_LEAVES + c;
+			if (black[leaf] == gb && white[leaf] == gw)
+				continue;
+			black[leaf] = gb;
+			white[leaf] = gw;
+			idx[n++] = leaf;
+		}
+	while (n && idx[0] > 1) {
+		int m = 0;
+		for (int k = 0; k < n; k++) {
+			int i = idx[k] >> 1;
+			if (m && idx[m - 1] == i)
+				continue;
+			idx[m++] = i;
+			black[i] = black[2 * i] + black[2 * i + 1];
+			white[i] = white[2 * i] + white[2 * i + 1];
+		}
+		n = m;
+	}
+
+	ps->bits[0] = b->bits[0];
+	ps->bits[1] = b->bits[1];
+	ps->atari_libs = atari_libs;
+}
+
+static coord_t
+playout_softmax_choose(playout_policy_t *p, playout_setup_t *s, board_t *b, enum stone to_play)
+{
+	softmax_policy_t *pp = (softmax_policy_t*)p->data;
+	softmax_state_t *ps = (softmax_state_t*)b->ps;
+	softmax_update(pp, ps, b);
+	float *t = ps->tree[to_play - 1];
+
+	/* Distance to last move: points nearby get extra weight, sampled
+	 * apart from the tree so that it doesn't need updating. */
+	coord_t near[SOFTMAX_NEAR];
+	float extra[SOFTMAX_NEAR], extra_sum = 0;
+	int nnear = 0;
+	coord_t last = last_move(b).coord;
+	if (!is_pass(last) && b->moves) {
+		int stride = board_stride(b);
+		static const int dx[SOFTMAX_NEAR] = { 0, 0, -1, 1,  -1, 1, -1, 1,   0, 0, -2, 2 };
+		static const int dy[SOFTMAX_NEAR] = { -1, 1, 0, 0,  -1, -1, 1, 1,  -2, 2, 0, 0 };
+		for (int i = 0; i < SOFTMAX_NEAR; i++) {
+			coord_t c = last + dx[i] + dy[i] * stride;
+			if (c < 0 || c >= board_max_coords(b) || !t[SOFTMAX_LEAVES + c])
+				continue;
+			near[nnear] = c;
+			extra[nnear] = t[SOFTMAX_LEAVES + c] * pp->dist_extra[coord_gridcular_distance(c, last)];
+			extra_sum += extra[nnear++];
+		}
+	}
+
+	coord_t excluded[SOFTMAX_TRIES];
+	float excluded_gamma[SOFTMAX_TRIES];
+	int nexcluded = 0;
+
+	coord_t coord = pass;
+	while (nexcluded < SOFTMAX_TRIES && t[1] + extra_sum > 0) {
+		coord_t c = pass;
+		float r = fast_frandom() * (t[1] + extra_sum);
+		if (r < t[1])
+			c = tree_find(t, r);
+		else {
+			r -= t[1];
+			for (int i = 0; i < nnear; i++) {
+				if (!extra[i])  continue;
+				c = near[i];
+				if (r < extra[i])  break;
+				r -= extra[i];
+			}
+		}
+
+		move_t m = move(c, to_play);
+		if (board_is_valid_move(b, &m)) {
+			coord = c;
+			break;
+		}
+
+		/* Suicide or ko, exclude it for now. */
+		excluded[nexcluded] = c;
+		excluded_gamma[nexcluded++] = t[SOFTMAX_LEAVES + c];
+		tree_set(t, c, 0);
+		for (int i = 0; i < nnear; i++)
+			if (near[i] == c) {
+				extra_sum -= extra[i];
+				extra[i] = 0;
+			}
+	}
+
+	while (nexcluded--)
+		tree_set(t, excluded[nexcluded], excluded_gamma[nexcluded]);
+
+	if (PLDEBUGL(5))
+		fprintf(stderr, "softmax: %s %s\n", stone2str(to_play), coord2sstr(coord));
+	return coord;
+}
+
+/* Compute all gammas from scratch. */
+static void
+softmax_fill(softmax_policy_t *pp, softmax_state_t *ps, board_t *b)
+{
+	/* Fill leaves, then sum up. */
+	memset(ps->tree, 0, sizeof(ps->tree));
+	float *black = ps->tree[S_BLACK - 1], *white = ps->tree[S_WHITE - 1];
+	foreach_free_point(b) {
+		hash3_t pat = point_pat3(b, c);
+		black[SOFTMAX_LEAVES + c] = softmax_gamma(pp, pat);
+		white[SOFTMAX_LEAVES + c] = softmax_gamma(pp, pattern3_reverse(pat));
+	} foreach_free_point_end;
+	for (int i = SOFTMAX_LEAVES - 1; i; i--) {
+		black[i] = black[2 * i] + black[2 * i + 1];
+		white[i] = white[2 * i] + white[2 * i + 1];
+	}
+
+	ps->bits[0] = b->bits[0];
+	ps->bits[1] = b->bits[1];
+	softmax_atari_libs(b, &ps->atari_libs);
+}
+
+static void
+playout_softmax_setboard(playout_policy_t *p, board_t *b)
+{
+	softmax_policy_t *pp = (softmax_policy_t*)p->data;
+	if (b->ps)
+		return;
+	softmax_state_t *ps = (softmax_state_t*)board_ps_alloc(sizeof(softmax_state_t));
+	b->ps = ps;
+	softmax_fill(pp, ps, b);
+}
+
+/* Sums are recomputed in the same order both ways, should match exactly.
+ * Leave some room for rounding anyway. */
+static bool
+softmax_tree_cmp(float *t1, float *t2)
+{
+	for (int i = 1; i < 2 * SOFTMAX_LEAVES; i++)
+		if (fabsf(t1[i] - t2[i]) > 1e-4f * (1 + fabsf(t2[i])))
+			return false;
+	return true;
+}
+
+bool
+playout_softmax_check_update(playout_policy_t *p, board_t *b, int games)
+{
+	softmax_policy_t *pp = (softmax_policy_t*)p->data;
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
+	softmax_state_t *full = malloc2(softmax_state_t);
+	bool ok = true;
+
+	for (int game = 0; game < games && ok; game++) {
+		board_t board2, *b2 = &board2;
+		board_copy(b2, b);
+		b2->playout_board = true;
+		playout_softmax_setboard(p, b2);
+		softmax_state_t *ps = (softmax_state_t*)b2->ps;
+
+		enum stone color = (last_move(b2).color ? stone_other(last_move(b2).color) : S_BLACK);
+		for (int passes = 0; passes < 2 && b2->moves < MAX_GAMELEN; color = stone_other(color)) {
+			coord_t c = playout_softmax_choose(p, &setup, b2, color);
+			move_t m = move(c, color);
+			int r = board_play(b2, &m);  assert(r >= 0);
+			passes = (is_pass(c) ? passes + 1 : 0);
+
+			softmax_update(pp, ps, b2);
+			softmax_fill(pp, full, b2);
+			if (softmax_tree_cmp(ps->tree[0], full->tree[0]) &&
+			    softmax_tree_cmp(ps->tree[1], full->tree[1]))
+				continue;
+
+			if (DEBUGL(2)) {
+				fprintf(stderr, "softmax: gamma sums differ from full recompute after %s %s\n",
+					stone2str(color), coord2sstr(c));
+				board_print(b2, stderr);
+			}
+			ok = false;
+			break;
+		}
+		board_done(b2);
+	}
+
+	free(full);
+	return ok;
+}
+
+
+/* Gamma of 3x3 spatial with colors @colors around empty point
+ * (hash3_t encoding), black to play. 0 for black eyes. */
+static float
+softmax_gamma3(pattern_config_t *pc, int colors, float nospat)
+{
+	/* hash3_t point order, 2 bits per point:
+	 * 7 6 5
+	 * 4   3
+	 * 2 1 0 */
+	static const int px[8] = { 1, 0, -1, 1, -1, 1, 0, -1 };
+	static const int py[8] = { 1, 1, 1, 0, 0, -1, -1, -1 };
+	enum stone at[3][3];
+	at[1][1] = S_NONE;
+	for (int i = 0; i < 8; i++)
+		at[py[i] + 1][px[i] + 1] = (enum stone)((colors >> (2 * i)) & 3);
+
+	/* Black eye ? */
+	int eye = 0, diag[S_MAX] = { 0, };
+	for (int i = 0; i < 8; i++) {
+		enum stone color = at[py[i] + 1][px[i] + 1];
+		if (px[i] && py[i])  diag[color]++;
+		else                 eye += (color == S_BLACK || color == S_OFFBOARD);
+	}
+	if (eye == 4 && diag[S_WHITE] + !!diag[S_OFFBOARD] < 2)
+		return 0;
+
+	spatial_t s;
+	memset(&s, 0, sizeof(s));
+	s.dist = 3;
+	hash_t h = 0;
+	for (unsigned int j = 0; j < ptind[4]; j++) {
+		enum stone color = at[ptcoords[j].y + 1][ptcoords[j].x + 1];
+		h ^= pthashes[0][j][color];
+	}
+	spatial_t *sp = spatial_dict_lookup(spat_dict, 3, h);
+	if (!sp)
+		return nospat;
+	feature_t f = feature(FEAT_SPATIAL3, spatial_id(sp, spat_dict));
+	return (feature_has_gamma(pc, &f) ? feature_gamma(pc, &f) : nospat);
+}
+
+static float
+softmax_feature_gamma(pattern_config_t *pc, enum feature_id id, int payload)
+{
+	feature_t f = feature(id, payload);
+	return feature_gamma(pc, &f);
+}
+
+playout_policy_t *
+playout_softmax_init(char *arg, board_t *b)
+{
+	if (arg)
+		fprintf(stderr, "playout-softmax: This policy does not accept arguments (%s)\n", arg);
+
+	pattern_config_t pc;
+	patterns_init(&pc, NULL, false, true);
+	if (!using_patterns())
+		die("playout-softmax: needs mm patterns (patterns_mm.spat, patterns_mm.gamma)\n");
+
+	playout_policy_t *p = calloc2(1, playout_policy_t);
+	softmax_policy_t *pp = calloc2(1, softmax_policy_t);
+	p->data = pp;
+	p->setboard = playout_softmax_setboard;
+	p->setboard_randomok = true;  /* Picks up any move played since last choose() */
+	p->choose = playout_softmax_choose;
+
+	pp->capture = softmax_feature_gamma(&pc, FEAT_CAPTURE, PF_CAPTURE_NOLADDER);
+	pp->aescape = softmax_feature_gamma(&pc, FEAT_AESCAPE, PF_AESCAPE_NOLADDER);
+	for (int d = 2; d <= 4; d++) {  /* dist feature payload is distance - 1 */
+		float gamma = softmax_feature_gamma(&pc, FEAT_DISTANCE, d - 1);
+		pp->dist_extra[d] = (gamma > 1 ? gamma - 1 : 0);
+	}
+
+	float nospat = softmax_feature_gamma(&pc, FEAT_NO_SPATIAL, 0);
+	for (int colors = 0; colors < (1 << 16); colors++)
+		pp->gamma3[colors] = softmax_gamma3(&pc, colors, nospat);
+
+	return p;
+}
@@ -0,0 +1,12 @@
+#ifndef PACHI_PLAYOUT_SOFTMAX_H
+#define PACHI_PLAYOUT_SOFTMAX_H
+
+#include "playout.h"
+
+playout_policy_t *playout_softmax_init(char *arg, board_t *b);
+
+/* Play @games from @b checking incrementally updated gamma sums against
+ * a full recompute after each move. For tests. */
+bool playout_softmax_check_update(playout_policy_t *p, board_t *b, int games);
+
+#endif
@@ -2,17 +2,27 @@
 #define PACHI_STATS_H
 
 #include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
 
 /* Move statistics; we track how good value each move has. */
-/* These operations are supposed to be atomic - reasonably
- * safe to perform by multiple threads at once on the same stats.
- * What this means in practice is that perhaps the value will get
+/* These operations are supposed to be atomic - safe to perform
+ * by multiple threads at once on the same stats.
+ * With single precision floating_t, value and playouts fit in
+ * 64 bits and are updated together with a compare-and-swap, so
+ * no update is ever lost. With DOUBLE_FLOATING this is not possible
+ * and we fall back to plain stores: perhaps the value will get
  * slightly wrong, but not drastically corrupted. */
 
 typedef struct {
 	floating_t value; // BLACK wins/playouts
 	int playouts; // # of playouts
+#ifndef DOUBLE_FLOATING
+} __attribute__((aligned(8))) move_stats_t;
+#define STATS_ATOMIC 1
+#else
 } move_stats_t;
+#endif
 
 #define move_stats(value, playouts)  { value, playouts }
 
@@ -29,6 +39,50 @@ static void stats_merge(move_stats_t *dest, move_stats_t *src);
 static void stats_reverse_parity(move_stats_t *s);
 
 
+#ifdef STATS_ATOMIC
+
+/* Both fields are updated at once with a 64-bit compare-and-swap,
+ * retried until no other thread got in between. Readers may still
+ * load value and playouts separately, which is harmless. */
+
+typedef union {
+	move_stats_t s;
+	uint64_t raw;
+} move_stats_packed_t;
+
+static inline void
+stats_add_result(move_stats_t *s, floating_t result, int playouts)
+{
+	move_stats_packed_t old, new;
+	old.raw = __atomic_load_n((uint64_t *)s, __ATOMIC_RELAXED);
+	do {
+		new.s.playouts = old.s.playouts + playouts;
+		new.s.value = old.s.value + (result - old.s.value) * playouts / new.s.playouts;
+	} while (!__atomic_compare_exchange_n((uint64_t *)s, &old.raw, new.raw, true,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+static inline void
+stats_rm_result(move_stats_t *s, floating_t result, int playouts)
+{
+	move_stats_packed_t old, new;
+	old.raw = __atomic_load_n((uint64_t *)s, __ATOMIC_RELAXED);
+	do {
+		if (old.s.playouts > playouts) {
+			new.s.playouts = old.s.playouts - playouts;
+			new.s.value = old.s.value + (old.s.value - result) * playouts / new.s.playouts;
+		} else {
+			/* Leave the value as is with zero playouts,
+			 * see below. */
+			new.s.playouts = 0;
+			new.s.value = old.s.value;
+		}
+	} while (!__atomic_compare_exchange_n((uint64_t *)s, &old.raw, new.raw, true,
+					      __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+}
+
+#else /* !STATS_ATOMIC */
+
 /* We actually do the atomicity in a pretty hackish way - we simply
  * rely on the fact that int,floating_t operations should be atomic with
  * reasonable compilers (gcc) on reasonable architectures (i386,
@@ -84,6 +138,8 @@ stats_rm_result(move_stats_t *s, floating_t result, int playouts)
 	}
 }
 
+#endif /* STATS_ATOMIC */
+
 static inline void
 stats_merge(move_stats_t *dest, move_stats_t *src)
 {
@@ -0,0 +1,307 @@
+#define DEBUG
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "board_undo.h"
+#include "debug.h"
+#include "dcnn.h"
+#include "engine.h"
+#include "ownermap.h"
+#include "pattern.h"
+#include "patternsp.h"
+#include "patternprob.h"
+#include "playout.h"
+#include "playout/light.h"
+#include "playout/moggy.h"
+#include "playout/softmax.h"
+#include "random.h"
+#include "timeinfo.h"
+#include "version.h"
+#include "uct/uct.h"
+#include "t-bench/bench.h"
+
+/* Benchmarks run on a fixed set of positions: BENCH_GAMES random games
+ * played from the empty board with a fixed seed. Position i is taken
+ * i/BENCH_GAMES of the way into game i, so they range from empty board
+ * to endgame. Each benchmark reseeds with BENCH_SEED. */
+#define BENCH_SEED   1
+#define BENCH_GAMES  8
+
+/* Op counts (fixed for all machines, tuned for ~1s each on 19x19) */
+#define BENCH_PLAY_ROUNDS      200
+#define BENCH_QUICK_ROUNDS     4
+#define BENCH_MOGGY_PLAYOUTS   2000
+#define BENCH_LIGHT_PLAYOUTS   8000
+#define BENCH_SOFTMAX_PLAYOUTS 4000
+#define BENCH_PATTERN_ROUNDS   20
+#define BENCH_UCT_PLAYOUTS     5000
+#define BENCH_DCNN_ROUNDS      4
+
+#define BENCH_LOCKSTEP         8      /* Games played together in lockstep benchmark */
+
+typedef struct {
+	move_t moves[MAX_GAMELEN];
+	int len;
+} bench_game_t;
+
+static bench_game_t games[BENCH_GAMES];
+static board_t *positions[BENCH_GAMES];
+
+static int nresults = 0;
+
+static void
+bench_result(char *name, long ops, double elapsed, char *rate_name)
+{
+	printf("%s\n    \"%s\": { \"ops\": %li, \"seconds\": %.3f, \"ns_per_op\": %.1f",
+	       (nresults++ ? "," : ""), name, ops, elapsed, elapsed * 1e9 / ops);
+	if (rate_name)
+		printf(", \"%s\": %.1f", rate_name, ops / elapsed);
+	printf(" }");
+	fflush(stdout);
+}
+
+static enum stone
+bench_to_play(board_t *b)
+{
+	return (b->moves ? stone_other(last_move(b).color) : S_BLACK);
+}
+
+static void
+bench_make_positions(board_t *empty)
+{
+	fast_srandom(BENCH_SEED);
+	for (int i = 0; i < BENCH_GAMES; i++) {
+		bench_game_t *g = &games[i];
+		board_t b;  board_copy(&b, empty);
+		enum stone color = S_BLACK;
+		int passes = 0;
+		while (g->len < MAX_GAMELEN && passes < 2) {
+			coord_t c;
+			board_play_random(&b, color, &c, NULL, NULL);
+			g->moves[g->len++] = (move_t)move(c, color);
+			passes = (is_pass(c) ? passes + 1 : 0);
+			color = stone_other(color);
+		}
+		board_done(&b);
+
+		positions[i] = board_new(board_rsize(empty), NULL);
+		board_copy(positions[i], empty);
+		for (int j = 0; j < g->len * i / BENCH_GAMES; j++) {
+			int r = board_play(positions[i], &g->moves[j]);  assert(r >= 0);
+		}
+	}
+}
+
+static void
+bench_board_play(board_t *empty)
+{
+	long ops = 0;
+	double time_start = time_now();
+	for (int r = 0; r < BENCH_PLAY_ROUNDS; r++)
+		for (int i = 0; i < BENCH_GAMES; i++) {
+			board_t b;  board_copy(&b, empty);
+			for (int j = 0; j < games[i].len; j++, ops++)
+				board_play(&b, &games[i].moves[j]);
+			board_done(&b);
+		}
+	bench_result("board_play", ops, time_now() - time_start, NULL);
+}
+
+/* Try every 3rd free point at each move of the games. */
+static void
+bench_quick_play(board_t *empty)
+{
+	long ops = 0;
+	double elapsed = 0;
+	for (int r = 0; r < BENCH_QUICK_ROUNDS; r++)
+	for (int i = 0; i < BENCH_GAMES; i++) {
+		board_t b;  board_copy(&b, empty);
+		for (int j = 0; j < games[i].len; j++) {
+			enum stone color = stone_other(games[i].moves[j].color);
+			double time_start = time_now();
+			for (int k = 0; k < b.flen; k += 3) {
+				move_t m = move(b.f[k], color);
+				if (!board_is_valid_move(&b, &m))
+					continue;
+				with_move(&b, m.coord, color, { ops++; });
+			}
+			elapsed += time_now() - time_start;
+			board_play(&b, &games[i].moves[j]);
+		}
+		board_done(&b);
+	}
+	bench_result("board_quick_play_undo", ops, elapsed, NULL);
+}
+
+static double
+time_playouts(playout_policy_t *policy, board_t **pos, int npos, int playouts)
+{
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
+	fast_srandom(BENCH_SEED);
+	double time_start = time_now();
+	for (int n = 0; n < playouts; n++) {
+		board_t *p = pos[n % npos];
+		board_t b;  board_copy(&b, p);
+		playout_play_game(&setup, &b, bench_to_play(p), NULL, NULL, policy);
+		board_done(&b);
+	}
+	return time_now() - time_start;
+}
+
+static void
+bench_playouts(char *name, playout_policy_t *policy, int playouts)
+{
+	double elapsed = time_playouts(policy, positions, BENCH_GAMES, playouts);
+	bench_result(name, playouts, elapsed, "playouts_per_s");
+	playout_policy_done(policy);
+}
+
+/* Same playouts, BENCH_LOCKSTEP games at a time with playout_play_games(). */
+static void
+bench_playouts_lockstep(char *name, playout_policy_t *policy, int playouts)
+{
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
+	board_t boards[BENCH_LOCKSTEP], *b[BENCH_LOCKSTEP];
+	enum stone colors[BENCH_LOCKSTEP];
+	int results[BENCH_LOCKSTEP];
+	fast_srandom(BENCH_SEED);
+	double time_start = time_now();
+	for (int n = 0; n < playouts; n += BENCH_LOCKSTEP) {
+		for (int i = 0; i < BENCH_LOCKSTEP; i++) {
+			board_t *p = positions[(n + i) % BENCH_GAMES];
+			board_copy(&boards[i], p);
+			b[i] = &boards[i];
+			colors[i] = bench_to_play(p);
+		}
+		playout_play_games(&setup, BENCH_LOCKSTEP, b, colors, NULL, NULL, policy, results);
+		for (int i = 0; i < BENCH_LOCKSTEP; i++)
+			board_done(&boards[i]);
+	}
+	bench_result(name, playouts, time_now() - time_start, "playouts_per_s");
+	playout_policy_done(policy);
+}
+
+static void
+bench_patterns(void)
+{
+	pattern_config_t pc;
+	patterns_init(&pc, NULL, false, true);
+	if (!using_patterns())
+		return;
+
+	ownermap_t ownermaps[BENCH_GAMES];
+	fast_srandom(BENCH_SEED);
+	for (int i = 0; i < BENCH_GAMES; i++)
+		mcowner_playouts_fast(positions[i], bench_to_play(positions[i]), &ownermaps[i]);
+
+	long ops = 0;
+	double time_start = time_now();
+	for (int r = 0; r < BENCH_PATTERN_ROUNDS; r++)
+		for (int i = 0; i < BENCH_GAMES; i++, ops++) {
+			board_t *b = positions[i];
+			floating_t probs[b->flen];
+			pattern_rate_moves_fast(&pc, b, bench_to_play(b), probs, &ownermaps[i]);
+		}
+	bench_result("pattern_rate_moves_fast", ops, time_now() - time_start, NULL);
+}
+
+/* Search from the empty board, single thread. Returns search time,
+ * and time spent walking the tree outside playouts in @tree. */
+static double
+time_uct(board_t *empty, char *playout, int playouts, double *tree)
+{
+	char e_arg[256], ti_arg[32];
+	snprintf(e_arg, sizeof(e_arg), "threads=1,playout=%s,time_tree", playout);
+	snprintf(ti_arg, sizeof(ti_arg), "=%i", playouts);
+	time_info_t ti;
+	if (!time_parse(&ti, ti_arg))  assert(0);
+
+	board_t b;  board_copy(&b, empty);
+	engine_t e;  engine_init(&e, E_UCT, e_arg, &b);
+	fast_srandom(BENCH_SEED);
+	double time_start = time_now();
+	uint64_t ticks_start = ticks_now();
+	e.genmove(&e, &b, &ti, S_BLACK, false);
+	double elapsed = time_now() - time_start;
+	double ticks_per_s = (ticks_now() - ticks_start) / elapsed;
+
+	uint64_t walk, leaf;
+	uct_walk_ticks(&e, &walk, &leaf);
+	if (tree)  *tree = (walk - leaf) / ticks_per_s;
+	engine_done(&e);
+	board_done(&b);
+	return elapsed;
+}
+
+static void
+bench_uct(board_t *empty, char *name, char *playout)
+{
+	double elapsed = time_uct(empty, playout, BENCH_UCT_PLAYOUTS, NULL);
+	bench_result(name, BENCH_UCT_PLAYOUTS, elapsed, "playouts_per_s");
+}
+
+/* Tree descent, expansion and update (including priors): time spent
+ * in uct_playout() outside the leaf playouts, measured during a search
+ * with light playouts. */
+static void
+bench_uct_tree(board_t *empty)
+{
+	double tree;
+	double elapsed = time_uct(empty, "light", BENCH_UCT_PLAYOUTS, &tree);
+	bench_result("uct_light", BENCH_UCT_PLAYOUTS, elapsed, "playouts_per_s");
+	bench_result("uct_tree", BENCH_UCT_PLAYOUTS, tree, NULL);
+}
+
+#ifdef DCNN
+static void
+bench_dcnn(board_t *empty)
+{
+	dcnn_init(empty);
+	if (!using_dcnn(empty))
+		return;
+
+	long ops = 0;
+	double time_start = time_now();
+	for (int r = 0; r < BENCH_DCNN_ROUNDS; r++)
+		for (int i = 0; i < BENCH_GAMES; i++, ops++) {
+			board_t *b = positions[i];
+			float result[board_rsize(b) * board_rsize(b)];
+			dcnn_evaluate_quiet(b, bench_to_play(b), result);
+		}
+	bench_result("dcnn_evaluate", ops, time_now() - time_start, NULL);
+}
+#endif
+
+int
+pachi_bench(int size)
+{
+	board_t *empty = board_new(size, NULL);
+	bench_make_positions(empty);
+
+	printf("{\n  \"version\": \"%s\",\n  \"git\": \"%s\",\n  \"board_size\": %i,\n  \"seed\": %i,\n  \"results\": {",
+	       PACHI_VERSION_FULL, PACHI_VERGIT, size, BENCH_SEED);
+
+	bench_board_play(empty);
+	bench_quick_play(empty);
+	bench_playouts("playout_moggy", playout_moggy_init(NULL, empty), BENCH_MOGGY_PLAYOUTS);
+	bench_playouts("playout_light", playout_light_init(NULL, empty), BENCH_LIGHT_PLAYOUTS);
+	bench_playouts_lockstep("playout_light_lockstep", playout_light_init(NULL, empty), BENCH_LIGHT_PLAYOUTS);
+	bench_patterns();
+	if (using_patterns())
+		bench_playouts("playout_softmax", playout_softmax_init(NULL, empty), BENCH_SOFTMAX_PLAYOUTS);
+	bench_uct_tree(empty);
+	bench_uct(empty, "uct_moggy", "moggy");
+#ifdef DCNN
+	bench_dcnn(empty);
+#endif
+
+	printf("\n  }\n}\n");
+
+	for (int i = 0; i < BENCH_GAMES; i++)
+		board_delete(&positions[i]);
+	board_delete(&empty);
+	return 0;
+}
@@ -0,0 +1,7 @@
+#ifndef PACHI_T_BENCH_BENCH_H
+#define PACHI_T_BENCH_BENCH_H
+
+/* Time hot code paths on a fixed set of positions, print results as json. */
+int pachi_bench(int size);
+
+#endif
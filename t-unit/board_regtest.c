@@ -102,9 +102,9 @@ hash_board(board_t *b)
 		} foreach_point_end;
 	}
 
-	/* Group info */
+	/* Group info (group ids depend on implementation, hash base stones) */
 	foreach_point(b) {
-		hash_int(group_at(b, c));
+		hash_int(group_base(b, group_at(b, c)));
 	} foreach_point_end;
 
 	foreach_point(b) {
@@ -113,7 +113,7 @@ hash_board(board_t *b)
 	
 	foreach_point(b) {
 		group_t g = group_at(b, c);
-		if (!g || g != c)  continue;  /* foreach group really */
+		if (!g || group_base(b, g) != c)  continue;  /* foreach group really */
 		
 		hash_int(c);
 		for (int i = 0; i < board_group_info(b, g).libs; i++)
@@ -144,7 +144,7 @@ hash_board(board_t *b)
 	
 #ifdef WANT_BOARD_C
 	for (int i = 0; i < b->clen; i++) {
-		hash_int(b->c[i]);
+		hash_int(group_base(b, b->c[i]));
 	}
 #endif
 
@@ -0,0 +1,33 @@
+
+% Final position, black wins by 19.5
+boardsize 9
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+
+pass_is_safe b 0 1
+pass_is_safe b 1 1
+
+
+% Same with dead white stones in black's area: must remove them first
+% with pass_all_alive (black would win even with them alive)
+boardsize 9
+komi 0.5
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. O X . X X O O .
+. O X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+. . X . X X O O .
+
+pass_is_safe b 0 1
+pass_is_safe b 1 0
@@ -0,0 +1,3 @@
+% 3x3 patterns: compact table matches hash table for all codes
+pattern3 moggy
+pattern3 ?|?O.O??? ?@?X.X??? .=.O.X??? ?0?O.X??? ?y?X.Q???O XO?O.o?o?X
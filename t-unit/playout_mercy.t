@@ -0,0 +1,15 @@
+
+% Mercy break ends the game
+boardsize 9
+. . . . . . . . .
+. . . . . . . . .
+. . X . . . O . .
+. . . . . . . . .
+. . . . . . . . .
+. . . . . . . . .
+. . O . . . X . .
+. . . . . . . . .
+. . . . . . . . .
+
+playout_mercy b
+playout_mercy w
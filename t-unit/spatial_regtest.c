@@ -30,8 +30,8 @@ fake_ownermap(board_t *b, ownermap_t *ownermap)
 static void
 dump_spatials(board_t *b, pattern_config_t *pc)
 {
-	/* Skip suicides */
-	if (b->moves && board_at(b, last_move(b).coord) == S_NONE)  return;
+	/* Skip passes and suicides */
+	if (b->moves && (is_pass(last_move(b).coord) || board_at(b, last_move(b).coord) == S_NONE))  return;
 
 	//board_print(b, stderr);
 
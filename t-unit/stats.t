@@ -0,0 +1,4 @@
+% Stats: concurrent updates on a single node must not get lost
+stats_stress 1 1000000
+stats_stress 4 250000
+stats_stress 16 100000
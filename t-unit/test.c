@@ -4,9 +4,11 @@
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
+#include <pthread.h>
 
 #include "board.h"
 #include "debug.h"
+#include "engine.h"
 #include "tactics/selfatari.h"
 #include "tactics/dragon.h"
 #include "tactics/ladder.h"
@@ -18,8 +20,13 @@
 #include "playout.h"
 #include "timeinfo.h"
 #include "playout/moggy.h"
+#include "playout/light.h"
+#include "playout/softmax.h"
 #include "engines/replay.h"
 #include "ownermap.h"
+#include "pattern3.h"
+#include "stats.h"
+#include "uct/uct.h"
 
 
 /* Running tests over gtp ? */
@@ -209,6 +216,62 @@ test_sar(board_t *b, char *arg)
 	return   (rres == eres);
 }
 
+/* Check selfatari_quick() table answers against full is_bad_selfatari_slow()
+ * check, for all free points of all positions in moggy regression games. */
+static bool
+test_sar_table(board_t *board, char *arg)
+{
+	int games = 10;
+	args_end();
+	PRINT_TEST(board, "sar_table %i games...\t", games);
+
+	fast_srandom(0x12345);
+	playout_policy_t *policy = playout_moggy_init(NULL, board);
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
+	int checks = 0, quick = 0, errors = 0;
+
+	for (int i = 0; i < games; i++) {
+		board_t b;  board_copy(&b, board);
+		enum stone color = S_BLACK;
+		if (policy->setboard)  policy->setboard(policy, &b);
+
+		int passes = 0;
+		for (int gamelen = setup.gamelen; gamelen-- > 0 && passes < 2; ) {
+			for (int f = 0; f < b.flen; f++) {
+				coord_t c = b.f[f];
+				int libs = immediate_liberty_count(&b, c);
+				if (libs > 1)  continue;
+				for (enum stone col = S_BLACK; col <= S_WHITE; col++)
+				for (int flags = SELFATARI_3LIB_SUICIDE; flags <= SELFATARI_BIG_GROUPS_ONLY; flags++) {
+					enum selfatari_quick r = selfatari_quick(&b, col, c, libs, flags);
+					checks++;
+					if (r == SELFATARI_SLOW)  continue;
+					quick++;
+					if (r == is_bad_selfatari_slow(&b, col, c, flags))  continue;
+					if (DEBUGL(1)) {
+						board_print(&b, stderr);
+						fprintf(stderr, "sar_table: %s %s flags %i: table says %i, full check disagrees\n",
+							stone2str(col), coord2sstr(c), flags, r);
+					}
+					errors++;
+				}
+			}
+
+			coord_t coord = playout_play_move(&setup, &b, color, policy);
+			if (is_pass(coord)) passes++;  else passes = 0;
+			color = stone_other(color);
+		}
+		board_done(&b);
+	}
+	playout_policy_done(policy);
+
+	if (DEBUGL(2))
+		fprintf(stderr, "%i checks, %i (%.1f%%) decided by table, %i errors\t",
+			checks, quick, quick * 100.0 / checks, errors);
+	PRINT_RES(!errors);
+	return !errors;
+}
+
 static bool
 test_corner_seki(board_t *b, char *arg)
 {
@@ -311,7 +374,7 @@ test_wouldbe_ladder(board_t *b, char *arg)
 	
 	assert(board_at(b, c) == S_NONE);
 	group_t g = board_get_2lib_neighbor(b, c, stone_other(color));
-	assert(g); assert(board_at(b, g) == stone_other(color));
+	assert(g); assert(board_at(b, group_base(b, g)) == stone_other(color));
 	coord_t chaselib = c;
 	int rres = wouldbe_ladder(b, g, chaselib);
 	
@@ -334,7 +397,7 @@ test_wouldbe_ladder_any(board_t *b, char *arg)
 	
 	assert(board_at(b, c) == S_NONE);
 	group_t g = board_get_2lib_neighbor(b, c, stone_other(color));
-	assert(g); assert(board_at(b, g) == stone_other(color));
+	assert(g); assert(board_at(b, group_base(b, g)) == stone_other(color));
 	coord_t chaselib = c;
 	int rres = wouldbe_ladder_any(b, g, chaselib);
 	
@@ -448,7 +511,7 @@ static int
 moggy_games(board_t *b, enum stone color, int games, ownermap_t *ownermap, bool speed_benchmark)
 {
 	playout_policy_t *policy = playout_moggy_init(NULL, b);
-	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0);
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
 	ownermap_init(ownermap);
 	
 	int wr = 0;
@@ -556,6 +619,173 @@ test_moggy_status(board_t *b, char *arg)
 	return ret;
 }
 
+typedef struct {
+	move_stats_t *s;
+	int updates;
+} stats_stress_ctx_t;
+
+static void *
+stats_stress_worker(void *data)
+{
+	stats_stress_ctx_t *ctx = (stats_stress_ctx_t*)data;
+	for (int i = 0; i < ctx->updates; i++)
+		stats_add_result(ctx->s, (i & 1), 1);
+	return NULL;
+}
+
+/* Hammer a single move_stats_t from several threads and check
+ * no update got lost. */
+/* Playout stopped by mercy rule: one move in each phase (normal,
+ * bent-fours) then game over. Player doesn't change on break.
+ * Checks both playout_play_game() and playout_play_games().
+ * Syntax:  playout_mercy  color */
+static bool
+test_playout_mercy(board_t *b, char *arg)
+{
+	next_arg(arg);
+	enum stone color = str2stone(arg);
+	args_end();
+
+	PRINT_TEST(b, "playout_mercy %s...\t", stone2str(color));
+
+	assert(color == S_BLACK || color == S_WHITE);
+	playout_policy_t *policy = playout_light_init(NULL, b);
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 20, false);
+	bool passed = true;
+	for (int lockstep = 0; lockstep <= 1; lockstep++) {
+		board_t board2, *b2 = &board2;
+		board_copy(b2, b);
+		b2->captures[color] = 100;  /* Way over mercymin already */
+		int moves = b2->moves;
+
+		if (lockstep) {
+			int result;
+			playout_play_games(&setup, 1, &b2, &color, NULL, NULL, policy, &result);
+		} else
+			playout_play_game(&setup, b2, color, NULL, NULL, policy);
+
+		bool ok = (b2->moves == moves + 2 &&
+			   last_move(b2).color == color && last_move2(b2).color == color);
+		if (!ok && DEBUGL(1))
+			fprintf(stderr, "(%s: %d moves, %s %s) ", (lockstep ? "lockstep" : "single"), b2->moves - moves,
+				stone2str(last_move2(b2).color), stone2str(last_move(b2).color));
+		passed &= ok;
+		board_done(b2);
+	}
+	playout_policy_done(policy);
+
+	PRINT_RES(passed);
+	return passed;
+}
+
+/* Softmax policy: check incremental gamma updates against full recompute.
+ * Syntax:  softmax_update  games */
+static bool
+test_softmax_update(board_t *b, char *arg)
+{
+	next_arg(arg);
+	int games = atoi(arg);
+	args_end();
+
+	PRINT_TEST(b, "softmax_update %i games...\t", games);
+
+	playout_policy_t *policy = playout_softmax_init(NULL, b);
+	bool passed = playout_softmax_check_update(policy, b, games);
+	playout_policy_done(policy);
+
+	PRINT_RES(passed);
+	return passed;
+}
+
+static bool
+test_stats_stress(board_t *b, char *arg)
+{
+	next_arg(arg);
+	int threads = atoi(arg);
+	next_arg(arg);
+	int updates = atoi(arg);
+	args_end();
+	assert(threads > 0 && updates > 0);
+
+	PRINT_TEST(b, "stats_stress %d threads x %d updates...\t", threads, updates);
+
+	move_stats_t s = move_stats(0, 0);
+	stats_stress_ctx_t ctx = { &s, updates };
+	pthread_t thread[threads];
+
+	double start = time_now();
+	for (int i = 0; i < threads; i++)
+		pthread_create(&thread[i], NULL, stats_stress_worker, &ctx);
+	for (int i = 0; i < threads; i++)
+		pthread_join(thread[i], NULL);
+	double elapsed = time_now() - start;
+
+	int lost = threads * updates - s.playouts;
+	if (DEBUGL(1))
+		fprintf(stderr, "lost %d, value %.3f, %.1f ns/update\t", lost, s.value,
+			elapsed * 1e9 / ((double)threads * updates));
+
+#ifdef STATS_ATOMIC
+	bool passed = (!lost && fabs(s.value - 0.5) < 0.01);
+#else
+	bool passed = true;  /* Updates may get lost without atomic stats. */
+#endif
+	PRINT_RES(passed);
+	return passed;
+}
+
+/* Check compact 3x3 pattern table against plain hash table for
+ * moggy patterns or given patterns (pattern3.h syntax, 9 chars +
+ * optional color, no edges since '#' starts a comment). */
+static bool
+test_pattern3(board_t *b, char *arg)
+{
+	char src[64][11];
+	int n = 0;
+	bool moggy = !strcmp(next, "moggy");
+	while (!moggy && *next) {
+		next_arg(arg);
+		int l = strlen(arg);
+		if (n == 64 || (l != 9 && l != 10))  die("Invalid pattern: '%s'\n", arg);
+		strcpy(src[n++], arg);
+	}
+
+	PRINT_TEST(b, "pattern3 %s...\t", (moggy ? "moggy patterns" : "patterns"));
+
+	bool passed = (moggy ? playout_moggy_check_patterns() : pattern3s_check(src, n));
+	PRINT_RES(passed);
+	return passed;
+}
+
+/* Check whether uct thinks passing is safe for @color.
+ * Syntax:  pass_is_safe  color  pass_all_alive  expected_result */
+static bool
+test_pass_is_safe(board_t *b, char *arg)
+{
+	next_arg(arg);
+	enum stone color = str2stone(arg);
+	next_arg(arg);
+	bool pass_all_alive = atoi(arg);
+	next_arg(arg);
+	int eres = atoi(arg);
+	args_end();
+
+	PRINT_TEST(b, "pass_is_safe %s %d %d...\t", stone2str(color), pass_all_alive, eres);
+
+	assert(color == S_BLACK || color == S_WHITE);
+	board_t b2;
+	board_copy(&b2, b);
+	engine_t e;  engine_init(&e, E_UCT, "threads=1", &b2);
+	char *msg;
+	int rres = uct_engine_pass_is_safe(&e, &b2, color, pass_all_alive, &msg);
+	engine_done(&e);
+	board_done(&b2);
+
+	if (rres != eres && DEBUGL(1))  fprintf(stderr, "(%s) ", msg);
+	PRINT_RES(rres == eres);
+	return   (rres == eres);
+}
+
 bool board_undo_stress_test(board_t *orig, char *arg);
 bool board_regression_test(board_t *orig, char *arg);
 bool moggy_regression_test(board_t *orig, char *arg);
@@ -571,6 +801,7 @@ typedef struct {
 
 static t_unit_cmd commands[] = {
 	{ "sar",                    test_sar,               1 },
+	{ "sar_table",              test_sar_table,         0 },
 	{ "ladder",                 test_ladder,            1 },
 	{ "ladder_any",             test_ladder_any,        1 },
 	{ "wouldbe_ladder",         test_wouldbe_ladder,    1 },
@@ -582,6 +813,11 @@ static t_unit_cmd commands[] = {
 	{ "moggy status",           test_moggy_status,      0 },
 	{ "corner_seki",            test_corner_seki,       1 },
 	{ "false_eye_seki",         test_false_eye_seki,    1 },
+	{ "playout_mercy",          test_playout_mercy,     1 },
+	{ "softmax_update",         test_softmax_update,    1 },
+	{ "stats_stress",           test_stats_stress,      1 },
+	{ "pattern3",               test_pattern3,          1 },
+	{ "pass_is_safe",           test_pass_is_safe,      1 },
 #ifdef BOARD_TESTS
 	{ "board_undo_stress_test", board_undo_stress_test, 0 },
 	{ "board_regtest",          board_regression_test,  0 },
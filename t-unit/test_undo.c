@@ -36,6 +36,8 @@ board_quick_cmp(struct board *b1, struct board *b2)
 
 	if (memcmp(b1->b,  b2->b,  sizeof(b1->b))) {
 		fprintf(stderr, "differs in b\n");  return 1;  }
+	if (memcmp(b1->bits, b2->bits, sizeof(b1->bits))) {
+		fprintf(stderr, "differs in bits\n");  return 1;  }
 	if (memcmp(b1->g,  b2->g,  sizeof(b1->g))) {
 		fprintf(stderr, "differs in g\n");  return 1;  }
 	if (memcmp(b1->n,  b2->n,  sizeof(b1->n))) {
@@ -44,15 +46,49 @@ board_quick_cmp(struct board *b1, struct board *b2)
 		fprintf(stderr, "differs in p\n");  return 1;  }
 	if (memcmp(b1->gi, b2->gi, sizeof(b1->gi))) {
 		fprintf(stderr, "differs in gi\n");  return 1;  }
+	if (b1->gfree_n != b2->gfree_n ||
+	    memcmp(b1->gfree, b2->gfree, b1->gfree_n * sizeof(b1->gfree[0]))) {
+		fprintf(stderr, "differs in gfree\n");  return 1;  }
 
 	return 0;
 }
 
+/* Check stone bitboards match b[], eye bitboards board_eye_color() and group libmaps */
+static void
+board_check_bits(board_t *b)
+{
+	bitboard_t eyes[S_MAX];
+	board_eye_bits(b, eyes);
+	foreach_point(b) {
+		enum stone eye = (board_at(b, c) == S_NONE ? board_eye_color(b, c) : S_NONE);
+		for (enum stone color = S_BLACK; color <= S_WHITE; color++) {
+			assert(bitboard_test(board_stone_bits(b, color), c) == (board_at(b, c) == color));
+			assert(bitboard_test(&eyes[color], c) == (eye == color));
+		}
+	} foreach_point_end;
+
+#ifdef BOARD_LIBMAP
+	/* Check libmap has all liberties and nothing else */
+	foreach_point(b) {
+		group_t g = group_at(b, c);
+		if (!g || group_base(b, g) != c)  continue;  /* foreach group */
+		bitboard_t libs;  bitboard_clear(&libs);
+		foreach_in_group(b, g) {
+			coord_t stone = c;
+			foreach_neighbor(b, stone, {
+				if (board_at(b, c) == S_NONE)  bitboard_set(&libs, c);
+			});
+		} foreach_in_group_end;
+		assert(!memcmp(&libs, &board_group_info(b, g).libmap, sizeof(libs)));
+	} foreach_point_end;
+#endif
+}
+
 static void
 board_dump_group(board_t *b, group_t g)
 {
         printf("group base: %s  color: %s  libs: %i  stones: %i\n",
-               coord2sstr(g), stone2str(board_at(b, g)),
+               coord2sstr(group_base(b, g)), stone2str(board_at(b, group_base(b, g))),
                board_group_info(b, g).libs, group_stone_count(b, g, 500));
 
         printf("  stones: ");
@@ -133,6 +169,7 @@ test_undo(board_t *orig, coord_t c, enum stone color)
 
 	move_t m = move(c, color);
 	int r = board_play(&b, &m);  assert(r >= 0);
+	board_check_bits(&b);
 
 	with_move(&b2, c, color, {
 		// Check state after quick_board_play() matches
@@ -185,7 +222,7 @@ board_undo_stress_test(board_t *board, char *arg)
 
 	// Light policy better to test wild multi-group suicides
 	playout_policy_t *policy = playout_light_init(NULL, board);
-	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0);
+	playout_setup_t setup = playout_setup(MAX_GAMELEN, 0, false);
 	
 	// Hijack policy permit()
 	policy_permit = policy->permit;  policy->permit = permit_hook;
@@ -22,7 +22,7 @@ capturing_group_is_snapback(board_t *b, group_t group)
 	    group_stone_count(b, group, 2) > 1)
 		return false;
 	
-	enum stone to_play = stone_other(board_at(b, group));
+	enum stone to_play = stone_other(board_at(b, group_base(b, group)));
 	enum stone other = stone_other(to_play);	
 	if (board_is_eyelike(b, lib, other))
 		return false;
@@ -78,7 +78,7 @@ can_play_on_lib(board_t *b, group_t g, enum stone to_play)
 bool
 can_countercapture(board_t *b, group_t group, move_queue_t *q, int tag)
 {
-	enum stone color = board_at(b, group);
+	enum stone color = board_at(b, group_base(b, group));
 	enum stone other = stone_other(color);
 	assert(color == S_BLACK || color == S_WHITE);	
 	// Not checking b->clen, not maintained by board_quick_play()
@@ -109,7 +109,7 @@ bool
 countercapturable_groups(board_t *b, group_t group, move_queue_t *q)
 {
 	q->moves = 0;
-	enum stone color = board_at(b, group);
+	enum stone color = board_at(b, group_base(b, group));
 	enum stone other = stone_other(color);
 	assert(color == S_BLACK || color == S_WHITE);	
 	// Not checking b->clen, not maintained by board_quick_play()
@@ -133,7 +133,7 @@ countercapturable_groups(board_t *b, group_t group, move_queue_t *q)
 bool
 can_countercapture_any(board_t *b, group_t group, move_queue_t *q, int tag)
 {
-	enum stone color = board_at(b, group);
+	enum stone color = board_at(b, group_base(b, group));
 	enum stone other = stone_other(color);
 	assert(color == S_BLACK || color == S_WHITE);
 	// Not checking b->clen, not maintained by board_quick_play()
@@ -178,12 +178,12 @@ void
 group_atari_check(unsigned int alwaysccaprate, board_t *b, group_t group, enum stone to_play,
                   move_queue_t *q, coord_t *ladder, bool middle_ladder, int tag)
 {
-	enum stone color = board_at(b, group_base(group));
+	enum stone color = board_at(b, group_base(b, group));
 	coord_t lib = board_group_info(b, group).lib[0];
 
 	assert(color != S_OFFBOARD && color != S_NONE);
 	if (DEBUGL(5))  fprintf(stderr, "[%s] atariiiiiiiii %s of color %d\n",
-				coord2sstr(group), coord2sstr(lib), color);
+				coord2sstr(group_base(b, group)), coord2sstr(lib), color);
 	assert(board_at(b, lib) == S_NONE);
 
 	if (to_play != color) {
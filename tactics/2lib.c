@@ -94,7 +94,7 @@ can_atari_group(board_t *b, group_t group, enum stone owner,
 
 		if (DEBUGL(6))  fprintf(stderr, "- checking liberty %s of %s %s, filled by %s\n",
 					coord2sstr(lib),
-					stone2str(owner), coord2sstr(group),
+					stone2str(owner), coord2sstr(group_base(b, group)),
 					stone2str(to_play));
 
 		/* Don't play at the spot if it is extremely short
@@ -142,9 +142,9 @@ can_atari_group(board_t *b, group_t group, enum stone owner,
 			if (is_pass(coord))  continue;
 			
 			/* Ok, connect, but prefer not to. */
-			enum stone byowner = board_at(b, bygroup);
+			enum stone byowner = board_at(b, group_base(b, bygroup));
 			if (DEBUGL(7))  fprintf(stderr, "\treluctantly switching to cousin %s (group %s %s)\n",
-						coord2sstr(coord), coord2sstr(bygroup), stone2str(byowner));
+						coord2sstr(coord), coord2sstr(group_base(b, bygroup)), stone2str(byowner));
 			/* One more thing - is the cousin sensible defense
 			 * for the other group? */
 			if (defense_is_hopeless(b, bygroup, byowner, to_play, coord, lib, use_def_no_hopeless))
@@ -194,7 +194,7 @@ can_atari_group(board_t *b, group_t group, enum stone owner,
 	if (DEBUGL(7)) {
 		char label[256];
 		snprintf(label, 256, "= final %s %s liberties to play by %s",
-			stone2str(owner), coord2sstr(group),
+			stone2str(owner), coord2sstr(group_base(b, group)),
 			stone2str(to_play));
 		mq_print(q, label);
 	}
@@ -203,11 +203,11 @@ can_atari_group(board_t *b, group_t group, enum stone owner,
 void
 group_2lib_check(board_t *b, group_t group, enum stone to_play, move_queue_t *q, int tag, bool use_miaisafe, bool use_def_no_hopeless)
 {
-	enum stone color = board_at(b, group_base(group));
+	enum stone color = board_at(b, group_base(b, group));
 	assert(color != S_OFFBOARD && color != S_NONE);
 
 	if (DEBUGL(5))  fprintf(stderr, "[%s] 2lib check of color %d\n",
-				coord2sstr(group), color);
+				coord2sstr(group_base(b, group)), color);
 
 	/* Do not try to atari groups that cannot be harmed. */
 	if (use_miaisafe && miai_2lib(b, group, color))
@@ -255,11 +255,11 @@ can_capture_2lib_group(board_t *b, group_t g, move_queue_t *q, int tag)
 void
 group_2lib_capture_check(board_t *b, group_t group, enum stone to_play, move_queue_t *q, int tag, bool use_miaisafe, bool use_def_no_hopeless)
 {
-	enum stone color = board_at(b, group_base(group));
+	enum stone color = board_at(b, group_base(b, group));
 	assert(color != S_OFFBOARD && color != S_NONE);
 	
 	if (DEBUGL(5))  fprintf(stderr, "[%s] 2lib capture check of color %d\n",
-				coord2sstr(group), color);
+				coord2sstr(group_base(b, group)), color);
 
 	if (to_play != color) {  /* Attacker */		
 		can_capture_2lib_group(b, group, q, tag);
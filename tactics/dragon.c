@@ -77,7 +77,7 @@ print_dragons(board_t *board, coord_t c, void *data)
 			;
 		if (!dragons[i])  {  dragons[i] = d;  }  /* Add new */			
 		
-		before = pick_dragon_color(i, (c == d), true);  // Dragon base: bold
+		before = pick_dragon_color(i, (c == group_base(board, d)), true);  // Dragon base: bold
 		after = ansi_color_end;
 	}
 		
@@ -152,9 +152,9 @@ static int
 foreach_in_connected_groups_(board_t *b, enum stone color, group_t g, 
 			     foreach_in_connected_groups_t f, void *data, int *visited)
 {
-	if (visited[group_base(g)])
+	if (visited[group_base(b, g)])
 		return 0;
-	visited[group_base(g)] = 1;
+	visited[group_base(b, g)] = 1;
 
 	foreach_in_group(b, g) {
 		if (f(b, color, c, data) == -1)
@@ -169,7 +169,7 @@ foreach_in_connected_groups_(board_t *b, enum stone color, group_t g,
 				if (board_at(b, c) != color)
 					continue;
 				group_t g2 = group_at(b, c);
-				if (visited[g2] || !virtual_connection_at(b, color, lib, c, g, g2))
+				if (visited[group_base(b, g2)] || !virtual_connection_at(b, color, lib, c, g, g2))
 					continue;
 				if (foreach_in_connected_groups_(b, color, g2, f, data, visited) == -1)
 					return -1;
@@ -197,10 +197,10 @@ static int
 foreach_connected_group_(board_t *b, enum stone color, group_t g, 
 			 foreach_connected_group_t f, void *data, int *visited)
 {
-	if (visited[group_base(g)])
+	if (visited[group_base(b, g)])
 		return 0;
 
-	visited[group_base(g)] = 1;
+	visited[group_base(b, g)] = 1;
 	if (f(b, color, g, data) == -1)
 		return -1;
 
@@ -212,7 +212,7 @@ foreach_connected_group_(board_t *b, enum stone color, group_t g,
 				if (board_at(b, c) != color)
 					continue;
 				group_t g2 = group_at(b, c);
-				if (visited[g2] || !virtual_connection_at(b, color, lib, c, g, g2))
+				if (visited[group_base(b, g2)] || !virtual_connection_at(b, color, lib, c, g, g2))
 					continue;
 				if (foreach_connected_group_(b, color, g2, f, data, visited) == -1)
 					return -1;
@@ -490,7 +490,7 @@ bool
 dragon_is_safe_full(board_t *b, group_t g, enum stone color, int *visited, int *eyes)
 {
 	safe_data_t d = { visited, eyes };
-	foreach_lib_in_connected_groups(b, color, g, count_eyes, &d);
+	foreach_lib_in_connected_groups(b, color, group_base(b, g), count_eyes, &d);
 	return (*eyes >= 2);
 }
 
@@ -538,9 +538,9 @@ bool
 neighbor_is_safe(board_t *b, group_t g)
 {
 	group_t neighbors[BOARD_MAX_GROUPS];
-	int n = group_neighbors(b, g, neighbors);
+	int n = group_neighbors(b, group_base(b, g), neighbors);
 	for (int i = 0; i < n; i++)
-		if (dragon_is_safe(b, neighbors[i], board_at(b, neighbors[i])))
+		if (dragon_is_safe(b, neighbors[i], board_at(b, group_base(b, neighbors[i]))))
 			return true;
 	return false;
 }
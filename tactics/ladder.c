@@ -1,6 +1,8 @@
 #include <assert.h>
+#include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #define QUICK_BOARD_CODE
 
@@ -13,6 +15,8 @@
 #include "tactics/selfatari.h"
 #include "tactics/dragon.h"
 #include "tactics/ladder.h"
+#include "random.h"
+#include "timeinfo.h"
 
 
 /* Read out middle ladder countercap sequences ? Otherwise we just
@@ -24,7 +28,7 @@ bool
 is_border_ladder(board_t *b, group_t laddered)
 {
 	coord_t coord = board_group_info(b, laddered).lib[0];
-	enum stone lcolor = board_at(b, group_base(laddered));
+	enum stone lcolor = board_at(b, group_base(b, laddered));
 	
 	if (can_countercapture(b, laddered, NULL, 0))
 		return false;
@@ -74,16 +78,104 @@ is_border_ladder(board_t *b, group_t laddered)
 }
 
 
+/* Middle ladder cache:
+ * Same ladders get read again and again (playouts, priors, pattern features)
+ * so middle ladder readings are cached. While reading we keep track of the
+ * area it depends on: bounding box of laddered group stones and liberties
+ * at each step (moves played are liberties), liberties of neighbors in atari
+ * (countercaptures), + 1 line, extended with stones of groups inside (until
+ * no new group gets in). An entry is valid as long as this region is
+ * unchanged: stones, group bases and liberty counts (region hash), so moves
+ * outside it don't invalidate it.
+ *
+ * Cache is shared by all threads, lockless: entries are 2 words and store
+ * hash ^ data in the first one so that torn reads don't match. */
+
+/* Check cache hits against reading (debugging) */
+//#define LADDER_CACHE_CHECK 1
+
+#define LADDER_CACHE_BUCKETS    4096
+#define LADDER_CACHE_WAYS       4
+#define LADDER_CACHE_MIN_NODES  3     /* Don't bother caching shorter readings */
+#define LADDER_CACHE_MAX_AREA   160   /* Hashing bigger regions costs too much */
+
+typedef struct {
+	uint64_t check;   /* region hash ^ data */
+	uint64_t data;
+} ladder_cache_entry_t;
+
+/* Entry data: key (first liberty, color, board stride), region, result */
+#define LC_VALID       (1ULL << 63)
+#define LC_KEY_MASK    (LC_VALID | 0x1ffffULL)
+#define lc_x0(d)       ((int)(((d) >> 17) & 0x1f))
+#define lc_y0(d)       ((int)(((d) >> 22) & 0x1f))
+#define lc_x1(d)       ((int)(((d) >> 27) & 0x1f))
+#define lc_y1(d)       ((int)(((d) >> 32) & 0x1f))
+#define lc_len(d)      ((int)(((d) >> 37) & 0xff))
+
+static ladder_cache_entry_t ladder_cache[LADDER_CACHE_BUCKETS][LADDER_CACHE_WAYS];
+
+/* Stats counters are per thread (no contention on lookups),
+ * summed up by ladder_cache_stats(). */
+typedef struct lc_thread_stats {
+	ladder_cache_stats_t s;
+	struct lc_thread_stats *next;
+} lc_thread_stats_t;
+
+/* Live threads' stats, and stats of threads which exited. */
+static lc_thread_stats_t *lc_stats_threads = NULL;
+static ladder_cache_stats_t lc_stats_exited;
+static pthread_mutex_t lc_stats_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_key_t lc_stats_key;
+static pthread_once_t lc_stats_once = PTHREAD_ONCE_INIT;
+static __thread ladder_cache_stats_t *lc_stats;  /* Current thread's */
+
+/* Region read by current middle ladder reading. */
+typedef struct {
+	int x0, y0, x1, y1;
+	int nodes;
+} ladder_region_t;
+
+static __thread ladder_region_t region;
+
+static inline void
+region_add(coord_t c)
+{
+	int x = coord_x(c), y = coord_y(c);
+	if (x < region.x0)  region.x0 = x;
+	if (x > region.x1)  region.x1 = x;
+	if (y < region.y0)  region.y0 = y;
+	if (y > region.y1)  region.y1 = y;
+}
+
+/* Laddered group stones, liberties, and liberties of neighbors in atari
+ * (countercaptures get checked even if they don't get played). */
+static void
+region_add_laddered(board_t *b, group_t laddered)
+{
+	foreach_in_group(b, laddered) {
+		region_add(c);
+		foreach_neighbor(b, c, {
+			group_t g = group_at(b, c);
+			if (g && g != laddered && board_group_info(b, g).libs == 1)
+				region_add(board_group_info(b, g).lib[0]);
+		});
+	} foreach_in_group_end;
+	for (int i = 0; i < board_group_info(b, laddered).libs; i++)
+		region_add(board_group_info(b, laddered).lib[i]);
+}
+
 static int middle_ladder_walk(board_t *b, group_t laddered, enum stone lcolor, coord_t prevmove, int len);
 
+/* @lstone: a stone of laddered group (group id changes if it merges) */
 static int
-middle_ladder_chase(board_t *b, group_t laddered, enum stone lcolor, coord_t prevmove, int len)
+middle_ladder_chase(board_t *b, coord_t lstone, enum stone lcolor, coord_t prevmove, int len)
 {
-	laddered = group_at(b, laddered);
+	group_t laddered = group_at(b, lstone);
 	
 	if (DEBUGL(8)) {
 		board_print(b, stderr);
-		fprintf(stderr, "%s c %d\n", coord2sstr(laddered), board_group_info(b, laddered).libs);
+		fprintf(stderr, "%s c %d\n", coord2sstr(lstone), board_group_info(b, laddered).libs);
 	}
 
 	if (!laddered || board_group_info(b, laddered).libs == 1) {
@@ -94,6 +186,7 @@ middle_ladder_chase(board_t *b, group_t laddered, enum stone lcolor, coord_t pre
 		if (DEBUGL(6))  fprintf(stderr, "* we are free now\n");
 		return 0;
 	}
+	region_add_laddered(b, laddered);
 
 	/* Now, consider alternatives. */
 	int liblist[2], libs = 0;
@@ -136,6 +229,7 @@ middle_ladder_chase(board_t *b, group_t laddered, enum stone lcolor, coord_t pre
 static bool
 chaser_capture_escapes(board_t *b, group_t laddered, enum stone lcolor, move_queue_t *ccq)
 {
+	coord_t lstone = group_base(b, laddered);
 	for (unsigned int i = 0; i < ccq->moves; i++) {
 		coord_t lib = ccq->move[i];
 		if (!board_is_valid_play(b, lcolor, lib))
@@ -152,7 +246,7 @@ chaser_capture_escapes(board_t *b, group_t laddered, enum stone lcolor, move_que
 		}
 
 		with_move_strict(b, lib, lcolor, {
-			if (!middle_ladder_chase(b, laddered, lcolor, lib, 0))
+			if (!middle_ladder_chase(b, lstone, lcolor, lib, 0))
 				with_move_return(true); /* escape ! */		
 		});
 
@@ -184,6 +278,9 @@ middle_ladder_walk(board_t *b, group_t laddered, enum stone lcolor, coord_t prev
 				}
 		});
 
+	region.nodes++;
+	region_add_laddered(b, laddered);
+
 	/* Check countercaptures */
 	move_queue_t ccq;  mq_init(&ccq);
 	can_countercapture(b, laddered, &ccq, 0);
@@ -193,9 +290,10 @@ middle_ladder_walk(board_t *b, group_t laddered, enum stone lcolor, coord_t prev
 
 	/* Escape then */
 	coord_t nextmove = board_group_info(b, laddered).lib[0];
+	coord_t lstone = group_base(b, laddered);
 	if (DEBUGL(6))  fprintf(stderr, "  ladder escape %s\n", coord2sstr(nextmove));
 	with_move_strict(b, nextmove, lcolor, {
-		len = middle_ladder_chase(b, laddered, lcolor, nextmove, len + 1);
+		len = middle_ladder_chase(b, lstone, lcolor, nextmove, len + 1);
 	});
 
 	return len;
@@ -203,11 +301,210 @@ middle_ladder_walk(board_t *b, group_t laddered, enum stone lcolor, coord_t prev
 
 static __thread int length = 0;
 
+static uint64_t
+ladder_region_hash(board_t *b, group_t laddered, int x0, int y0, int x1, int y1)
+{
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for (int y = y0; y <= y1; y++)
+		for (int x = x0; x <= x1; x++) {
+			coord_t c = coord_xy(x, y);
+			uint64_t v = board_at(b, c);
+			group_t g = group_at(b, c);
+			if (g)
+				v |= (uint64_t)group_base(b, g) << 2 | (uint64_t)board_group_info(b, g).libs << 12
+				     | (uint64_t)(g == laddered) << 20;
+			h = (h ^ v) * 0x100000001b3ULL;
+		}
+	if (!is_pass(b->ko.coord))
+		h = (h ^ (b->ko.coord | (uint64_t)last_move(b).coord << 16)) * 0x100000001b3ULL;
+	return h;
+}
+
+static inline ladder_cache_entry_t *
+ladder_cache_bucket(board_t *b, coord_t lib, enum stone lcolor)
+{
+	/* Reading region always contains the 3x3 area around first liberty. */
+	uint64_t h = lib * 0x9e3779b97f4a7c15ULL ^ lcolor;
+	foreach_8neighbor(b, lib) {
+		h = (h ^ board_at(b, c)) * 0x100000001b3ULL;
+	} foreach_8neighbor_end;
+	h ^= h >> 29;
+	return ladder_cache[h % LADDER_CACHE_BUCKETS];
+}
+
+static inline uint64_t
+ladder_cache_key(board_t *b, coord_t lib, enum stone lcolor)
+{
+	return LC_VALID | lib | (uint64_t)lcolor << 10 | (uint64_t)board_stride(b) << 12;
+}
+
+static void
+ladder_cache_stats_add(ladder_cache_stats_t *to, ladder_cache_stats_t *s)
+{
+	to->lookups += s->lookups;
+	to->hits += s->hits;
+	to->stores += s->stores;
+	to->stored_ticks += s->stored_ticks;
+}
+
+/* Thread exit: keep its stats, unregister. */
+static void
+lc_stats_thread_done(void *data)
+{
+	lc_thread_stats_t *t = (lc_thread_stats_t*)data;
+	pthread_mutex_lock(&lc_stats_mutex);
+	ladder_cache_stats_add(&lc_stats_exited, &t->s);
+	for (lc_thread_stats_t **p = &lc_stats_threads; *p; p = &(*p)->next)
+		if (*p == t) {
+			*p = t->next;
+			break;
+		}
+	pthread_mutex_unlock(&lc_stats_mutex);
+	free(t);
+}
+
+static void
+lc_stats_key_init(void)
+{
+	pthread_key_create(&lc_stats_key, lc_stats_thread_done);
+}
+
+static ladder_cache_stats_t *
+ladder_cache_thread_stats(void)
+{
+	if (likely(lc_stats))
+		return lc_stats;
+
+	pthread_once(&lc_stats_once, lc_stats_key_init);
+	lc_thread_stats_t *t = calloc2(1, lc_thread_stats_t);
+	pthread_setspecific(lc_stats_key, t);
+	pthread_mutex_lock(&lc_stats_mutex);
+	t->next = lc_stats_threads;
+	lc_stats_threads = t;
+	pthread_mutex_unlock(&lc_stats_mutex);
+	return (lc_stats = &t->s);
+}
+
+static bool
+ladder_cache_lookup(board_t *b, group_t laddered, ladder_cache_entry_t *bucket, uint64_t key, int *len)
+{
+	ladder_cache_stats_t *stats = ladder_cache_thread_stats();
+	stats->lookups++;
+	for (int i = 0; i < LADDER_CACHE_WAYS; i++) {
+		uint64_t data  = __atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED);
+		uint64_t check = __atomic_load_n(&bucket[i].check, __ATOMIC_RELAXED);
+		if ((data & LC_KEY_MASK) != key)
+			continue;
+		uint64_t h = ladder_region_hash(b, laddered, lc_x0(data), lc_y0(data), lc_x1(data), lc_y1(data));
+		if ((h ^ data) != check)
+			continue;
+		stats->hits++;
+		*len = lc_len(data);
+		return true;
+	}
+	return false;
+}
+
+/* Store current reading result. @ticks: reading time */
+static void
+ladder_cache_store(board_t *b, group_t laddered, ladder_cache_entry_t *bucket, uint64_t key, int len, uint64_t ticks)
+{
+	/* Area around what was read, and groups inside. */
+	int last = board_stride(b) - 1;
+	int x0 = (region.x0 > 0 ? region.x0 - 1 : 0), x1 = (region.x1 < last ? region.x1 + 1 : last);
+	int y0 = (region.y0 > 0 ? region.y0 - 1 : 0), y1 = (region.y1 < last ? region.y1 + 1 : last);
+	region.x0 = x0;  region.y0 = y0;  region.x1 = x1;  region.y1 = y1;
+
+	/* Extend with groups inside until the box stops growing:
+	 * stones of new groups may bring in more groups. */
+	bool grown = true;
+	while (grown) {
+		if ((region.x1 - region.x0 + 1) * (region.y1 - region.y0 + 1) > LADDER_CACHE_MAX_AREA)
+			return;
+		x0 = region.x0;  y0 = region.y0;  x1 = region.x1;  y1 = region.y1;
+		for (int y = y0; y <= y1; y++)
+			for (int x = x0; x <= x1; x++) {
+				group_t g = group_at(b, coord_xy(x, y));
+				if (g)  foreach_in_group(b, g) {
+					region_add(c);
+				} foreach_in_group_end;
+			}
+		grown = (region.x0 != x0 || region.y0 != y0 || region.x1 != x1 || region.y1 != y1);
+	}
+
+	uint64_t data = key | (uint64_t)region.x0 << 17 | (uint64_t)region.y0 << 22 |
+			(uint64_t)region.x1 << 27 | (uint64_t)region.y1 << 32 | (uint64_t)(len < 255 ? len : 255) << 37;
+	uint64_t h = ladder_region_hash(b, laddered, region.x0, region.y0, region.x1, region.y1);
+
+	/* Replace an empty entry or a random one. */
+	int i;
+	for (i = 0; i < LADDER_CACHE_WAYS; i++)
+		if (!__atomic_load_n(&bucket[i].data, __ATOMIC_RELAXED))
+			break;
+	if (i == LADDER_CACHE_WAYS)
+		i = fast_random(LADDER_CACHE_WAYS);
+	__atomic_store_n(&bucket[i].check, h ^ data, __ATOMIC_RELAXED);
+	__atomic_store_n(&bucket[i].data, data, __ATOMIC_RELAXED);
+
+	ladder_cache_stats_t *stats = ladder_cache_thread_stats();
+	stats->stores++;
+	stats->stored_ticks += ticks;
+}
+
+/* middle_ladder_walk() from the top, through the cache. */
+static int
+middle_ladder_read(board_t *b, group_t laddered, enum stone lcolor)
+{
+	coord_t lib = board_group_info(b, laddered).lib[0];
+	ladder_cache_entry_t *bucket = ladder_cache_bucket(b, lib, lcolor);
+	uint64_t key = ladder_cache_key(b, lib, lcolor);
+	int len;
+	if (ladder_cache_lookup(b, laddered, bucket, key, &len)) {
+#ifdef LADDER_CACHE_CHECK
+		ladder_region_t saved = region;
+		int l = middle_ladder_walk(b, laddered, lcolor, pass, 0);
+		region = saved;
+		if (l != len) {
+			board_print(b, stderr);
+			die("ladder cache: %s %s: cached %i, read %i\n", stone2str(lcolor), coord2sstr(lib), len, l);
+		}
+#endif
+		return len;
+	}
+
+	/* Readings may nest (wouldbe_ladder() ...) */
+	ladder_region_t saved = region;
+	region.x0 = region.x1 = coord_x(lib);
+	region.y0 = region.y1 = coord_y(lib);
+	region.nodes = 0;
+
+	uint64_t start = ticks_now();
+	len = middle_ladder_walk(b, laddered, lcolor, pass, 0);
+	if (region.nodes >= LADDER_CACHE_MIN_NODES)
+		ladder_cache_store(b, laddered, bucket, key, len, ticks_now() - start);
+
+	region = saved;
+	return len;
+}
+
+/* Running threads' counters are read without synchronization,
+ * numbers may be slightly off while a search is running. */
+void
+ladder_cache_stats(ladder_cache_stats_t *s)
+{
+	memset(s, 0, sizeof(*s));
+	pthread_mutex_lock(&lc_stats_mutex);
+	ladder_cache_stats_add(s, &lc_stats_exited);
+	for (lc_thread_stats_t *t = lc_stats_threads; t; t = t->next)
+		ladder_cache_stats_add(s, &t->s);
+	pthread_mutex_unlock(&lc_stats_mutex);
+}
+
 bool
 is_middle_ladder(board_t *b, group_t laddered)
 {
 	coord_t coord = board_group_info(b, laddered).lib[0];
-	enum stone lcolor = board_at(b, group_base(laddered));
+	enum stone lcolor = board_at(b, group_base(b, laddered));
 
 	/* If we can move into empty space or do not have enough space
 	 * to escape, this is obviously not a ladder. */
@@ -219,7 +516,7 @@ is_middle_ladder(board_t *b, group_t laddered)
 	/* A fair chance for a ladder. Group in atari, with some but limited
 	 * space to escape. Time for the expensive stuff - play it out and
 	 * start selective 2-liberty search. */
-	length = middle_ladder_walk(b, laddered, lcolor, pass, 0);
+	length = middle_ladder_read(b, laddered, lcolor);
 
 	if (DEBUGL(6) && length)  fprintf(stderr, "is_ladder(): stones: %i  length: %i\n",
 					  group_stone_count(b, laddered, 50), length);
@@ -230,9 +527,9 @@ is_middle_ladder(board_t *b, group_t laddered)
 bool
 is_middle_ladder_any(board_t *b, group_t laddered)
 {
-	enum stone lcolor = board_at(b, group_base(laddered));
+	enum stone lcolor = board_at(b, group_base(b, laddered));
 	
-	length = middle_ladder_walk(b, laddered, lcolor, pass, 0);
+	length = middle_ladder_read(b, laddered, lcolor);
 	return (length != 0);
 }
 
@@ -241,7 +538,7 @@ wouldbe_ladder(board_t *b, group_t group, coord_t chaselib)
 {
 	assert(board_group_info(b, group).libs == 2);
 	
-	enum stone lcolor = board_at(b, group_base(group));
+	enum stone lcolor = board_at(b, group_base(b, group));
 	enum stone other_color = stone_other(lcolor);
 	coord_t escapelib = board_group_other_lib(b, group, chaselib);
 
@@ -273,7 +570,7 @@ wouldbe_ladder_any(board_t *b, group_t group, coord_t chaselib)
 {
 	assert(board_group_info(b, group).libs == 2);
 	
-	enum stone lcolor = board_at(b, group_base(group));
+	enum stone lcolor = board_at(b, group_base(b, group));
 	enum stone other_color = stone_other(lcolor);
 
 	// FIXME should assert instead here
@@ -308,11 +605,12 @@ useful_ladder(board_t *b, group_t laddered)
 		return false;
 
 	coord_t lib = board_group_info(b, laddered).lib[0];
-	enum stone lcolor = board_at(b, laddered);
+	coord_t lstone = group_base(b, laddered);
+	enum stone lcolor = board_at(b, lstone);
 
 	/* Check capturing group is surrounded */
 	with_move(b, lib, stone_other(lcolor), {	
-		assert(!group_at(b, laddered));
+		assert(!group_at(b, lstone));
 		if (!dragon_is_surrounded(b, lib))
 			with_move_return(false);
 	});
@@ -376,7 +674,7 @@ is_double_atari(board_t *b, coord_t c, enum stone color)
 static bool
 ladder_with_tons_of_double_ataris(board_t *b, group_t laddered, enum stone color)
 {
-	assert(board_at(b, laddered) == stone_other(color));
+	assert(board_at(b, group_base(b, laddered)) == stone_other(color));
 
 	int double_ataris = 0;
 	foreach_in_group(b, laddered) {
@@ -29,6 +29,16 @@ bool useful_ladder(board_t *b, group_t laddered);
 /* Playing out non-working ladder and getting ugly ? */
 bool harmful_ladder_atari(board_t *b, coord_t atari, enum stone color);
 
+/* Middle ladder reading cache counters (cumulative, all threads).
+ * Saved reading time can be estimated from average time of stored
+ * readings. */
+typedef struct {
+	uint64_t lookups, hits;
+	uint64_t stores, stored_ticks;   /* Readings stored, time spent reading them (ticks_now()) */
+} ladder_cache_stats_t;
+
+void ladder_cache_stats(ladder_cache_stats_t *s);
+
 bool is_border_ladder(board_t *b, group_t laddered);
 bool is_middle_ladder(board_t *b, group_t laddered);
 bool is_middle_ladder_any(board_t *b, group_t laddered);
@@ -36,21 +46,21 @@ static inline bool
 is_ladder(board_t *b, group_t laddered, bool test_middle)
 {
 	assert(laddered);
-	assert(group_at(b, laddered) == laddered);
+	assert(group_at(b, group_base(b, laddered)) == laddered);
 	assert(board_group_info(b, laddered).libs == 1);
 
 	if (DEBUGL(6)) {
 		coord_t coord = board_group_info(b, laddered).lib[0];
-		enum stone lcolor = board_at(b, group_base(laddered));
+		enum stone lcolor = board_at(b, group_base(b, laddered));
 		fprintf(stderr, "ladder check - does %s play out %s's laddered group %s?\n",
-			coord2sstr(coord), stone2str(lcolor), coord2sstr(laddered));
+			coord2sstr(coord), stone2str(lcolor), coord2sstr(group_base(b, laddered)));
 	}
 
 	if (!test_middle) {
 		/* First, special-case first-line "ladders". This is a huge chunk
 		 * of ladders we actually meet and want to play. */
 		coord_t coord = board_group_info(b, laddered).lib[0];
-		enum stone lcolor = board_at(b, group_base(laddered));
+		enum stone lcolor = board_at(b, group_base(b, laddered));
 		if (neighbor_count_at(b, coord, S_OFFBOARD) == 1
 		    && neighbor_count_at(b, coord, lcolor) == 1) {
 			bool l = is_border_ladder(b, laddered);
@@ -68,21 +78,21 @@ static inline bool
 is_ladder_any(board_t *b, group_t laddered, bool test_middle)
 {
 	assert(laddered);
-	assert(group_at(b, laddered) == laddered);
+	assert(group_at(b, group_base(b, laddered)) == laddered);
 	assert(board_group_info(b, laddered).libs == 1);
 
 	if (DEBUGL(6)) {
 		coord_t coord = board_group_info(b, laddered).lib[0];
-		enum stone lcolor = board_at(b, group_base(laddered));
+		enum stone lcolor = board_at(b, group_base(b, laddered));
 		fprintf(stderr, "ladder check - does %s play out %s's laddered group %s?\n",
-			coord2sstr(coord), stone2str(lcolor), coord2sstr(laddered));
+			coord2sstr(coord), stone2str(lcolor), coord2sstr(group_base(b, laddered)));
 	}
 
 	if (!test_middle) {
 		/* First, special-case first-line "ladders". This is a huge chunk
 		 * of ladders we actually meet and want to play. */
 		coord_t coord = board_group_info(b, laddered).lib[0];
-		enum stone lcolor = board_at(b, group_base(laddered));
+		enum stone lcolor = board_at(b, group_base(b, laddered));
 		if (neighbor_count_at(b, coord, S_OFFBOARD) == 1
 		    && neighbor_count_at(b, coord, lcolor) == 1) {
 			bool l = is_border_ladder(b, laddered);
@@ -18,9 +18,9 @@ group_nlib_defense_check(board_t *b, group_t group, enum stone to_play, move_que
 {
 	enum stone color = to_play;
 	assert(color != S_OFFBOARD && color != S_NONE
-	       && color == board_at(b, group_base(group)));
+	       && color == board_at(b, group_base(b, group)));
 
-	if (DEBUGL(5))  fprintf(stderr, "[%s] nlib defense check of color %d\n", coord2sstr(group), color);
+	if (DEBUGL(5))  fprintf(stderr, "[%s] nlib defense check of color %d\n", coord2sstr(group_base(b, group)), color);
 
 #if 0
 	/* XXX: The code below is specific for 3-liberty groups. Its impact
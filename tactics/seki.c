@@ -202,7 +202,7 @@ breaking_3_stone_seki(board_t *b, coord_t coord, enum stone color)
 	if (can_countercapture(b, g3, NULL, 0))
 		return false;
 	int visited[BOARD_MAX_COORDS] = {0, };
-	if (!big_eye_area(b, color, group_base(g3), visited))
+	if (!big_eye_area(b, color, group_base(b, g3), visited))
 		return false;
 	
 	/* Already have 2 eyes ? No need for seki then */
@@ -214,10 +214,11 @@ breaking_3_stone_seki(board_t *b, coord_t coord, enum stone color)
 	bool safe = false;
 	coord_t lib1 = board_group_info(b, g3).lib[0];
 	coord_t lib2 = board_group_info(b, g3).lib[1];
+	coord_t own_base = group_base(b, own), g3_base = group_base(b, g3);
 	with_move(b, lib1, color, {
 		with_move(b, lib2, color, {
-			group_t g = group_at(b, own);
-			assert(g);  assert(!group_at(b, g3));
+			group_t g = group_at(b, own_base);
+			assert(g);  assert(!group_at(b, g3_base));
 			safe = dragon_is_safe(b, g, color);
 		});
 	});
@@ -197,7 +197,8 @@ examine_enemy_groups(board_t *b, enum stone color, coord_t to, selfatari_state_t
 		if (s->libs > 0 || !group_is_onestone(b, g))
 			return false;
 		/* ...or, it's a ko stone, */
-		if (neighbor_count_at(b, g, color) + neighbor_count_at(b, g, S_OFFBOARD) == 3) {
+		coord_t stone = group_base(b, g);
+		if (neighbor_count_at(b, stone, color) + neighbor_count_at(b, stone, S_OFFBOARD) == 3) {
 			/* and we don't have a group to save: then, just taking
 			 * single stone means snapback! */
 			if (!s->friend_has_no_libs)
@@ -368,6 +369,7 @@ useful_nakade_making_dead_shape(board_t *b, enum stone color, coord_t to, selfat
         {
 	    int would_live = false;
 	    int prev_neighbor = neighbor_count_at(b, to, color);
+	    coord_t base = group_base(b, s->groupids[color][0]);  /* Group info is gone once captured */
 
 	    /* Play opponent color where we want to play */
 	    with_move(b, to, stone_other(color), {
@@ -386,13 +388,11 @@ useful_nakade_making_dead_shape(board_t *b, enum stone color, coord_t to, selfat
 			
 			with_move_strict(b, board_group_info(b, standing).lib[0], stone_other(color), {
 				/* Empty now since it's been captured */
-				coord_t empty = group_base(s->groupids[color][0]);
-				would_live = !nakade_dead_shape(b, empty, stone_other(color));
+				would_live = !nakade_dead_shape(b, base, stone_other(color));
 			});
 		}
 		else {  /* Empty now since it's been captured */			
-			coord_t empty = group_base(s->groupids[color][0]);
-			would_live = !nakade_dead_shape(b, empty, stone_other(color));
+			would_live = !nakade_dead_shape(b, base, stone_other(color));
 		}
 	    });
 
@@ -683,6 +683,46 @@ init_selfatari_state(board_t *b, enum stone color, coord_t to, selfatari_state_t
 	});	
 }
 
+uint8_t selfatari_table[2][64];
+
+/* Outcome of is_bad_selfatari_slow() when it only depends on the
+ * neighbors (see selfatari_quick() for index layout). Follows
+ * examine_friendly_groups() and examine_enemy_groups() logic. */
+static enum selfatari_quick
+selfatari_table_entry(int idx, int flags)
+{
+	int libs = idx & 1;
+	bool friend[5] = { false, idx & 2, idx & 4, idx & 8, idx & 16 };
+	bool enemy_in_atari = idx & 32;
+
+	/* Friendly group with 3 libs: can't tell if we'd kill it clumsily. */
+	if (friend[3] && (flags & SELFATARI_3LIB_SUICIDE))
+		return SELFATARI_SLOW;
+	/* Connecting out to 3+ libs. */
+	if (friend[3] || friend[4])
+		return SELFATARI_NO;
+	/* Friendly group with 2 libs: depends on its other liberty. */
+	if (friend[2])
+		return SELFATARI_SLOW;
+	/* Capture with an outside liberty gets us 2 libs. */
+	if (enemy_in_atari)
+		return (libs ? SELFATARI_NO : SELFATARI_SLOW);
+	/* Suicide. */
+	if (!libs)
+		return SELFATARI_YES;
+	/* Throw-in, nakade ... */
+	return SELFATARI_SLOW;
+}
+
+static __attribute__((constructor)) void
+selfatari_table_init(void)
+{
+	for (int idx = 0; idx < 64; idx++) {
+		selfatari_table[0][idx] = selfatari_table_entry(idx, SELFATARI_3LIB_SUICIDE);
+		selfatari_table[1][idx] = selfatari_table_entry(idx, SELFATARI_BIG_GROUPS_ONLY);
+	}
+}
+
 bool
 is_bad_selfatari_slow(board_t *b, enum stone color, coord_t to, int flags)
 {
@@ -755,10 +795,10 @@ selfatari_cousin(board_t *b, enum stone color, coord_t coord, group_t *bygroup)
 		 * group to filling own approach liberties. */
 		int gl = fast_random(groups_n);
 		for (gn = gl; gn < groups_n; gn++)
-			if (board_at(b, groups[gn]) == stone_other(color))
+			if (board_at(b, group_base(b, groups[gn])) == stone_other(color))
 				goto found;
 		for (gn = 0; gn < gl; gn++)
-			if (board_at(b, groups[gn]) == stone_other(color))
+			if (board_at(b, group_base(b, groups[gn])) == stone_other(color))
 				goto found;
 found:;
 	} else {
@@ -772,13 +812,13 @@ found:;
 		coord_t lib2;
 		/* Can we get liberties by capturing a neighbor? */
 		move_queue_t ccq;  mq_init(&ccq);
-		if (board_at(b, group) == color &&
+		if (board_at(b, group_base(b, group)) == color &&
 		    can_countercapture(b, group, &ccq, 0)) {
 			lib2 = mq_pick(&ccq);
 
 		} else {
 			lib2 = board_group_other_lib(b, group, coord);
-			if (board_is_one_point_eye(b, lib2, board_at(b, group)))
+			if (board_is_one_point_eye(b, lib2, board_at(b, group_base(b, group))))
 				continue;
 			if (is_bad_selfatari(b, color, lib2))
 				continue;
@@ -36,13 +36,43 @@ coord_t selfatari_cousin(board_t *b, enum stone color, coord_t coord, group_t *b
 
 bool is_bad_selfatari_slow(board_t *b, enum stone color, coord_t to, int flags);
 
+/* Quick answer for moves with at most one immediate liberty: most of them
+ * can be decided from the neighbors alone. Table index: immediate liberty
+ * (bit 0), friendly neighbor group with 1, 2, 3, 4+ libs (bits 1-4), enemy
+ * neighbor group in atari (bit 5). One table for is_bad_selfatari(), one for
+ * is_really_bad_selfatari(). */
+enum selfatari_quick {
+	SELFATARI_NO = 0,
+	SELFATARI_YES = 1,
+	SELFATARI_SLOW = 2,	/* Needs full is_bad_selfatari_slow() check */
+};
+extern uint8_t selfatari_table[2][64];
+
+static inline enum selfatari_quick
+selfatari_quick(board_t *b, enum stone color, coord_t to, int libs, int flags)
+{
+	int idx = libs;
+	foreach_neighbor(b, to, {
+		group_t g = group_at(b, c);
+		if (!g)  continue;
+		int glibs = board_group_info(b, g).libs;
+		if (board_at(b, c) == color)  idx |= 1 << (glibs < 4 ? glibs : 4);
+		else if (glibs == 1)          idx |= 1 << 5;
+	});
+	return selfatari_table[!!(flags & SELFATARI_BIG_GROUPS_ONLY)][idx];
+}
+
 static inline bool
 is_bad_selfatari(board_t *b, enum stone color, coord_t to)
 {
 	/* More than one immediate liberty, thumbs up! */
-	if (immediate_liberty_count(b, to) > 1)
+	int libs = immediate_liberty_count(b, to);
+	if (libs > 1)
 		return false;
 
+	enum selfatari_quick r = selfatari_quick(b, color, to, libs, SELFATARI_3LIB_SUICIDE);
+	if (r != SELFATARI_SLOW)
+		return r;
 	return is_bad_selfatari_slow(b, color, to, SELFATARI_3LIB_SUICIDE);
 }
 
@@ -50,9 +80,13 @@ static inline bool
 is_really_bad_selfatari(board_t *b, enum stone color, coord_t to)
 {
 	/* More than one immediate liberty, thumbs up! */
-	if (immediate_liberty_count(b, to) > 1)
+	int libs = immediate_liberty_count(b, to);
+	if (libs > 1)
 		return false;
 
+	enum selfatari_quick r = selfatari_quick(b, color, to, libs, SELFATARI_BIG_GROUPS_ONLY);
+	if (r != SELFATARI_SLOW)
+		return r;
 	return is_bad_selfatari_slow(b, color, to, SELFATARI_BIG_GROUPS_ONLY);
 }
 
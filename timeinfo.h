@@ -9,7 +9,9 @@
  * with all engines. */
 
 #include <stdbool.h>
+#include <stdint.h>
 #include <limits.h>
+#include <time.h>
 
 #include "board.h"
 
@@ -105,6 +107,22 @@ char *time_str();
 /* Sleep for a given interval (in seconds). Return immediately if interval < 0. */
 void time_sleep(double interval);
 
+/* Cheap timestamp for profiling counters: cpu cycles where we have
+ * a cycle counter, nanoseconds otherwise (TICKS_UNIT). */
+#if defined(__x86_64__) || defined(__i386__)
+#define TICKS_UNIT "cycles"
+static inline uint64_t ticks_now(void)  {  return __builtin_ia32_rdtsc();  }
+#else
+#define TICKS_UNIT "ns"
+static inline uint64_t
+ticks_now(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+#endif
+
 
 /* Based on existing time information, compute the optimal/maximal time
  * to be spent on this move. */
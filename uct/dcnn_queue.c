@@ -0,0 +1,227 @@
+#include <assert.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "board.h"
+#include "debug.h"
+#include "dcnn.h"
+#include "timeinfo.h"
+#include "util.h"
+#include "uct/dcnn_queue.h"
+#include "uct/tree.h"
+
+/* How long the dcnn thread waits for a batch to fill up
+ * before evaluating a partial batch (in seconds). */
+#define DCNN_QUEUE_WAIT 0.002
+
+typedef struct {
+	tree_node_t *node;
+	int parity;
+} dcnn_request_t;
+
+struct dcnn_queue {
+	int size;		/* Board size */
+	int input_size;		/* Floats per position */
+	int batch_size;
+	int max_pending;
+	int eqex;
+
+	/* Ring buffer of pending requests, with their input planes. */
+	dcnn_request_t *req;
+	float *data;
+	int head, pending;
+
+	/* Batch being evaluated */
+	dcnn_request_t *batch;
+	float *batch_data;
+	float *batch_result;
+
+	pthread_t thread;
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;
+	bool busy, quit;
+
+	/* Statistics, reset with dcnn_queue_stats_reset() */
+	int submitted, dropped, evaluated, batches;
+	double time;		/* Time spent in forward passes */
+};
+
+/* Merge dcnn priors into node's children, same values as uct_prior_dcnn(). */
+static void
+dcnn_queue_merge(dcnn_queue_t *q, dcnn_request_t *r, float *result)
+{
+	tree_node_t *node = r->node;
+	floating_t value = (r->parity > 0 ? 1.0 : 0.0);
+	for (tree_node_t *ni = node->children; ni; ni = ni->sibling) {
+		coord_t c = node_coord(ni);
+		if (is_pass(c))
+			continue;
+		float val = result[coord2dcnn_idx(c)];
+		if (isnan(val) || val < 0.001)
+			continue;
+		stats_add_result(&node_prior(ni), value, sqrt(val) * q->eqex);
+	}
+	__sync_fetch_and_or(&node->hints, TREE_HINT_DCNN);
+}
+
+static void
+timespec_after(struct timespec *ts, double delay)
+{
+	double t = time_now() + delay;
+	ts->tv_sec = (time_t)t;
+	ts->tv_nsec = (long)((t - ts->tv_sec) * 1000000000);
+}
+
+static void *
+dcnn_queue_thread(void *q_)
+{
+	dcnn_queue_t *q = (dcnn_queue_t*)q_;
+
+	pthread_mutex_lock(&q->mutex);
+	while (1) {
+		/* Wait for a full batch, or for a partial one to sit long enough. */
+		while (!q->quit && q->pending < q->batch_size) {
+			if (!q->pending) {
+				pthread_cond_wait(&q->cond, &q->mutex);
+				continue;
+			}
+			struct timespec ts;  timespec_after(&ts, DCNN_QUEUE_WAIT);
+			if (pthread_cond_timedwait(&q->cond, &q->mutex, &ts) && q->pending)
+				break;
+		}
+		if (q->quit)
+			break;
+
+		int n = (q->pending < q->batch_size ? q->pending : q->batch_size);
+		for (int i = 0; i < n; i++) {
+			int slot = (q->head + i) % q->max_pending;
+			q->batch[i] = q->req[slot];
+			memcpy(&q->batch_data[i * q->input_size], &q->data[slot * q->input_size],
+			       q->input_size * sizeof(float));
+		}
+		q->head = (q->head + n) % q->max_pending;
+		q->pending -= n;
+		q->busy = true;
+		pthread_mutex_unlock(&q->mutex);
+
+		double time_start = time_now();
+		dcnn_evaluate_batch(q->size, q->batch_data, q->batch_result, n);
+		double elapsed = time_now() - time_start;
+		for (int i = 0; i < n; i++)
+			dcnn_queue_merge(q, &q->batch[i], &q->batch_result[i * q->size * q->size]);
+
+		pthread_mutex_lock(&q->mutex);
+		q->busy = false;
+		q->evaluated += n;
+		q->batches++;
+		q->time += elapsed;
+		pthread_cond_broadcast(&q->cond);
+	}
+	pthread_mutex_unlock(&q->mutex);
+	return NULL;
+}
+
+dcnn_queue_t *
+dcnn_queue_init(board_t *b, int batch_size, int max_pending, int eqex)
+{
+	assert(batch_size > 0 && max_pending >= batch_size);
+	dcnn_queue_t *q = calloc2(1, dcnn_queue_t);
+	q->size = board_rsize(b);
+	q->input_size = dcnn_input_size(b);
+	q->batch_size = batch_size;
+	q->max_pending = max_pending;
+	q->eqex = eqex;
+
+	q->req = calloc2(max_pending, dcnn_request_t);
+	q->data = calloc2(max_pending * q->input_size, float);
+	q->batch = calloc2(batch_size, dcnn_request_t);
+	q->batch_data = calloc2(batch_size * q->input_size, float);
+	q->batch_result = calloc2(batch_size * q->size * q->size, float);
+
+	pthread_mutex_init(&q->mutex, NULL);
+	pthread_cond_init(&q->cond, NULL);
+	pthread_create(&q->thread, NULL, dcnn_queue_thread, q);
+	return q;
+}
+
+void
+dcnn_queue_done(dcnn_queue_t *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->quit = true;
+	pthread_cond_broadcast(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+	pthread_join(q->thread, NULL);
+
+	pthread_cond_destroy(&q->cond);
+	pthread_mutex_destroy(&q->mutex);
+	free(q->req);
+	free(q->data);
+	free(q->batch);
+	free(q->batch_data);
+	free(q->batch_result);
+	free(q);
+}
+
+void
+dcnn_queue_submit(dcnn_queue_t *q, tree_node_t *node, board_t *b, enum stone color, int parity)
+{
+	if (board_rsize(b) != q->size)
+		return;
+	if (q->pending >= q->max_pending) {  /* Unlocked peek, avoid encoding for nothing */
+		__sync_fetch_and_add(&q->dropped, 1);
+		return;
+	}
+
+	float data[q->input_size];
+	dcnn_encode(b, color, data);
+
+	pthread_mutex_lock(&q->mutex);
+	if (q->pending >= q->max_pending) {
+		__sync_fetch_and_add(&q->dropped, 1);
+		pthread_mutex_unlock(&q->mutex);
+		return;
+	}
+	int slot = (q->head + q->pending) % q->max_pending;
+	q->req[slot] = (dcnn_request_t) { node, parity };
+	memcpy(&q->data[slot * q->input_size], data, sizeof(data));
+	q->pending++;
+	q->submitted++;
+	if (q->pending == 1 || q->pending == q->batch_size)
+		pthread_cond_signal(&q->cond);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+void
+dcnn_queue_flush(dcnn_queue_t *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->pending = 0;
+	while (q->busy)
+		pthread_cond_wait(&q->cond, &q->mutex);
+	pthread_mutex_unlock(&q->mutex);
+}
+
+void
+dcnn_queue_stats_reset(dcnn_queue_t *q)
+{
+	pthread_mutex_lock(&q->mutex);
+	q->submitted = q->dropped = q->evaluated = q->batches = 0;
+	q->time = 0;
+	pthread_mutex_unlock(&q->mutex);
+}
+
+void
+dcnn_queue_print_stats(dcnn_queue_t *q, FILE *f)
+{
+	pthread_mutex_lock(&q->mutex);
+	fprintf(f, "dcnn queue: %d nodes submitted, %d dropped, %d evaluated in %d batches (avg %.1f), %.1f pos/s\n",
+		q->submitted, q->dropped, q->evaluated, q->batches,
+		q->batches ? (double)q->evaluated / q->batches : 0.0,
+		q->time > 0 ? q->evaluated / q->time : 0.0);
+	pthread_mutex_unlock(&q->mutex);
+}
@@ -0,0 +1,49 @@
+#ifndef PACHI_UCT_DCNN_QUEUE_H
+#define PACHI_UCT_DCNN_QUEUE_H
+
+/* Asynchronous dcnn evaluation of interior tree nodes.
+ *
+ * Normally only the root gets dcnn priors (uct_prior_dcnn()): on cpu a
+ * forward pass is far too slow to run inline for every expanded node.
+ * With the queue, tree_expand_node() submits the position of each newly
+ * expanded node and a dedicated thread evaluates them in batches of up
+ * to batch_size positions. When results arrive the dcnn priors are
+ * merged into the node's children, until then they only have pattern
+ * priors. Requests are dropped when the queue is full. */
+
+#include <stdio.h>
+
+#include "board.h"
+#include "uct/tree.h"
+
+typedef struct dcnn_queue dcnn_queue_t;
+
+#ifdef DCNN
+
+dcnn_queue_t *dcnn_queue_init(board_t *b, int batch_size, int max_pending, int eqex);
+void dcnn_queue_done(dcnn_queue_t *q);
+
+/* Queue evaluation of @node's position. @parity is the prior map parity
+ * (see tree_expand_node()). This function may be called by multiple
+ * threads in parallel. */
+void dcnn_queue_submit(dcnn_queue_t *q, tree_node_t *node, board_t *b, enum stone color, int parity);
+
+/* Drop pending requests and wait for the current batch to be merged.
+ * Must be called before nodes get freed or moved (tree gc, promotion...) */
+void dcnn_queue_flush(dcnn_queue_t *q);
+
+void dcnn_queue_stats_reset(dcnn_queue_t *q);
+void dcnn_queue_print_stats(dcnn_queue_t *q, FILE *f);
+
+#else
+
+#define dcnn_queue_init(b, batch_size, max_pending, eqex)  (NULL)
+#define dcnn_queue_done(q)                                  ((void)0)
+#define dcnn_queue_submit(q, node, b, color, parity)        ((void)0)
+#define dcnn_queue_flush(q)                                 ((void)0)
+#define dcnn_queue_stats_reset(q)                           ((void)0)
+#define dcnn_queue_print_stats(q, f)                        ((void)0)
+
+#endif
+
+#endif
@@ -14,6 +14,8 @@
 #include "mq.h"
 #include "uct/tree.h"
 #include "uct/prior.h"
+#include "uct/ttable.h"
+#include "uct/dcnn_queue.h"
 
 struct uct_prior;
 struct uct_dynkomi;
@@ -40,6 +42,8 @@ typedef enum local_tree_eval {
 } local_tree_eval_t;
 
 /* Internal engine state. */
+typedef struct uct_pool uct_pool_t;
+
 typedef struct uct {
 	int debug_level;
 	enum uct_reporting reporting;
@@ -50,6 +54,7 @@ typedef struct uct {
 	int games, gamelen;
 	floating_t resign_threshold, sure_win_threshold;
 	double best2_ratio, bestr_ratio;
+	double stop_confidence;
 	floating_t max_maintime_ratio;
 	bool pass_all_alive; /* Current value */
 	bool allow_losing_pass;
@@ -62,14 +67,21 @@ typedef struct uct {
 	int force_seed;
 	bool no_tbook;
 	bool fast_alloc;
+	int tree_arena;  /* TREE_ARENA_* flags */
 	size_t max_tree_size;
 	size_t max_pruned_size;
 	size_t pruning_threshold;
 	int mercymin;
+	bool playout_cycles;
 	int significant_threshold;
 	bool genmove_reset_tree;
+	int ttable_bits;
+	ttable_t *ttable; /* Transposition table, NULL unless enabled */
 
 	int threads;
+	bool pin_threads;  /* Pin each worker to a cpu */
+	int ownermap_merge;  /* Workers fill a private ownermap, merged every n playouts. 0: fill shared one */
+	struct uct_pool *pool;  /* Search threads, see search.c */
 	enum uct_thread_model thread_model;
 	int virtual_loss;
 	bool slave; /* Act as slave in distributed engine. */
@@ -78,8 +90,12 @@ typedef struct uct {
 	enum stone my_color;
 
 	bool pondering_opt;                /* User wants pondering */
+	bool ponder_gc;                    /* Collect tree while pondering */
 	bool pondering;                    /* Actually pondering now */
 	bool genmove_pondering;            /* Regular pondering (after a genmove) */
+	int     dcnn_batch;                /* Async dcnn for interior nodes, batch size */
+	int     dcnn_queue_size;           /* Async dcnn max pending positions */
+	dcnn_queue_t *dcnn_queue;          /* NULL unless async dcnn enabled */
 	int     dcnn_pondering_prior;      /* Prior next move guesses */
 	int     dcnn_pondering_mcts;       /* Genmove next move guesses */
 	coord_t dcnn_pondering_mcts_c[20];
@@ -141,6 +157,11 @@ typedef struct uct {
 	
 	/* Timing */
 	double mcts_time_start;
+	int early_stops;          /* Searches stopped early this game */
+	double early_stop_saved;  /* Time saved by early stops (seconds) */
+	bool time_tree;           /* Measure walk time outside playouts */
+	uint64_t walk_ticks;      /* Last search, all threads: uct_playout() */
+	uint64_t playout_ticks;   /*   and leaf playouts (see ticks_now()) */
 
 	/* Game state - maintained by setup_state(), reset_state(). */
 	tree_t *t;
@@ -190,6 +211,7 @@ struct uct_policy {
 	uctp_prior prior;
 	uctp_done done;
 	bool wants_amaf;
+	bool wants_crit;  /* Needs criticality stats in tree nodes */
 	void *data;
 };
 
@@ -26,10 +26,10 @@ uctp_generic_choose(uct_policy_t *p, tree_node_t *node, board_t *b, enum stone c
 		// child; comparing values is more brittle
 		if (node_coord(ni) == exclude || ni->hints & TREE_HINT_INVALID)
 			continue;
-		if (ni->u.playouts > nbest->u.playouts) {
+		if (node_u(ni).playouts > node_u(nbest).playouts) {
 			nbest2 = nbest;
 			nbest = ni;
-		} else if (ni->u.playouts > nbest2->u.playouts) {
+		} else if (node_u(ni).playouts > node_u(nbest2).playouts) {
 			nbest2 = ni;
 		}
 	}
@@ -109,11 +109,11 @@ ucb1rave_evaluate(uct_policy_t *p, tree_t *tree, uct_descent_t *descent, int par
 	tree_node_t *node = descent->node;
 	tree_node_t *lnode = descent->lnode;
 
-	move_stats_t n = node->u, r = node->amaf;
+	move_stats_t n = node_u(node), r = node_amaf(node);
 	if (p->uct->amaf_prior) {
-		stats_merge(&r, &node->prior);
+		stats_merge(&r, &node_prior(node));
 	} else {
-		stats_merge(&n, &node->prior);
+		stats_merge(&n, &node_prior(node));
 	}
 
 	if (p->uct->virtual_loss) {
@@ -129,7 +129,7 @@ ucb1rave_evaluate(uct_policy_t *p, tree_t *tree, uct_descent_t *descent, int par
 	assert(!lnode || lnode->parent);
 	if (p->uct->local_tree && b->ltree_rave > 0 && lnode
 	    && (p->uct->local_tree_rootchoose || lnode->parent->parent)) {
-		move_stats_t l = lnode->u;
+		move_stats_t l = node_u(lnode);
 		l.playouts = ((floating_t) l.playouts) * b->ltree_rave / LTREE_PLAYOUTS_MULTIPLIER;
 		URAVE_DEBUG fprintf(stderr, "[ltree] adding [%s] %f%%%d to [%s] RAVE %f%%%d\n",
 			coord2sstr(node_coord(lnode)), l.value, l.playouts,
@@ -139,8 +139,8 @@ ucb1rave_evaluate(uct_policy_t *p, tree_t *tree, uct_descent_t *descent, int par
 
 	/* Criticality heuristics. */
 	if (b->crit_rave > 0 && (b->crit_plthres_coef > 0
-				 ? node->u.playouts > tree->root->u.playouts * b->crit_plthres_coef
-				 : node->u.playouts > b->crit_min_playouts)) {
+				 ? node_u(node).playouts > node_u(tree->root).playouts * b->crit_plthres_coef
+				 : node_u(node).playouts > b->crit_min_playouts)) {
 		floating_t crit = tree_node_criticality(tree, node);
 		if (b->crit_negative || crit > 0) {
 			floating_t val = 1.0f;
@@ -168,21 +168,21 @@ ucb1rave_evaluate(uct_policy_t *p, tree_t *tree, uct_descent_t *descent, int par
 					+ (floating_t) n.playouts * r.playouts / b->equiv_rave);
 			} else {
 				/* XXX: This can be cached in descend; but we don't use this by default. */
-				beta = sqrt(b->equiv_rave / (3 * node->parent->u.playouts + b->equiv_rave));
+				beta = sqrt(b->equiv_rave / (3 * node_u(node->parent).playouts + b->equiv_rave));
 			}
 
 			value = beta * r.value + (1.f - beta) * n.value;
 			URAVE_DEBUG fprintf(stderr, "\t%s value = %f * %f + (1 - %f) * %f (prior %f)\n",
-			        coord2sstr(node_coord(node)), beta, r.value, beta, n.value, node->prior.value);
+			        coord2sstr(node_coord(node)), beta, r.value, beta, n.value, node_prior(node).value);
 		} else {
 			value = n.value;
 			URAVE_DEBUG fprintf(stderr, "\t%s value = %f (prior %f)\n",
-			        coord2sstr(node_coord(node)), n.value, node->prior.value);
+			        coord2sstr(node_coord(node)), n.value, node_prior(node).value);
 		}
 	} else if (r.playouts) {
 		value = r.value;
 		URAVE_DEBUG fprintf(stderr, "\t%s value = rave %f (prior %f)\n",
-			coord2sstr(node_coord(node)), r.value, node->prior.value);
+			coord2sstr(node_coord(node)), r.value, node_prior(node).value);
 	}
 	descent->value.playouts = r.playouts + n.playouts;
 	descent->value.value = value;
@@ -196,7 +196,7 @@ ucb1rave_descend(uct_policy_t *p, tree_t *tree, uct_descent_t *descent, int pari
 	ucb1_policy_amaf_t *b = (ucb1_policy_amaf_t*)p->data;
 	floating_t nconf = 1.f;
 	if (b->explore_p > 0)
-		nconf = sqrt(log(descent->node->u.playouts + descent->node->prior.playouts));
+		nconf = sqrt(log(node_u(descent->node).playouts + node_prior(descent->node).playouts));
 	uct_t *u = p->uct;
 #ifdef DISTRIBUTED
 	int vwin = 0;
@@ -213,14 +213,14 @@ ucb1rave_descend(uct_policy_t *p, tree_t *tree, uct_descent_t *descent, int pari
 		/* In distributed mode, encourage different slaves to work on different
 		 * parts of the tree. We rely on the fact that children (if they exist)
 		 * are the same and in the same order in all slaves. */
-		if (vwin > 0 && ni->u.playouts > b->vwin_min_playouts && (child - u->slave_index) % u->max_slaves == 0)
-			urgency += vwin / (ni->u.playouts + vwin);
+		if (vwin > 0 && node_u(ni).playouts > b->vwin_min_playouts && (child - u->slave_index) % u->max_slaves == 0)
+			urgency += vwin / (node_u(ni).playouts + vwin);
 #endif
 
-		if (ni->u.playouts > 0 && b->explore_p > 0) {
-			urgency += b->explore_p * nconf / fast_sqrt(ni->u.playouts);
+		if (node_u(ni).playouts > 0 && b->explore_p > 0) {
+			urgency += b->explore_p * nconf / fast_sqrt(node_u(ni).playouts);
 
-		} else if (ni->u.playouts + ni->amaf.playouts + ni->prior.playouts == 0) {
+		} else if (node_u(ni).playouts + node_amaf(ni).playouts + node_prior(ni).playouts == 0) {
 			/* assert(!u->even_eqex); */
 			urgency = b->fpu;
 		}
@@ -279,11 +279,11 @@ ucb1amaf_update(uct_policy_t *p, tree_t *tree, tree_node_t *node,
 		first_move[map->game[move]] = move;
 
 	while (node) {
-		if (!b->crit_amaf && !is_pass(node_coord(node))) {
-			stats_add_result(&node->winner_owner, board_local_value(b->crit_lvalue, final_board, node_coord(node), winner_color), 1);
-			stats_add_result(&node->black_owner, board_local_value(b->crit_lvalue, final_board, node_coord(node), S_BLACK), 1);
+		if (tree->crit_stats && !b->crit_amaf && !is_pass(node_coord(node))) {
+			stats_add_result(&node_winner_owner(node), board_local_value(b->crit_lvalue, final_board, node_coord(node), winner_color), 1);
+			stats_add_result(&node_black_owner(node), board_local_value(b->crit_lvalue, final_board, node_coord(node), S_BLACK), 1);
 		}
-		stats_add_result(&node->u, result, 1);
+		stats_add_result(&node_u(node), result, 1);
 
 		bool *ko_capture_map = &map->is_ko_capture[move+1];
 		int max_threat_dist = b->threat_rave <= 0 ? ko_length(ko_capture_map, map->gamelen - (move+1)) : -1;
@@ -314,17 +314,17 @@ ucb1amaf_update(uct_policy_t *p, tree_t *tree, tree_node_t *node,
 				/* Give more weight to moves played earlier */
 				weight += b->distance_rave * (map->gamelen - first) / (map->gamelen - move);
 			}
-			stats_add_result(&ni->amaf, res, weight);
+			stats_add_result(&node_amaf(ni), res, weight);
 
-			if (b->crit_amaf) {
-				stats_add_result(&ni->winner_owner, board_local_value(b->crit_lvalue, final_board, node_coord(ni), winner_color), 1);
-				stats_add_result(&ni->black_owner, board_local_value(b->crit_lvalue, final_board, node_coord(ni), S_BLACK), 1);
+			if (tree->crit_stats && b->crit_amaf) {
+				stats_add_result(&node_winner_owner(ni), board_local_value(b->crit_lvalue, final_board, node_coord(ni), winner_color), 1);
+				stats_add_result(&node_black_owner(ni), board_local_value(b->crit_lvalue, final_board, node_coord(ni), S_BLACK), 1);
 			}
 #if 0
 			board_t bb; bb.size = 9+2;
-			fprintf(stderr, "* %s<%" PRIhash "> -> %s<%" PRIhash "> [%d/%f => %d/%f]\n",
-				coord2sstr(node_coord(node)), node->hash,
-				coord2sstr(node_coord(ni)), ni->hash,
+			fprintf(stderr, "* %s<%p> -> %s<%p> [%d/%f => %d/%f]\n",
+				coord2sstr(node_coord(node)), node,
+				coord2sstr(node_coord(ni)), ni,
 				player_color, result, move, res);
 #endif
 		}
@@ -433,5 +433,8 @@ policy_ucb1amaf_init(uct_t *u, char *arg, board_t *board)
 		}
 	}
 
+	/* Criticality stats cost 16 bytes per node, only keep them if used. */
+	p->wants_crit = (b->crit_rave > 0);
+
 	return p;
 }
@@ -31,10 +31,10 @@ get_node_prior_best_moves(tree_node_t *parent, coord_t *best_c, float *best_r, i
 	
 	float max = 0.0;
 	for (tree_node_t *n = parent->children; n; n = n->sibling)
-		max = MAX(max, n->prior.playouts);
+		max = MAX(max, node_prior(n).playouts);
 
 	for (tree_node_t *n = parent->children; n; n = n->sibling)
-		best_moves_add(node_coord(n), (float)n->prior.playouts / max, best_c, best_r, nbest);
+		best_moves_add(node_coord(n), (float)node_prior(n).playouts / max, best_c, best_r, nbest);
 }
 
 /* Display node's priors best moves. */
@@ -53,57 +53,183 @@ default_ti_init(void)
 /* Minimal time to consider early break (in seconds). */
 #define TIME_EARLY_BREAK_MIN 1.0
 
+/* Minimal best move playouts to trust its confidence bounds. */
+#define CONFIDENCE_EARLY_BREAK_MIN 1000
+
 
 /* Pachi threading structure:
  *
  * main thread
  *   |         main(), GTP communication, ...
- *   |         starts and stops the search managed by thread_manager
- *   |
- * thread_manager
- *   |         spawns and collects worker threads
+ *   |         starts and stops the search by waking up / parking the
+ *   |         worker pool
  *   |
  * worker0
  * worker1
  * ...
  * workerK
  *             uct_playouts() loop, doing descend-playout until uct_halt
+ * logger
+ *             progress reports while pondering
+ *
+ * The worker pool is created at engine init (uct_pool_init()) and
+ * the threads are parked on a condition variable between searches, so
+ * starting or stopping a search doesn't create or join any thread.
+ * Optionally workers are pinned to a cpu each (pin_threads uct option).
+ * Changing threads or pin_threads recreates the pool (uct_pool_update()).
  *
  * Another way to look at it is by functions (lines denote thread boundaries):
  *
  * | uct_genmove()
  * | uct_search()            (uct_search_start() .. uct_search_stop())
  * | -----------------------
- * | spawn_thread_manager()
- * | -----------------------
- * | spawn_worker()
+ * | pool_thread()
+ * | uct_worker()
  * V uct_playouts() */
 
-/* Set in thread manager in case the workers should stop. */
+/* Set in case the workers should stop. */
 volatile sig_atomic_t uct_halt = 0;
-/* ID of the thread manager. */
-static pthread_t thread_manager;
 bool thread_manager_running;
 
-static pthread_mutex_t finish_mutex = PTHREAD_MUTEX_INITIALIZER;
-static pthread_cond_t finish_cond = PTHREAD_COND_INITIALIZER;
-static volatile int finish_thread;
-static pthread_mutex_t finish_serializer = PTHREAD_MUTEX_INITIALIZER;
+struct uct_pool {
+	int workers;		/* Number of search threads */
+	bool pinned;		/* Workers pinned to a cpu each */
+	pthread_t *threads;	/* workers + logger */
+	uct_thread_ctx_t *ctx;
+
+	pthread_mutex_t mutex;
+	pthread_cond_t cond;	/* Broadcast on any state change below */
+	int generation;		/* Bumped each time a search starts */
+	int running;		/* Threads still busy with current search */
+	bool stopping;		/* uct_search_stop() called */
+	bool quit;
+
+	/* Pondering gc: workers pause while the tree is collected */
+	bool gc_pending;
+	int paused;
+
+	/* Job for idle / paused workers, see uct_pool_run() */
+	void (*job)(void *ctx);
+	void *job_ctx;
+	int job_slots;		/* Helpers that may still join */
+	int job_running;	/* Helpers running the job */
+
+	/* Latency statistics for last search (in seconds) */
+	double start_time, started_time, stop_time, stopped_time;
+	int started;
+};
+
+/* In search manager context, we use only some of the ctx fields. */
+static uct_thread_ctx_t mctx;
 
 static void  uct_expand_next_best_moves(uct_t *u, tree_t *t, board_t *b, enum stone color);
-static void *spawn_logger(void *ctx_);
+static void  uct_logger(uct_thread_ctx_t *ctx);
 
-static void *
-spawn_worker(void *ctx_)
+/* Help with current pool job if there's a free slot.
+ * Called with pool mutex held. */
+static bool
+pool_help(uct_pool_t *pool)
+{
+	if (!pool->job || !pool->job_slots)
+		return false;
+	void (*job)(void *ctx) = pool->job;
+	void *ctx = pool->job_ctx;
+	pool->job_slots--;
+	pool->job_running++;
+	pthread_mutex_unlock(&pool->mutex);
+
+	job(ctx);
+
+	pthread_mutex_lock(&pool->mutex);
+	if (!--pool->job_running)
+		pthread_cond_broadcast(&pool->cond);
+	return true;
+}
+
+void
+uct_pool_run(uct_pool_t *pool, void (*job)(void *ctx), void *ctx, int helpers)
+{
+	pthread_mutex_lock(&pool->mutex);
+	assert(!pool->job);
+	pool->job = job;
+	pool->job_ctx = ctx;
+	pool->job_slots = helpers;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+
+	job(ctx);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->job = NULL;
+	pool->job_slots = 0;
+	while (pool->job_running)
+		pthread_cond_wait(&pool->cond, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+/* Pondering gc was requested: wait till all workers are stopped,
+ * last one collects the tree. Returns true if search should resume. */
+static bool
+uct_worker_gc_pause(uct_t *u, tree_t *t)
+{
+	uct_pool_t *pool = u->pool;
+	pthread_mutex_lock(&pool->mutex);
+	if (!pool->gc_pending) {
+		pthread_mutex_unlock(&pool->mutex);
+		return false;
+	}
+
+	if (++pool->paused == pool->workers) {
+		if (!pool->stopping) {
+			pthread_mutex_unlock(&pool->mutex);
+			if (u->dcnn_queue)  dcnn_queue_flush(u->dcnn_queue);
+			t->root = tree_garbage_collect(t, t->root);
+			pthread_mutex_lock(&pool->mutex);
+		}
+		pool->paused = 0;
+		pool->gc_pending = false;
+		if (!pool->stopping)  uct_halt = 0;
+		pthread_cond_broadcast(&pool->cond);
+	} else {
+		/* Help with the gc while waiting. */
+		while (pool->gc_pending)
+			if (!pool_help(pool))
+				pthread_cond_wait(&pool->cond, &pool->mutex);
+	}
+
+	bool resume = !pool->stopping;
+	pthread_mutex_unlock(&pool->mutex);
+	return resume;
+}
+
+/* Pondering: stop the workers and have them collect the tree. */
+static void
+uct_ponder_gc(uct_t *u)
+{
+	uct_pool_t *pool = u->pool;
+	pthread_mutex_lock(&pool->mutex);
+	if (!uct_halt) {
+		pool->gc_pending = true;
+		uct_halt = 1;
+	}
+	while (pool->gc_pending)
+		pthread_cond_wait(&pool->cond, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+}
+
+static void
+uct_worker(uct_thread_ctx_t *ctx)
 {
 	/* Setup */
-	uct_thread_ctx_t *ctx = (uct_thread_ctx_t*)ctx_;
 	uct_search_state_t *s = ctx->s;
 	uct_t *u = ctx->u;
+	uct_pool_t *pool = u->pool;
 	board_t *b = ctx->b;
 	enum stone color = ctx->color;
 	fast_srandom(ctx->seed);
 
+	tree_t *t = ctx->t;
+
 	/* Fill ownermap for mcowner pattern feature. */
 	if (using_patterns()) {
 		double time_start = time_now();
@@ -124,7 +250,6 @@ spawn_worker(void *ctx_)
 
 	/* Expand root node (dcnn). Other threads wait till it's ready. 
 	 * For dcnn pondering we also need dcnn values for opponent's best moves. */
-	tree_t *t = ctx->t;
 	tree_node_t *n = t->root;
 	if (!ctx->tid) {
 		enum stone node_color = stone_other(color);
@@ -139,114 +264,146 @@ spawn_worker(void *ctx_)
 			print_joseki_moves(joseki_dict, b, color);
 			print_node_prior_best_moves(b, n);
 		}
+		pthread_mutex_lock(&pool->mutex);
 		u->tree_ready = true;
+		pthread_cond_broadcast(&pool->cond);
+		pthread_mutex_unlock(&pool->mutex);
+	} else {
+		pthread_mutex_lock(&pool->mutex);
+		while (!u->tree_ready)
+			pthread_cond_wait(&pool->cond, &pool->mutex);
+		pthread_mutex_unlock(&pool->mutex);
 	}
-	else while (!u->tree_ready)
-		     usleep(100 * 1000);
 
 	/* Run */
 	if (!ctx->tid)  u->mcts_time_start = s->last_print_time = time_now();
-	ctx->games = uct_playouts(ctx->u, ctx->b, ctx->color, ctx->t, ctx->ti);
-	
-	/* Finish */
-	pthread_mutex_lock(&finish_serializer);
-	pthread_mutex_lock(&finish_mutex);
-	finish_thread = ctx->tid;
-	pthread_cond_signal(&finish_cond);
-	pthread_mutex_unlock(&finish_mutex);
-	return ctx;
+	if (u->ownermap_merge && !ctx->ownermap)
+		ctx->ownermap = calloc2(1, ownermap_t);
+	ownermap_t *ownermap = (u->ownermap_merge ? ctx->ownermap : NULL);
+	do
+		ctx->games += uct_playouts(ctx->u, ctx->b, ctx->color, ctx->t, ctx->ti, ownermap);
+	while (uct_worker_gc_pause(u, t));
 }
 
-/* Thread manager, controlling worker threads. It must be called with
- * finish_mutex lock held, but it will unlock it itself before exiting;
- * this is necessary to be completely deadlock-free. */
-/* The finish_cond can be signalled for it to stop; in that case,
- * the caller should set finish_thread = -1. */
-/* After it is started, it will update mctx->t to point at some tree
- * used for the actual search, on return
- * it will set mctx->games to the number of performed simulations. */
+/* Pool thread main loop: park until next search starts, run it, repeat. */
 static void *
-spawn_thread_manager(void *ctx_)
+pool_thread(void *ctx_)
 {
-	/* In thread_manager, we use only some of the ctx fields. */
-	uct_thread_ctx_t *mctx = (uct_thread_ctx_t*)ctx_;
-	uct_t *u = mctx->u;
-	tree_t *t = mctx->t;
-	fast_srandom(mctx->seed);
-
-	int played_games = 0;
-	pthread_t threads[u->threads + 1];
-	int joined = 0;
+	uct_thread_ctx_t *ctx = (uct_thread_ctx_t*)ctx_;
+	uct_pool_t *pool = ctx->u->pool;
+	int generation = 0;
+
+	while (1) {
+		pthread_mutex_lock(&pool->mutex);
+		while (pool->generation == generation && !pool->quit)
+			if (!pool_help(pool))
+				pthread_cond_wait(&pool->cond, &pool->mutex);
+		if (pool->quit) {
+			pthread_mutex_unlock(&pool->mutex);
+			return NULL;
+		}
+		generation = pool->generation;
+		if (++pool->started == pool->workers + 1)
+			pool->started_time = time_now();
+		pthread_mutex_unlock(&pool->mutex);
+
+		if (ctx->tid < pool->workers)  uct_worker(ctx);
+		else if (ctx->u->pondering)    uct_logger(ctx);
+
+		pthread_mutex_lock(&pool->mutex);
+		if (!--pool->running) {
+			pool->stopped_time = time_now();
+			pthread_cond_broadcast(&pool->cond);
+		}
+		pthread_mutex_unlock(&pool->mutex);
+	}
+}
 
-	uct_halt = 0;
+static void
+pin_thread(pthread_t thread, int cpu)
+{
+#ifdef __linux__
+	cpu_set_t set;
+	CPU_ZERO(&set);
+	CPU_SET(cpu % get_nprocessors(), &set);
+	int r = pthread_setaffinity_np(thread, sizeof(set), &set);
+	if (r && DEBUGL(2))  fprintf(stderr, "couldn't pin thread to cpu %d: %s\n", cpu, strerror(r));
+#else
+	if (DEBUGL(2) && !cpu)  fprintf(stderr, "thread pinning not supported on this platform\n");
+#endif
+}
 
-	/* Garbage collect the tree by preference when pondering. */
-	if (u->pondering && t->nodes && t->nodes_size >= t->pruning_threshold) {
-		t->root = tree_garbage_collect(t, t->root);
+/* Create the worker pool (u->threads workers + logger thread). */
+void
+uct_pool_init(uct_t *u)
+{
+	assert(!u->pool);
+	assert(u->threads > 0);
+	uct_pool_t *pool = u->pool = calloc2(1, uct_pool_t);
+	pool->workers = u->threads;
+	pool->pinned = u->pin_threads;
+	pool->threads = calloc2(pool->workers + 1, pthread_t);
+	pool->ctx = calloc2(pool->workers + 1, uct_thread_ctx_t);
+	pthread_mutex_init(&pool->mutex, NULL);
+	pthread_cond_init(&pool->cond, NULL);
+
+	pthread_attr_t a;
+	pthread_attr_init(&a);
+	pthread_attr_setstacksize(&a, 1048576);
+	for (int ti = 0; ti <= pool->workers; ti++) {
+		pool->ctx[ti].u = u;
+		pool->ctx[ti].tid = ti;
+		pthread_create(&pool->threads[ti], &a, pool_thread, &pool->ctx[ti]);
+		if (u->pin_threads && ti < pool->workers)
+			pin_thread(pool->threads[ti], ti);
 	}
+	pthread_attr_destroy(&a);
+	if (UDEBUGL(4))
+		fprintf(stderr, "Spawned %d workers\n", pool->workers);
+}
 
-	u->tree_ready = false;
-		
-	/* Logging thread for pondering */
-	if (u->pondering)
-		pthread_create(&threads[u->threads], NULL, spawn_logger, mctx);
-	
-	/* Spawn threads... */
-	for (int ti = 0; ti < u->threads; ti++) {
-		uct_thread_ctx_t *ctx = calloc2(1, uct_thread_ctx_t);
-		ctx->u = u; ctx->b = mctx->b; ctx->color = mctx->color;
-		mctx->t = ctx->t = t;
-		ctx->tid = ti; ctx->seed = fast_random(65536) + ti;
-		ctx->ti = mctx->ti;
-		ctx->s = mctx->s;
-		pthread_attr_t a;
-		pthread_attr_init(&a);
-		pthread_attr_setstacksize(&a, 1048576);
-		pthread_create(&threads[ti], &a, spawn_worker, ctx);
-		if (UDEBUGL(4))
-			fprintf(stderr, "Spawned worker %d\n", ti);
-	}
-
-	/* ...and collect them back: */
-	while (joined < u->threads) {
-		/* Wait for some thread to finish... */
-		pthread_cond_wait(&finish_cond, &finish_mutex);
-		if (finish_thread < 0) {
-			/* Stop-by-caller. Tell the workers to wrap up
-			 * and unblock them from terminating. */
-			uct_halt = 1;
-			/* We need to make sure the workers do not complete
-			 * the termination sequence before we get officially
-			 * stopped - their wake and the stop wake could get
-			 * coalesced. */
-			pthread_mutex_unlock(&finish_serializer);
-			continue;
-		}
-		/* ...and gather its remnants. */
-		uct_thread_ctx_t *ctx;
-		pthread_join(threads[finish_thread], (void **) &ctx);
-		played_games += ctx->games;
-		joined++;
-		free(ctx);
-		if (UDEBUGL(4))
-			fprintf(stderr, "Joined worker %d\n", finish_thread);
-		pthread_mutex_unlock(&finish_serializer);
-	}
-
-	if (u->pondering)
-		pthread_join(threads[u->threads], NULL);
-	
-	pthread_mutex_unlock(&finish_mutex);
+void
+uct_pool_done(uct_t *u)
+{
+	uct_pool_t *pool = u->pool;
+	if (!pool)  return;
+	assert(!thread_manager_running);
+
+	pthread_mutex_lock(&pool->mutex);
+	pool->quit = true;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
+	for (int ti = 0; ti <= pool->workers; ti++)
+		pthread_join(pool->threads[ti], NULL);
+
+	pthread_cond_destroy(&pool->cond);
+	pthread_mutex_destroy(&pool->mutex);
+	for (int ti = 0; ti < pool->workers; ti++)
+		free(pool->ctx[ti].ownermap);
+	free(pool->threads);
+	free(pool->ctx);
+	free(pool);
+	u->pool = NULL;
+}
 
-	mctx->games = played_games;
-	return mctx;
+void
+uct_pool_update(uct_t *u)
+{
+	uct_pool_t *pool = u->pool;
+	if (pool && pool->workers == u->threads && pool->pinned == u->pin_threads)
+		return;
+	uct_pool_done(u);
+	uct_pool_init(u);
+	if (u->t) {
+		u->t->pool = u->pool;
+		u->t->gc_threads = u->threads;
+	}
 }
 
 /* Pondering: Logging thread */
-static void *
-spawn_logger(void *ctx_)
+static void
+uct_logger(uct_thread_ctx_t *ctx)
 {
-	uct_thread_ctx_t *ctx = (uct_thread_ctx_t*)ctx_;
 	uct_t *u = ctx->u;
 	tree_t *t = ctx->t;
 	board_t *b = ctx->b;
@@ -254,6 +411,14 @@ spawn_logger(void *ctx_)
 	uct_search_state_t *s = ctx->s;
 	time_info_t *ti = ctx->ti;
 
+	/* Wait for root expansion. */
+	pthread_mutex_lock(&u->pool->mutex);
+	while (!u->tree_ready)
+		pthread_cond_wait(&u->pool->cond, &u->pool->mutex);
+	pthread_mutex_unlock(&u->pool->mutex);
+
+	size_t gc_size = 0;  /* Tree size after last pondering gc */
+
 	// Similar to uct_search() code when pondering
 	while (!uct_halt) {
 		time_sleep(TREE_BUSYWAIT_INTERVAL);
@@ -264,10 +429,20 @@ spawn_logger(void *ctx_)
 		int i = uct_search_games(s);
 		/* Print notifications etc. */
 		uct_search_progress(u, b, color, t, ti, s, i);
-		
-		if (s->fullmem)  uct_pondering_stop(u);
+
+		/* Collect the tree while pondering if it gets big, so it
+		 * doesn't have to be done on our time after opponent's move. */
+		if (u->ponder_gc && t->nodes && t->nodes_size >= t->pruning_threshold
+		    && t->nodes_size >= 2 * gc_size) {
+			uct_ponder_gc(u);
+			gc_size = t->nodes_size;
+		}
+
+		/* We can't stop pondering from here (it would wait for
+		 * this thread), just stop the workers. The search gets
+		 * collected by uct_pondering_stop() later. */
+		if (s->fullmem)  uct_halt = 1;
 	}
-	return NULL;
 }
 
 /* Expand next move node (dcnn pondering) */
@@ -344,7 +519,7 @@ uct_expand_next_best_moves(uct_t *u, tree_t *t, board_t *b, enum stone color)
 int
 uct_search_games(uct_search_state_t *s)
 {
-	return s->ctx->t->root->u.playouts;
+	return node_u(s->ctx->t->root).playouts;
 }
 
 void
@@ -353,7 +528,7 @@ uct_search_start(uct_t *u, board_t *b, enum stone color,
 		 uct_search_state_t *s)
 {
 	/* Set up search state. */
-	s->base_playouts = s->last_dynkomi = s->last_print_playouts = t->root->u.playouts;
+	s->base_playouts = s->last_dynkomi = s->last_print_playouts = node_u(t->root).playouts;
 	s->fullmem = false;
 
 	if (ti) {
@@ -368,16 +543,35 @@ uct_search_start(uct_t *u, board_t *b, enum stone color,
 		time_stop_conditions(ti, b, u->fuseki_end, u->yose_start, u->max_maintime_ratio, &s->stop);
 	}
 
-	/* Fire up the tree search thread manager, which will in turn
-	 * spawn the searching threads. */
-	assert(u->threads > 0);
+	/* Wake up the worker pool. */
 	assert(!thread_manager_running);
-	static uct_thread_ctx_t mctx;
+	assert(u->pool && u->pool->workers == u->threads);
+	/* Garbage collect the tree by preference when pondering. */
+	if (u->pondering && t->nodes && t->nodes_size >= t->pruning_threshold)
+		t->root = tree_garbage_collect(t, t->root);
+
 	mctx = (uct_thread_ctx_t) { 0, u, b, color, t, fast_random(65536), 0, ti, s };
 	s->ctx = &mctx;
-	pthread_mutex_lock(&finish_serializer);
-	pthread_mutex_lock(&finish_mutex);
-	pthread_create(&thread_manager, NULL, spawn_thread_manager, s->ctx);
+
+	uct_pool_t *pool = u->pool;
+	pthread_mutex_lock(&pool->mutex);
+	uct_halt = 0;
+	pool->stopping = false;
+	u->tree_ready = false;
+	for (int i = 0; i <= pool->workers; i++) {
+		uct_thread_ctx_t *ctx = &pool->ctx[i];
+		ctx->b = b; ctx->color = color; ctx->t = t;
+		ctx->seed = fast_random(65536) + i;
+		ctx->games = 0;
+		ctx->ti = ti;
+		ctx->s = s;
+	}
+	pool->running = pool->workers + 1;
+	pool->started = 0;
+	pool->start_time = time_now();
+	pool->generation++;
+	pthread_cond_broadcast(&pool->cond);
+	pthread_mutex_unlock(&pool->mutex);
 	thread_manager_running = true;
 }
 
@@ -385,20 +579,41 @@ uct_thread_ctx_t *
 uct_search_stop(void)
 {
 	assert(thread_manager_running);
+	uct_t *u = mctx.u;
+	uct_pool_t *pool = u->pool;
+
+	/* Tell the workers to wrap up and wait
+	 * till they're all parked again. */
+	pthread_mutex_lock(&pool->mutex);
+	pool->stop_time = time_now();
+	pool->stopping = true;
+	uct_halt = 1;
+	while (pool->running)
+		pthread_cond_wait(&pool->cond, &pool->mutex);
+	pthread_mutex_unlock(&pool->mutex);
+	thread_manager_running = false;
 
-	/* Signal thread manager to stop the workers. */
-	pthread_mutex_lock(&finish_mutex);
-	finish_thread = -1;
-	pthread_cond_signal(&finish_cond);
-	pthread_mutex_unlock(&finish_mutex);
+	/* Pending dcnn results are lost, tree may change now. */
+	if (u->dcnn_queue)  dcnn_queue_flush(u->dcnn_queue);
 
-	/* Collect the thread manager. */
-	uct_thread_ctx_t *pctx;
-	thread_manager_running = false;
-	pthread_join(thread_manager, (void **) &pctx);
-	return pctx;
+	mctx.games = 0;
+	for (int i = 0; i < pool->workers; i++)
+		mctx.games += pool->ctx[i].games;
+
+	if (UDEBUGL(3))
+		fprintf(stderr, "search start latency %ius, stop latency %ius\n",
+			(int)((pool->started_time - pool->start_time) * 1000000),
+			(int)((pool->stopped_time - pool->stop_time) * 1000000));
+	return &mctx;
 }
 
+void
+uct_search_latency(uct_t *u, double *start, double *stop)
+{
+	uct_pool_t *pool = u->pool;
+	*start = pool->started_time - pool->start_time;
+	*stop  = pool->stopped_time - pool->stop_time;
+}
 
 void
 uct_search_progress(uct_t *u, board_t *b, enum stone color,
@@ -444,6 +659,49 @@ uct_search_progress(uct_t *u, board_t *b, enum stone color,
 }
 
 
+/* Wilson score interval for a node value after n playouts,
+ * z standard deviations wide. */
+static void
+uct_value_bounds(floating_t value, int n, floating_t z, floating_t *lcb, floating_t *ucb)
+{
+	floating_t z2n = z * z / n;
+	floating_t center = (value + z2n / 2) / (1 + z2n);
+	floating_t half = z * sqrt(value * (1 - value) / n + z2n / (4 * n)) / (1 + z2n);
+	*lcb = center - half;
+	*ucb = center + half;
+}
+
+/* Can a move other than @best still get more playouts than @best within
+ * @estplayouts more simulations ? A move can only take over if it is
+ * close enough in playouts, and it will only get those playouts if its
+ * value could still be better than best's: its upper confidence bound
+ * must reach best's lower bound. */
+static bool
+uct_search_result_settled(uct_t *u, tree_t *t, tree_node_t *best, double estplayouts)
+{
+	floating_t z = u->stop_confidence;
+	int best_playouts = node_u(best).playouts;
+	floating_t best_value = tree_node_get_value(t, 1, node_u(best).value);
+	floating_t best_lcb, ucb;
+	uct_value_bounds(best_value, best_playouts, z, &best_lcb, &ucb);
+
+	for (tree_node_t *ni = t->root->children; ni; ni = ni->sibling) {
+		if (ni == best || (ni->hints & TREE_HINT_INVALID))
+			continue;
+		int playouts = node_u(ni).playouts;
+		if (best_playouts - playouts > estplayouts)
+			continue;  /* Can't catch up anyway */
+		if (!playouts)
+			return false;
+		floating_t value = tree_node_get_value(t, 1, node_u(ni).value);
+		floating_t lcb;
+		uct_value_bounds(value, playouts, z, &lcb, &ucb);
+		if (ucb >= best_lcb)
+			return false;
+	}
+	return true;
+}
+
 /* Determine whether we should terminate the search early. */
 static bool
 uct_search_stop_early(uct_t *u, tree_t *t, board_t *b,
@@ -469,29 +727,37 @@ uct_search_stop_early(uct_t *u, tree_t *t, board_t *b,
 		if (elapsed < TREE_BUSYWAIT_INTERVAL) return false;
 	}
 
-	/* Break early if we estimate the second-best move cannot
-	 * catch up in assigned time anymore. We use all our time
-	 * if we are in byoyomi with single stone remaining in our
-	 * period, however - it's better to pre-ponder. */
+	/* Break early if we estimate no other move can take over in
+	 * assigned time anymore. We use all our time if we are in
+	 * byoyomi with single stone remaining in our period, however -
+	 * it's better to pre-ponder. */
 	bool time_indulgent = (!ti->len.t.main_time && ti->len.t.byoyomi_stones == 1);
-	if (best2 && ti->dim == TD_WALLTIME
-	    && played >= PLAYOUT_EARLY_BREAK_MIN && !time_indulgent) {
+	if (best2 && ti->dim == TD_WALLTIME && played >= GJ_MINGAMES && !time_indulgent) {
 		double remaining = stop->worst.time - elapsed;
 		double pps = ((double)played) / elapsed;
 		double estplayouts = remaining * pps + PLAYOUT_DELTA_SAFEMARGIN;
-		if (best->u.playouts > best2->u.playouts + estplayouts) {
+		if (node_u(best).playouts > node_u(best2).playouts + estplayouts
+		    && played >= PLAYOUT_EARLY_BREAK_MIN) {
 			if (UDEBUGL(2))
 				fprintf(stderr, "Early stop, result cannot change: "
 					"best %d, best2 %d, estimated %f simulations to go (%d/%f=%f pps)\n",
-					best->u.playouts, best2->u.playouts, estplayouts, played, elapsed, pps);
+					node_u(best).playouts, node_u(best2).playouts, estplayouts, played, elapsed, pps);
+			return true;
+		}
+		if (u->stop_confidence > 0 && node_u(best).playouts >= CONFIDENCE_EARLY_BREAK_MIN
+		    && uct_search_result_settled(u, t, best, estplayouts)) {
+			if (UDEBUGL(2))
+				fprintf(stderr, "Early stop, best move settled: "
+					"best %d, best2 %d, estimated %f simulations to go (%d/%f=%f pps)\n",
+					node_u(best).playouts, node_u(best2).playouts, estplayouts, played, elapsed, pps);
 			return true;
 		}
 	}
 
 	/* Early break in won situation. */
-	if (best->u.playouts >= PLAYOUT_EARLY_BREAK_MIN
+	if (node_u(best).playouts >= PLAYOUT_EARLY_BREAK_MIN
 	    && (ti->dim != TD_WALLTIME || elapsed > TIME_EARLY_BREAK_MIN)
-	    && tree_node_get_value(t, 1, best->u.value) >= u->sure_win_threshold) {
+	    && tree_node_get_value(t, 1, node_u(best).value) >= u->sure_win_threshold) {
 		return true;
 	}
 
@@ -503,7 +769,7 @@ static bool
 uct_search_keep_looking(uct_t *u, tree_t *t, board_t *b,
 		time_info_t *ti, time_stop_t *stop,
 		tree_node_t *best, tree_node_t *best2,
-		tree_node_t *bestr, tree_node_t *winner, int i)
+		tree_node_t *bestr, tree_node_t *winner, int i, int played)
 {
 	if (!best) {
 		if (UDEBUGL(2))
@@ -513,22 +779,33 @@ uct_search_keep_looking(uct_t *u, tree_t *t, board_t *b,
 
 	/* Do not waste time if we are winning. Spend up to worst time if
 	 * we are unsure, but only desired time if we are sure of winning. */
-	floating_t beta = 2 * (tree_node_get_value(t, 1, best->u.value) - 0.5);
+	floating_t beta = 2 * (tree_node_get_value(t, 1, node_u(best).value) - 0.5);
 	if (ti->dim == TD_WALLTIME && beta > 0) {
 		double good_enough = stop->desired.time * beta + stop->worst.time * (1 - beta);
 		double elapsed = time_now() - ti->len.t.timer_start;
 		if (elapsed > good_enough) return false;
 	}
 
-	if (u->best2_ratio > 0) {
+	if (u->stop_confidence > 0 && ti->dim == TD_WALLTIME) {
+		/* Keep simulating while another move could still take
+		 * over best before worst time, same rule as early stop. */
+		double elapsed = time_now() - ti->len.t.timer_start;
+		double estplayouts = (stop->worst.time - elapsed) * played / elapsed;
+		if (!uct_search_result_settled(u, t, best, estplayouts)) {
+			if (UDEBUGL(3))
+				fprintf(stderr, "Best move not settled: best %d, best2 %d, estimated %f simulations to go\n",
+					node_u(best).playouts, (best2 ? node_u(best2).playouts : 0), estplayouts);
+			return true;
+		}
+	} else if (u->best2_ratio > 0) {
 		/* Check best/best2 simulations ratio. If the
 		 * two best moves give very similar results,
 		 * keep simulating. */
-		if (best2 && best2->u.playouts
-		    && (double)best->u.playouts / best2->u.playouts < u->best2_ratio) {
+		if (best2 && node_u(best2).playouts
+		    && (double)node_u(best).playouts / node_u(best2).playouts < u->best2_ratio) {
 			if (UDEBUGL(3))
 				fprintf(stderr, "Best2 ratio %f < threshold %f\n",
-					(double)best->u.playouts / best2->u.playouts,
+					(double)node_u(best).playouts / node_u(best2).playouts,
 					u->best2_ratio);
 			return true;
 		}
@@ -538,11 +815,11 @@ uct_search_keep_looking(uct_t *u, tree_t *t, board_t *b,
 		/* Check best, best_best value difference. If the best move
 		 * and its best child do not give similar enough results,
 		 * keep simulating. */
-		if (bestr && bestr->u.playouts
-		    && fabs((double)best->u.value - bestr->u.value) > u->bestr_ratio) {
+		if (bestr && node_u(bestr).playouts
+		    && fabs((double)node_u(best).value - node_u(bestr).value) > u->bestr_ratio) {
 			if (UDEBUGL(3))
 				fprintf(stderr, "Bestr delta %f > threshold %f\n",
-					fabs((double)best->u.value - bestr->u.value),
+					fabs((double)node_u(best).value - node_u(bestr).value),
 					u->bestr_ratio);
 			return true;
 		}
@@ -554,9 +831,9 @@ uct_search_keep_looking(uct_t *u, tree_t *t, board_t *b,
 		if (UDEBUGL(3))
 			fprintf(stderr, "[%d] best %3s [%d] %f != winner %3s [%d] %f\n", i,
 				coord2sstr(node_coord(best)),
-				best->u.playouts, tree_node_get_value(t, 1, best->u.value),
+				node_u(best).playouts, tree_node_get_value(t, 1, node_u(best).value),
 				coord2sstr(node_coord(winner)),
-				winner->u.playouts, tree_node_get_value(t, 1, winner->u.value));
+				node_u(winner).playouts, tree_node_get_value(t, 1, node_u(winner).value));
 		return true;
 	}
 
@@ -590,8 +867,19 @@ uct_search_check_stop(uct_t *u, board_t *b, enum stone color,
 
 	/* Possibly stop search early if it's no use to try on. */
 	int played = u->played_all + i - s->base_playouts;
-	if (best && uct_search_stop_early(u, ctx->t, b, ti, &s->stop, best, best2, played, s->fullmem))
+	if (best && uct_search_stop_early(u, ctx->t, b, ti, &s->stop, best, best2, played, s->fullmem)) {
+		if (ti->dim == TD_WALLTIME) {
+			/* Past desired time we'd have kept looking up to worst time. */
+			double elapsed = time_now() - ti->len.t.timer_start;
+			double limit = (elapsed < s->stop.desired.time ? s->stop.desired.time : s->stop.worst.time);
+			double saved = limit - elapsed;
+			if (saved > 0) {
+				u->early_stops++;
+				u->early_stop_saved += saved;
+			}
+		}
 		return true;
+	}
 
 	/* Check against time settings. */
 	bool desired_done;
@@ -615,7 +903,7 @@ uct_search_check_stop(uct_t *u, board_t *b, enum stone color,
 		}
 		if (best)
 			bestr = u->policy->choose(u->policy, best, b, stone_other(color), resign);
-		if (!uct_search_keep_looking(u, ctx->t, b, ti, &s->stop, best, best2, bestr, winner, i))
+		if (!uct_search_keep_looking(u, ctx->t, b, ti, &s->stop, best, best2, bestr, winner, i, played))
 			return true;
 	}
 
@@ -680,13 +968,13 @@ uct_search_result(uct_t *u, board_t *b, enum stone color,
 		return NULL;
 	}
 	*best_coord = node_coord(best);
-	floating_t winrate = tree_node_get_value(u->t, 1, best->u.value);
+	floating_t winrate = tree_node_get_value(u->t, 1, node_u(best).value);
 
 	if (UDEBUGL(1))
 		fprintf(stderr, "*** WINNER is %s with score %1.4f (%d/%d:%d/%d games), extra komi %f\n",
 			coord2sstr(node_coord(best)), winrate,
-			best->u.playouts, u->t->root->u.playouts,
-			u->t->root->u.playouts - base_playouts, played_games,
+			node_u(best).playouts, node_u(u->t->root).playouts,
+			node_u(u->t->root).playouts - base_playouts, played_games,
 			u->t->extra_komi);
 
 	/* Do not resign if we're so short of time that evaluation of best
@@ -696,7 +984,7 @@ uct_search_result(uct_t *u, board_t *b, enum stone color,
 	    // If only simulated node has been a pass and no other node has
 	    // been simulated but pass won't win, an unsimulated node has
 	    // been returned; test therefore also for #simulations at root.
-	    && (best->u.playouts > GJ_MINGAMES || u->t->root->u.playouts > GJ_MINGAMES * 2)
+	    && (node_u(best).playouts > GJ_MINGAMES || node_u(u->t->root).playouts > GJ_MINGAMES * 2)
 	    && !u->t->untrustworthy_tree) {
 		if (UDEBUGL(0)) fprintf(stderr, "<resign>\n");
 		*best_coord = resign;
@@ -42,6 +42,7 @@ typedef struct uct_thread_ctx {
 	int games;
 	time_info_t *ti;
 	struct uct_search_state *s;
+	ownermap_t *ownermap;  /* Private ownermap, see ownermap_merge uct option */
 } uct_thread_ctx_t;
 
 
@@ -65,6 +66,18 @@ int uct_search_games(uct_search_state_t *s);
 void uct_search_start(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti, uct_search_state_t *s);
 uct_thread_ctx_t *uct_search_stop(void);
 
+/* Worker pool is created at engine init and reused by all searches. */
+void uct_pool_init(uct_t *u);
+void uct_pool_done(uct_t *u);
+/* Recreate the pool if threads / pin_threads changed.
+ * No search may be running. */
+void uct_pool_update(uct_t *u);
+/* Run job(ctx) in calling thread and up to @helpers idle pool threads
+ * (or paused for pondering gc), return when all are done. */
+void uct_pool_run(uct_pool_t *pool, void (*job)(void *ctx), void *ctx, int helpers);
+/* Latency of last search start / stop (in seconds) */
+void uct_search_latency(uct_t *u, double *start, double *stop);
+
 void uct_search_progress(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti, uct_search_state_t *s, int playouts);
 
 bool uct_search_check_stop(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti, uct_search_state_t *s, int i);
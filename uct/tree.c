@@ -5,6 +5,13 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef __linux__
+#include <errno.h>
+#include <linux/mempolicy.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 #define DEBUG
 #include "board.h"
@@ -16,45 +23,66 @@
 #include "timeinfo.h"
 #include "uct/internal.h"
 #include "uct/prior.h"
+#include "uct/search.h"
 #include "uct/tree.h"
 #include "uct/slave.h"
 #include "dcnn.h"
 
 
-/* Allocate tree node(s). The returned nodes are initialized with zeroes.
- * Returns NULL if not enough memory.
+/* Allocate a block of tree nodes. The returned nodes are initialized with
+ * zeroes (including their stats). Returns NULL if not enough memory.
  * This function may be called by multiple threads in parallel. */
 static tree_node_t *
 tree_alloc_node(tree_t *t, int count, bool fast_alloc)
 {
-	tree_node_t *n = NULL;
-	size_t nsize = count * sizeof(*n);
+	char *block = NULL;
+	size_t nsize = tree_block_size(t, count);
 	size_t old_size = __sync_fetch_and_add(&t->nodes_size, nsize);
 
 	if (fast_alloc) {
 		if (old_size + nsize > t->max_tree_size)
 			return NULL;
 		assert(t->nodes != NULL);
-		n = (tree_node_t *)((char*)t->nodes + old_size);
-		memset(n, 0, nsize);
+		block = (char*)t->nodes + old_size;
+		memset(block, 0, nsize);
 	} else {
-		n = calloc2(count, tree_node_t);
+		block = calloc2(nsize, char);
+	}
+
+	((tree_block_t *)block)->live = count;
+	tree_node_t *n = (tree_node_t *)(block + sizeof(tree_block_t) + 3 * count * sizeof(move_stats_t));
+	for (int i = 0; i < count; i++) {
+		n[i].block_idx = i;
+		n[i].block_len = count;
 	}
 	return n;
 }
 
+/* Copy node contents and stats from src to dst, dst keeps its place
+ * in its own block. Both trees must have the same crit_stats. */
+static void
+tree_copy_node(tree_t *t, tree_node_t *dst, tree_node_t *src)
+{
+	unsigned short block_idx = dst->block_idx, block_len = dst->block_len;
+	*dst = *src;
+	dst->block_idx = block_idx;
+	dst->block_len = block_len;
+	node_u(dst) = node_u(src);
+	node_amaf(dst) = node_amaf(src);
+	node_prior(dst) = node_prior(src);
+	if (t->crit_stats) {
+		node_winner_owner(dst) = node_winner_owner(src);
+		node_black_owner(dst) = node_black_owner(src);
+	}
+}
+
 /* Initialize a node at a given place in memory.
  * This function may be called by multiple threads in parallel. */
 static void
 tree_setup_node(tree_t *t, tree_node_t *n, coord_t coord, int depth)
 {
-	static volatile unsigned int hash = 0;
 	n->coord = coord;
 	n->depth = depth;
-	/* n->hash is used only for debugging. It is very likely (but not
-	 * guaranteed) to be unique. */
-	hash_t h = n - (tree_node_t *)0;
-	n->hash = (h << 32) + (hash++ & 0xffffffff);
 	if (depth > t->max_depth)
 		t->max_depth = depth;
 }
@@ -72,17 +100,82 @@ tree_init_node(tree_t *t, coord_t coord, int depth, bool fast_alloc)
 	return n;
 }
 
-/* Create a tree structure. Pre-allocate all nodes if max_tree_size is > 0. */
+#ifdef __linux__
+#define HUGE_PAGE_SIZE (2 * 1048576)
+
+/* Allocate fast_alloc nodes buffer with mmap(), see TREE_ARENA_* flags.
+ * Size is rounded up to a multiple of huge page size. */
+static void *
+tree_arena_alloc(size_t *size, int arena)
+{
+	*size = (*size + HUGE_PAGE_SIZE - 1) / HUGE_PAGE_SIZE * HUGE_PAGE_SIZE;
+	int prot = PROT_READ | PROT_WRITE;
+	int flags = MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE;
+	void *p = MAP_FAILED;
+
+	if (arena & TREE_ARENA_HUGETLB) {
+		/* No MAP_NORESERVE here: fail now rather than SIGBUS later. */
+		p = mmap(NULL, *size, prot, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if (p == MAP_FAILED)
+			fprintf(stderr, "tree: couldn't get explicit huge pages (%s), check /proc/sys/vm/nr_hugepages\n",
+				strerror(errno));
+	}
+	if (p == MAP_FAILED) {
+		p = mmap(NULL, *size, prot, flags, -1, 0);
+		if (p == MAP_FAILED)  fail("mmap");
+		if ((arena & (TREE_ARENA_THP | TREE_ARENA_HUGETLB)) &&
+		    madvise(p, *size, MADV_HUGEPAGE) && DEBUGL(1))
+			fprintf(stderr, "tree: madvise(MADV_HUGEPAGE) failed: %s\n", strerror(errno));
+	}
+
+	/* Spread pages over all numa nodes. Otherwise pages end up on the node
+	 * of the thread which touches them first (tree_alloc_node()). */
+	if (arena & TREE_ARENA_INTERLEAVE) {
+		unsigned long mask[16];
+		memset(mask, 0xff, sizeof(mask));  /* Kernel masks out unavailable nodes */
+		if (syscall(SYS_mbind, p, *size, MPOL_INTERLEAVE, mask, sizeof(mask) * 8, 0) && DEBUGL(1))
+			fprintf(stderr, "tree: mbind(MPOL_INTERLEAVE) failed: %s\n", strerror(errno));
+	}
+	return p;
+}
+#else
+static void *
+tree_arena_alloc(size_t *size, int arena)
+{
+	die("tree: huge pages / numa options not supported on this platform\n");
+}
+#endif
+
+static void
+tree_arena_free(tree_t *t)
+{
+#ifdef __linux__
+	if (t->arena) {
+		munmap(t->nodes, t->max_tree_size);
+		return;
+	}
+#endif
+	free(t->nodes);
+}
+
+/* Create a tree structure. Pre-allocate all nodes if max_tree_size is > 0,
+ * arena gives TREE_ARENA_* flags for the nodes buffer. */
 tree_t *
 tree_init(board_t *board, enum stone color, size_t max_tree_size,
-	  size_t max_pruned_size, size_t pruning_threshold, floating_t ltree_aging, int hbits)
+	  size_t max_pruned_size, size_t pruning_threshold, floating_t ltree_aging, int hbits,
+	  int flags)
 {
 	tree_t *t = calloc2(1, tree_t);
 	t->board = board;
 	t->max_tree_size = max_tree_size;
 	t->max_pruned_size = max_pruned_size;
 	t->pruning_threshold = pruning_threshold;
-	if (max_tree_size != 0) {
+	t->gc_threads = 1;
+	t->arena = flags & TREE_ARENA_MASK;
+	t->crit_stats = !!(flags & TREE_CRIT_STATS);
+	if (max_tree_size != 0 && t->arena) {
+		t->nodes = tree_arena_alloc(&t->max_tree_size, t->arena);
+	} else if (max_tree_size != 0) {
 		t->nodes = cmalloc(max_tree_size);
 		/* The nodes buffer doesn't need initialization. This is currently
 		 * done by tree_init_node to spread the load. Doing a memset for the
@@ -103,9 +196,32 @@ tree_init(board_t *board, enum stone color, size_t max_tree_size,
 }
 
 
+/* Free the block containing node n.
+ * Returns the remaining size of the tree. */
+static size_t
+tree_free_block(tree_t *t, tree_node_t *n)
+{
+	size_t size = tree_block_size(t, n->block_len);
+	free(tree_node_block(n));
+	size_t old_size = __sync_fetch_and_sub(&t->nodes_size, size);
+	return old_size - size;
+}
+
+/* Node n leaves the tree: free its block if it was the last node
+ * of the block still in the tree.
+ * Returns the remaining size of the tree. */
+static size_t
+tree_release_node(tree_t *t, tree_node_t *n)
+{
+	if (__sync_sub_and_fetch(&tree_node_block(n)->live, 1))
+		return t->nodes_size;
+	return tree_free_block(t, n);
+}
+
 /* This function may be called by multiple threads in parallel on the
  * same tree, but not on node n. n may be detached from the tree but
- * must have been created in this tree originally.
+ * must have been created in this tree originally. n's block is freed
+ * along with the last of its nodes still in the tree.
  * It returns the remaining size of the tree after n has been freed. */
 static size_t
 tree_done_node(tree_t *t, tree_node_t *n)
@@ -116,9 +232,7 @@ tree_done_node(tree_t *t, tree_node_t *n)
 		tree_done_node(t, ni);
 		ni = nj;
 	}
-	free(n);
-	size_t old_size = __sync_fetch_and_sub(&t->nodes_size, sizeof(*n));
-	return old_size - sizeof(*n);
+	return tree_release_node(t, n);
 }
 
 typedef struct {
@@ -148,7 +262,7 @@ tree_done_node_worker(void *ctx_)
 static void
 tree_done_node_detached(tree_t *t, tree_node_t *n)
 {
-	if (n->u.playouts < 1000) { // no thread for small tree
+	if (node_u(n).playouts < 1000) { // no thread for small tree
 		if (!tree_done_node(t, n))
 			free(t);
 		return;
@@ -173,7 +287,7 @@ tree_done(tree_t *t)
 
 	if (t->htable) free(t->htable);
 	if (t->nodes) {
-		free(t->nodes);
+		tree_arena_free(t);
 		free(t);
 	} else if (!tree_done_node(t, t->root)) {
 		free(t);
@@ -193,29 +307,29 @@ tree_node_dump(tree_t *tree, tree_node_t *node, int treeparity, int l, int thres
 		children++;
 	/* We use 1 as parity, since for all nodes we want to know the
 	 * win probability of _us_, not the node color. */
-	fprintf(stderr, "[%s] %.3f/%d [prior %.3f/%d amaf %.3f/%d crit %.3f vloss %d] h=%x c#=%d <%" PRIhash ">\n",
+	fprintf(stderr, "[%s] %.3f/%d [prior %.3f/%d amaf %.3f/%d crit %.3f vloss %d] h=%x c#=%d <%p>\n",
 		coord2sstr(node_coord(node)),
-		tree_node_get_value(tree, treeparity, node->u.value), node->u.playouts,
-		tree_node_get_value(tree, treeparity, node->prior.value), node->prior.playouts,
-		tree_node_get_value(tree, treeparity, node->amaf.value), node->amaf.playouts,
+		tree_node_get_value(tree, treeparity, node_u(node).value), node_u(node).playouts,
+		tree_node_get_value(tree, treeparity, node_prior(node).value), node_prior(node).playouts,
+		tree_node_get_value(tree, treeparity, node_amaf(node).value), node_amaf(node).playouts,
 		tree_node_criticality(tree, node), node->descents,
-		node->hints, children, node->hash);
+		node->hints, children, node);
 
 	/* Print nodes sorted by #playouts. */
 
 	tree_node_t *nbox[1000]; int nboxl = 0;
 	for (tree_node_t *ni = node->children; ni; ni = ni->sibling)
-		if (ni->u.playouts > thres)
+		if (node_u(ni).playouts > thres)
 			nbox[nboxl++] = ni;
 
 	while (true) {
 		int best = -1;
 		for (int i = 0; i < nboxl; i++)
-			if (nbox[i] && (best < 0 || nbox[i]->u.playouts > nbox[best]->u.playouts))
+			if (nbox[i] && (best < 0 || node_u(nbox[i]).playouts > node_u(nbox[best]).playouts))
 				best = i;
 		if (best < 0)
 			break;
-		tree_node_dump(tree, nbox[best], treeparity, l + 1, /* node->u.value < 0.1 ? 0 : */ thres);
+		tree_node_dump(tree, nbox[best], treeparity, l + 1, /* node_u(node).value < 0.1 ? 0 : */ thres);
 		nbox[best] = NULL;
 	}
 }
@@ -223,7 +337,7 @@ tree_node_dump(tree_t *tree, tree_node_t *node, int treeparity, int l, int thres
 void
 tree_dump(tree_t *tree, double thres)
 {
-	int thres_abs = thres > 0 ? tree->root->u.playouts * thres : thres;
+	int thres_abs = thres > 0 ? node_u(tree->root).playouts * thres : thres;
 	fprintf(stderr, "(UCT tree; root %s; extra komi %f; max depth %d)\n",
 	        stone2str(tree->root_color), tree->extra_komi,
 		tree->max_depth - tree->root->depth);
@@ -250,18 +364,26 @@ tree_book_name(board_t *b)
 	return buf;
 }
 
+#define tree_node_saved_size  (offsetof(tree_node_t, is_expanded) + sizeof(bool) - offsetof(tree_node_t, coord))
+
 static void
 tree_node_save(FILE *f, tree_node_t *node, int thres)
 {
-	bool save_children = node->u.playouts >= thres;
+	bool save_children = node_u(node).playouts >= thres;
 
 	if (!save_children)
 		node->is_expanded = 0;
 
-	fputc(1, f);
-	fwrite(((int *) node) + offsetof(tree_node_t, u),
-	       sizeof(tree_node_t) - offsetof(tree_node_t, u),
-	       1, f);
+	fwrite(&node_u(node), sizeof(move_stats_t), 1, f);
+	fwrite(&node_prior(node), sizeof(move_stats_t), 1, f);
+	fwrite(&node_amaf(node), sizeof(move_stats_t), 1, f);
+	fwrite((char *)node + offsetof(tree_node_t, coord), tree_node_saved_size, 1, f);
+
+	int children = 0;
+	if (save_children)
+		for (tree_node_t *ni = node->children; ni; ni = ni->sibling)
+			children++;
+	fwrite(&children, sizeof(children), 1, f);
 
 	if (save_children) {
 		for (tree_node_t *ni = node->children; ni; ni = ni->sibling)
@@ -270,8 +392,6 @@ tree_node_save(FILE *f, tree_node_t *node, int thres)
 		if (node->children)
 			node->is_expanded = 1;
 	}
-
-	fputc(0, f);
 }
 
 void
@@ -284,39 +404,46 @@ tree_save(tree_t *tree, board_t *b, int thres)
 		return;
 	}
 	tree_node_save(f, tree->root, thres);
-	fputc(0, f);
 	fclose(f);
 }
 
 
-void
-tree_node_load(FILE *f, tree_node_t *node, int *num)
+static void
+tree_node_load(FILE *f, tree_t *tree, tree_node_t *node, int *num)
 {
 	(*num)++;
 
-	checked_fread(((int *) node) + offsetof(tree_node_t, u),
-		      sizeof(tree_node_t) - offsetof(tree_node_t, u),
-		      1, f);
+	checked_fread(&node_u(node), sizeof(move_stats_t), 1, f);
+	checked_fread(&node_prior(node), sizeof(move_stats_t), 1, f);
+	checked_fread(&node_amaf(node), sizeof(move_stats_t), 1, f);
+	checked_fread((char *)node + offsetof(tree_node_t, coord), tree_node_saved_size, 1, f);
 
 	/* Keep values in sane scale, otherwise we start overflowing. */
 #define MAX_PLAYOUTS	10000000
-	if (node->u.playouts > MAX_PLAYOUTS) {
-		node->u.playouts = MAX_PLAYOUTS;
+	if (node_u(node).playouts > MAX_PLAYOUTS) {
+		node_u(node).playouts = MAX_PLAYOUTS;
 	}
-	if (node->amaf.playouts > MAX_PLAYOUTS) {
-		node->amaf.playouts = MAX_PLAYOUTS;
+	if (node_amaf(node).playouts > MAX_PLAYOUTS) {
+		node_amaf(node).playouts = MAX_PLAYOUTS;
 	}
-	memcpy(&node->pu, &node->u, sizeof(node->u));
+#ifdef DISTRIBUTED
+	node->pu = node_u(node);
+#endif
 
-	tree_node_t *ni = NULL, *ni_prev = NULL;
-	while (fgetc(f)) {
-		ni_prev = ni; ni = calloc2(1, tree_node_t);
-		if (!node->children)
-			node->children = ni;
-		else
-			ni_prev->sibling = ni;
-		ni->parent = node;
-		tree_node_load(f, ni, num);
+	int children;
+	checked_fread(&children, sizeof(children), 1, f);
+	if (!children)
+		return;
+
+	tree_node_t *ni = tree_alloc_node(tree, children, tree->nodes);
+	if (!ni)
+		die("tbook doesn't fit in tree\n");
+	node->children = ni;
+	for (int i = 0; i < children; i++) {
+		ni[i].parent = node;
+		if (i + 1 < children)
+			ni[i].sibling = &ni[i + 1];
+		tree_node_load(f, tree, &ni[i], num);
 	}
 }
 
@@ -331,59 +458,167 @@ tree_load(tree_t *tree, board_t *b)
 	fprintf(stderr, "Loading opening tbook %s...\n", filename);
 
 	int num = 0;
-	if (fgetc(f))
-		tree_node_load(f, tree->root, &num);
+	tree_node_load(f, tree, tree->root, &num);
 	fprintf(stderr, "Loaded %d nodes.\n", num);
 
 	fclose(f);
 }
 
 
-/* Copy the subtree rooted at node: all nodes at or below depth
- * or with at least threshold playouts. Only for fast_alloc.
- * The code is destructive on src. The relative order of children of
- * a given node is preserved (assumed by tree_get_node in particular).
- * Returns the copy of node in the destination tree, or NULL
- * if we could not copy it. */
+/* Atomically raise t->max_depth to depth if needed.
+ * This function may be called by multiple threads in parallel. */
+static void
+tree_update_max_depth(tree_t *t, int depth)
+{
+	int d = t->max_depth;
+	while (depth > d && !__sync_bool_compare_and_swap(&t->max_depth, d, depth))
+		d = t->max_depth;
+}
+
+/* Copy the children of node into a new block under n2 in the destination
+ * tree (not their own children): see tree_prune_children().
+ * Returns the new block, or NULL if nothing was copied. */
 static tree_node_t *
-tree_prune(tree_t *dest, tree_t *src, tree_node_t *node,
-	   int threshold, int depth)
+tree_prune_copy_children(tree_t *dest, tree_node_t *n2, tree_node_t *node,
+			 int threshold, int depth)
 {
-	assert(dest->nodes && node);
-	tree_node_t *n2 = tree_alloc_node(dest, 1, true);
-	if (!n2)
-		return NULL;
-	*n2 = *node;
-	if (n2->depth > dest->max_depth)
-		dest->max_depth = n2->depth;
 	n2->children = NULL;
 	n2->is_expanded = false;
 
-	if (node->depth >= depth && node->u.playouts < threshold)
-		return n2;
+	if (node->depth >= depth && node_u(node).playouts < threshold)
+		return NULL;
 	/* For deep nodes with many playouts, we must copy all children,
 	 * even those with zero playouts, because partially expanded
 	 * nodes are not supported. Considering them as fully expanded
 	 * would degrade the playing strength. The only exception is
 	 * when dest becomes full, but this should never happen in practice
 	 * if threshold is chosen to limit the number of nodes traversed. */
+	int count = 0;
+	for (tree_node_t *ni = node->children; ni; ni = ni->sibling)
+		count++;
+	if (!count)
+		return NULL;
+	tree_node_t *first = tree_alloc_node(dest, count, true);
+	if (!first)
+		return NULL; // avoid partially expanded nodes
+
 	tree_node_t *ni = node->children;
-	if (!ni)
-		return n2;
-	tree_node_t **prev2 = &(n2->children);
-	while (ni) {
-		tree_node_t *ni2 = tree_prune(dest, src, ni, threshold, depth);
-		if (!ni2) break;
-		*prev2 = ni2;
-		prev2 = &(ni2->sibling);
+	for (int i = 0; i < count; i++, ni = ni->sibling) {
+		tree_node_t *ni2 = &first[i];
+		tree_copy_node(dest, ni2, ni);
 		ni2->parent = n2;
-		ni = ni->sibling;
+		ni2->sibling = (i + 1 < count ? &first[i + 1] : NULL);
+		tree_update_max_depth(dest, ni2->depth);
 	}
-	if (!ni) {
-		n2->is_expanded = true;
-	} else {
-		n2->children = NULL; // avoid partially expanded nodes
+
+	n2->children = first;
+	n2->is_expanded = true;
+	return first;
+}
+
+/* Copy the children of node into n2 in the destination tree, recursively:
+ * all nodes at or below depth or with at least threshold playouts. Only
+ * for fast_alloc. The relative order of children of a given node is
+ * preserved (assumed by tree_get_node in particular).
+ * This function may be called by multiple threads in parallel on
+ * different subtrees. */
+static void
+tree_prune_children(tree_t *dest, tree_node_t *n2, tree_node_t *node,
+		    int threshold, int depth)
+{
+	tree_node_t *first = tree_prune_copy_children(dest, n2, node, threshold, depth);
+	if (!first)
+		return;
+
+	tree_node_t *ni = node->children;
+	for (int i = 0; ni; i++, ni = ni->sibling)
+		tree_prune_children(dest, &first[i], ni, threshold, depth);
+}
+
+/* Parallel pruning: the top levels of the subtree are copied first,
+ * then the subtrees below are handed out to the gc threads. */
+typedef struct {
+	tree_node_t *n2;	/* Destination node */
+	tree_node_t *node;	/* Source node */
+} prune_task_t;
+
+typedef struct {
+	tree_t *dest;
+	int threshold;
+	int depth;
+	prune_task_t *tasks;
+	int ntasks;
+	int max_tasks;
+	volatile int next;
+} prune_ctx_t;
+
+/* Number of levels copied before splitting. */
+#define PRUNE_SPLIT_LEVELS 2
+
+static void
+tree_prune_split(prune_ctx_t *ctx, tree_node_t *n2, tree_node_t *node, int levels)
+{
+	tree_node_t *first = tree_prune_copy_children(ctx->dest, n2, node, ctx->threshold, ctx->depth);
+	if (!first)
+		return;
+
+	tree_node_t *ni = node->children;
+	for (int i = 0; ni; i++, ni = ni->sibling) {
+		if (levels > 1) {
+			tree_prune_split(ctx, &first[i], ni, levels - 1);
+			continue;
+		}
+		if (ctx->ntasks == ctx->max_tasks) {
+			ctx->max_tasks = 2 * ctx->max_tasks + 64;
+			ctx->tasks = (prune_task_t*)realloc(ctx->tasks, ctx->max_tasks * sizeof(prune_task_t));
+		}
+		ctx->tasks[ctx->ntasks++] = (prune_task_t) { &first[i], ni };
 	}
+}
+
+/* Biggest subtrees first for better load balancing. */
+static int
+prune_task_cmp(const void *a, const void *b)
+{
+	const prune_task_t *t1 = a, *t2 = b;
+	return node_u(t2->node).playouts - node_u(t1->node).playouts;
+}
+
+/* Pool job: copy subtrees until no task is left. */
+static void
+tree_prune_job(void *ctx_)
+{
+	prune_ctx_t *ctx = (prune_ctx_t*)ctx_;
+	for (int i; (i = __sync_fetch_and_add(&ctx->next, 1)) < ctx->ntasks; )
+		tree_prune_children(ctx->dest, ctx->tasks[i].n2, ctx->tasks[i].node, ctx->threshold, ctx->depth);
+}
+
+/* Copy the subtree rooted at node, see tree_prune_children().
+ * Uses up to @threads threads from src worker pool. Returns the
+ * copy of node in the destination tree, or NULL if we could not
+ * copy it. */
+static tree_node_t *
+tree_prune(tree_t *dest, tree_t *src, tree_node_t *node,
+	   int threshold, int depth, int threads)
+{
+	assert(dest->nodes && node);
+	tree_node_t *n2 = tree_alloc_node(dest, 1, true);
+	if (!n2)
+		return NULL;
+	tree_copy_node(dest, n2, node);
+	tree_update_max_depth(dest, n2->depth);
+	if (threads <= 1 || !src->pool) {
+		tree_prune_children(dest, n2, node, threshold, depth);
+		return n2;
+	}
+
+	prune_ctx_t ctx = { dest, threshold, depth, NULL, 0, 0, 0 };
+	tree_prune_split(&ctx, n2, node, PRUNE_SPLIT_LEVELS);
+	qsort(ctx.tasks, ctx.ntasks, sizeof(prune_task_t), prune_task_cmp);
+
+	uct_pool_run(src->pool, tree_prune_job, &ctx, threads - 1);
+
+	free(ctx.tasks);
 	return n2;
 }
 
@@ -420,15 +655,17 @@ tree_garbage_collect(tree_t *tree, tree_node_t *node)
 	size_t orig_size = tree->nodes_size;
 
 	tree_t *temp_tree = tree_init(tree->board,  tree->root_color,
-					   tree->max_pruned_size, 0, 0, tree->ltree_aging, 0);
+					   tree->max_pruned_size, 0, 0, tree->ltree_aging, 0,
+					   tree->arena | (tree->crit_stats ? TREE_CRIT_STATS : 0));
 	temp_tree->nodes_size = 0; // We do not want the dummy pass node
+	temp_tree->pool = tree->pool;
         tree_node_t *temp_node;
 
 	/* Find the maximum depth at which we can copy all nodes. */
 	int max_nodes = 1;
 	for (tree_node_t *ni = node->children; ni; ni = ni->sibling)
 		max_nodes++;
-	size_t nodes_size = max_nodes * sizeof(*node);
+	size_t nodes_size = tree_block_size(tree, max_nodes);
 	int max_depth = node->depth;
 	while (nodes_size < tree->max_pruned_size && max_nodes > 1) {
 		max_nodes--;
@@ -442,26 +679,29 @@ tree_garbage_collect(tree_t *tree, tree_node_t *node)
 	 * to save time scanning the source tree. It can take over 20s to traverse
 	 * completely a large source tree (20 GB) even without copying because
 	 * the traversal is not friendly at all with the memory cache. */
-	int threshold = (node->u.playouts - LARGE_TREE_PLAYOUTS) * DEEP_PLAYOUTS_THRESHOLD / LARGE_TREE_PLAYOUTS;
+	int threshold = (node_u(node).playouts - LARGE_TREE_PLAYOUTS) * DEEP_PLAYOUTS_THRESHOLD / LARGE_TREE_PLAYOUTS;
 	if (threshold < 0) threshold = 0;
 	if (threshold > DEEP_PLAYOUTS_THRESHOLD) threshold = DEEP_PLAYOUTS_THRESHOLD; 
-	temp_node = tree_prune(temp_tree, tree, node, threshold, max_depth);
+	/* Use parallel copy only for trees big enough to be worth it. */
+	int threads = (node_u(node).playouts < SMALL_TREE_PLAYOUTS ? 1 : tree->gc_threads);
+	temp_node = tree_prune(temp_tree, tree, node, threshold, max_depth, threads);
 	assert(temp_node);
 
 	/* Now copy back to original tree. */
 	tree->nodes_size = 0;
 	tree->max_depth = 0;
-	tree_node_t *new_node = tree_prune(tree, temp_tree, temp_node, 0, temp_tree->max_depth);
+	tree_node_t *new_node = tree_prune(tree, temp_tree, temp_node, 0, temp_tree->max_depth, threads);
 
 	if (DEBUGL(1)) {
 		double now = time_now();
 		static double prev_time;
 		if (!prev_time) prev_time = start_time;
 		fprintf(stderr,
-			"tree pruned in %0.3fs, prev %0.1fs ago, dest depth %d wanted %d,"
-			" size %llu->%llu/%llu, playouts %d\n",
-			now - start_time, start_time - prev_time, temp_tree->max_depth, max_depth,
-			(unsigned long long)orig_size, (unsigned long long)temp_tree->nodes_size, (unsigned long long)tree->max_pruned_size, new_node->u.playouts);
+			"tree pruned in %0.3fs (%d threads), prev %0.1fs ago, dest depth %d wanted %d,"
+			" size %llu->%llu/%llu, moved %lluMb, playouts %d\n",
+			now - start_time, threads, start_time - prev_time, temp_tree->max_depth, max_depth,
+			(unsigned long long)orig_size, (unsigned long long)temp_tree->nodes_size, (unsigned long long)tree->max_pruned_size,
+			(unsigned long long)(2 * tree->nodes_size / 1048576), node_u(new_node).playouts);
 		prev_time = start_time;
 	}
 	if (temp_tree->nodes_size >= temp_tree->max_tree_size) {
@@ -602,8 +842,8 @@ tree_expand_node(tree_t *t, tree_node_t *node, board_t *b, enum stone color, uct
 	} foreach_free_point_end;
 	uct_prior(u, node, &map);
 
-	/* Now, create the nodes (all at once if fast_alloc) */
-	tree_node_t *ni = t->nodes ? tree_alloc_node(t, child_count, true) : tree_alloc_node(t, 1, false);
+	/* Now, create the nodes, all at once. */
+	tree_node_t *ni = tree_alloc_node(t, child_count, t->nodes);
 	/* In fast_alloc mode we might temporarily run out of nodes but this should be rare. */
 	if (!ni) {
 		node->is_expanded = false;
@@ -613,7 +853,7 @@ tree_expand_node(tree_t *t, tree_node_t *node, board_t *b, enum stone color, uct
 
 	tree_node_t *first_child = ni;
 	ni->parent = node;
-	ni->prior = map.prior[pass]; ni->d = TREE_NODE_D_MAX + 1;
+	node_prior(ni) = map.prior[pass]; ni->d = TREE_NODE_D_MAX + 1;
 
 	/* The loop considers only the symmetry playground. */
 	if (UDEBUGL(6)) {
@@ -640,15 +880,20 @@ tree_expand_node(tree_t *t, tree_node_t *node, board_t *b, enum stone color, uct
 				continue;
 			assert(c != node_coord(node)); // I have spotted "C3 C3" in some sequence...
 
-			tree_node_t *nj = t->nodes ? first_child + child++ : tree_alloc_node(t, 1, false);
+			tree_node_t *nj = first_child + child++;
 			tree_setup_node(t, nj, c, node->depth + 1);
 			nj->parent = node; ni->sibling = nj; ni = nj;
 
-			ni->prior = map.prior[c];
+			node_prior(ni) = map.prior[c];
 			ni->d = distances[c];
 		}
 	}
+	tree_node_block(first_child)->live = child;  // Symmetry may leave some nodes unused
 	node->children = first_child; // must be done at the end to avoid race
+
+	/* No dcnn priors yet, they'll be merged when ready. */
+	if (u->dcnn_queue && u->tree_ready && !(node->hints & TREE_HINT_DCNN))
+		dcnn_queue_submit(u->dcnn_queue, node, b, color, map.parity);
 }
 
 
@@ -736,8 +981,8 @@ tree_unlink_node(tree_node_t *node)
 static tree_node_t *
 tree_age_node(tree_t *tree, tree_node_t *node)
 {
-	node->u.playouts /= tree->ltree_aging;
-	if (node->parent && !node->u.playouts) {
+	node_u(node).playouts /= tree->ltree_aging;
+	if (node->parent && !node_u(node).playouts) {
 		tree_node_t *sibling = node->sibling;
 		/* Delete node, no playouts. */
 		tree_unlink_node(node);
@@ -758,13 +1003,22 @@ tree_promote_node(tree_t *tree, tree_node_t **node)
 	assert((*node)->parent == tree->root);
 	tree_unlink_node(*node);
 	if (!tree->nodes) {
+		/* The node shares its block with its former siblings which
+		 * are about to be freed, move it to its own block. */
+		tree_node_t *n2 = tree_alloc_node(tree, 1, false);
+		tree_copy_node(tree, n2, *node);
+		for (tree_node_t *ni = n2->children; ni; ni = ni->sibling)
+			ni->parent = n2;
+		tree_release_node(tree, *node);
+		*node = n2;
+
 		/* Freeing the rest of the tree can take several seconds on large
 		 * trees, so we must do it asynchronously: */
 		tree_done_node_detached(tree, tree->root);
 	} else {
 		/* Garbage collect if we run out of memory, or it is cheap to do so now: */
 		if (tree->nodes_size >= tree->pruning_threshold
-		    || (tree->nodes_size >= tree->max_tree_size / 10 && (*node)->u.playouts < SMALL_TREE_PLAYOUTS))
+		    || (tree->nodes_size >= tree->max_tree_size / 10 && node_u(*node).playouts < SMALL_TREE_PLAYOUTS))
 			*node = tree_garbage_collect(tree, *node);
 	}
 	tree->root = *node;
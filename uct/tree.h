@@ -5,9 +5,9 @@
  *
  * Two allocation methods are supported for the tree nodes:
  *
- * - calloc/free: each node is allocated with one calloc.
+ * - calloc/free: each block of nodes is allocated with one calloc.
  *   After a move, all nodes except the subtree rooted at
- *   the played move are freed one by one with free().
+ *   the played move are freed block by block with free().
  *   Since this can be very slow (seen 9s and loss on time because
  *   of this) the nodes are freed in a background thread.
  *   We still reserve enough memory for the next move in case
@@ -21,7 +21,11 @@
  *   if necessary to fit in this small buffer. We copy by
  *   preference nodes with largest number of playouts.
  *   Then the temporary buffer is copied back to the original
- *   buffer, which has now plenty of space.
+ *   buffer, which has now plenty of space. Both copies are split
+ *   among gc_threads threads for large trees. When pondering, the
+ *   tree can also be collected while the search is running
+ *   (ponder_gc uct option) so it doesn't have to be done on
+ *   our time after the opponent's move.
  *   Once the fast_alloc mode is proven reliable, the
  *   calloc/free method will be removed. */
 
@@ -47,28 +51,26 @@ struct uct;
  * +------+   +------+   +------+   +------+
  */
 
-/* TODO: Performance would benefit from a reorganization:
- * (i) Allocate all children of a node within a single block.
- * (ii) Keep all u stats together, and all amaf stats together.
- * Currently, rave_update is top source of cache misses, and
- * there is large memory overhead for having all nodes separate. */
+/* All children of a node are allocated within a single block. The hot
+ * statistics (u, amaf and prior) are not stored in the nodes themselves
+ * but in parallel arrays placed in front of the block, so that descent
+ * and amaf updates scan contiguous memory instead of striding through
+ * whole nodes. Criticality stats are optional (tree->crit_stats) and
+ * stored after the nodes. For a block of n nodes the layout is:
+ *
+ *   | header | u[n] | amaf[n] | prior[n] | node[n] | winner_owner[n] | black_owner[n] |
+ *
+ * Use node_u(), node_amaf(), node_prior() etc to access them. The root
+ * and local tree nodes live in blocks of size 1. */
 
 typedef struct tree_node {
-	hash_t hash;
 	struct tree_node *parent, *sibling, *children;
 
-	/*** From here on, struct is saved/loaded from opening tbook */
+	/* Position of the node within its block, and block size. */
+	unsigned short block_idx, block_len;
 
-	move_stats_t u;
-	move_stats_t prior;
-	/* XXX: Should be way for policies to add their own stats */
-	move_stats_t amaf;
-	/* Stats before starting playout; used for distributed engine. */
-	move_stats_t pu;
-	/* Criticality information; information about final board owner
-	 * of the tree coordinate corresponding to the node */
-	move_stats_t winner_owner; // owner == winner
-	move_stats_t black_owner; // owner == black
+	/*** From here on, struct is saved/loaded from opening tbook
+	 *   (along with the u, prior and amaf stats) */
 
 	/* coord is usually coord_t, but this is very space-sensitive. */
 #define node_coord(n) ((int) (n)->coord)
@@ -86,6 +88,7 @@ typedef struct tree_node {
 
 #define TREE_HINT_INVALID 1 // don't go to this node, invalid move
 #define TREE_HINT_DCNN    2 // node has dcnn priors
+#define TREE_HINT_TTABLE  4 // node looked up in transposition table
 	unsigned char hints;
 
 	/* In case multiple threads walk the tree, is_expanded is set
@@ -95,8 +98,45 @@ typedef struct tree_node {
 	*   2) children == null, is_expanded == true: one thread currently expanding
 	*   2) children != null, is_expanded == true: fully expanded node */
 	bool is_expanded;
+
+#ifdef DISTRIBUTED
+	/* Stats before starting playout; used for distributed engine. */
+	move_stats_t pu;
+#endif
 } tree_node_t;
 
+/* Block header. In calloc mode nodes may leave the tree one by one
+ * (promotion, local tree aging): the block is freed when the last
+ * of its nodes still in the tree is freed. */
+typedef struct {
+	int live;		/* Nodes of the block still in the tree */
+} __attribute__((aligned(8))) tree_block_t;
+
+/* Byte size of a block of n nodes, including header and stats arrays. */
+#define tree_block_size(t, n)  (sizeof(tree_block_t) + (size_t)(n) * ((3 + 2 * (t)->crit_stats) * sizeof(move_stats_t) + sizeof(tree_node_t)))
+
+/* Start of the stats arrays for the block containing node. */
+static inline move_stats_t *
+tree_node_stats(const tree_node_t *node)
+{
+	return (move_stats_t *)(node - node->block_idx) - 3 * node->block_len;
+}
+
+#define tree_node_block(n)  ((tree_block_t *)tree_node_stats(n) - 1)
+
+/* Start of the criticality stats for the block containing node. */
+#define tree_node_crit_stats(n)  ((move_stats_t *)((n) - (n)->block_idx + (n)->block_len))
+
+#define node_u(n)      (tree_node_stats(n)[(n)->block_idx])
+#define node_amaf(n)   (tree_node_stats(n)[(n)->block_len + (n)->block_idx])
+#define node_prior(n)  (tree_node_stats(n)[2 * (n)->block_len + (n)->block_idx])
+
+/* Criticality information; information about final board owner
+ * of the tree coordinate corresponding to the node.
+ * Only valid if tree->crit_stats is set. */
+#define node_winner_owner(n)  (tree_node_crit_stats(n)[(n)->block_idx])                  // owner == winner
+#define node_black_owner(n)   (tree_node_crit_stats(n)[(n)->block_len + (n)->block_idx])  // owner == black
+
 struct tree_hash;
 
 typedef struct {
@@ -146,12 +186,25 @@ typedef struct {
 	size_t max_tree_size; // maximum byte size for entire tree, > 0 only for fast_alloc
 	size_t max_pruned_size;
 	size_t pruning_threshold;
+	int gc_threads; // threads used for garbage collection
+	struct uct_pool *pool; // uct worker pool running parallel gc, may be NULL
 	void *nodes; // nodes buffer, only for fast_alloc
+	int arena; // TREE_ARENA_* flags for nodes buffer
+	bool crit_stats; // nodes have criticality stats
 } tree_t;
 
+/* tree_init() flags */
+/* fast_alloc nodes buffer options (linux only). Default is plain malloc(). */
+#define TREE_ARENA_THP        1  /* mmap() + transparent huge pages */
+#define TREE_ARENA_HUGETLB    2  /* mmap() explicit huge pages, falls back to THP */
+#define TREE_ARENA_INTERLEAVE 4  /* mmap() + interleave pages over numa nodes */
+#define TREE_ARENA_MASK       7
+#define TREE_CRIT_STATS       8  /* Keep criticality stats in nodes */
+
 /* Warning: all functions below except tree_expand_node & tree_leaf_node are THREAD-UNSAFE! */
 tree_t *tree_init(board_t *board, enum stone color, size_t max_tree_size,
-		       size_t max_pruned_size, size_t pruning_threshold, floating_t ltree_aging, int hbits);
+		       size_t max_pruned_size, size_t pruning_threshold, floating_t ltree_aging, int hbits,
+		       int flags);
 void tree_done(tree_t *tree);
 void tree_dump(tree_t *tree, double thres);
 void tree_save(tree_t *tree, board_t *b, int thres);
@@ -196,9 +249,11 @@ tree_node_criticality(const tree_t *t, const tree_node_t *node)
 	 * = winner_gets - (b_gets * b_wins + (1 - b_gets) * (1 - b_wins))
 	 * = winner_gets - (b_gets * b_wins + 1 - b_gets - b_wins + b_gets * b_wins)
 	 * = winner_gets - (2 * b_gets * b_wins - b_gets - b_wins + 1) */
-	return node->winner_owner.value
-		- (2 * node->black_owner.value * node->u.value
-		   - node->black_owner.value - node->u.value + 1);
+	if (!t->crit_stats)
+		return 0;
+	return node_winner_owner(node).value
+		- (2 * node_black_owner(node).value * node_u(node).value
+		   - node_black_owner(node).value - node_u(node).value + 1);
 }
 
 #endif
@@ -0,0 +1,124 @@
+#include <assert.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "board.h"
+#include "debug.h"
+#include "util.h"
+#include "uct/ttable.h"
+
+/* Entries are grouped in buckets of TTABLE_WAYS consecutive slots. When
+ * a bucket is full, the entry with fewest playouts gets replaced. */
+#define TTABLE_WAYS 4
+
+/* Random constant to tell positions with different color to play apart. */
+#define TTABLE_WHITE_TO_PLAY 0x9e3779b97f4a7c15ULL
+
+ttable_t *
+ttable_init(int bits)
+{
+	assert(bits >= 2 && bits < 32);
+	ttable_t *tt = calloc2(1, ttable_t);
+	tt->bits = bits;
+	tt->entries = calloc2(1 << bits, ttable_entry_t);
+	return tt;
+}
+
+void
+ttable_done(ttable_t *tt)
+{
+	free(tt->entries);
+	free(tt);
+}
+
+void
+ttable_clear(ttable_t *tt)
+{
+	memset(tt->entries, 0, (1 << tt->bits) * sizeof(ttable_entry_t));
+}
+
+hash_t
+ttable_key(board_t *b, enum stone color)
+{
+	hash_t key = b->hash;
+	if (color == S_WHITE)
+		key ^= TTABLE_WHITE_TO_PLAY;
+	if (!is_pass(b->ko.coord))
+		key ^= hash_at(b->ko.coord, S_BLACK) ^ hash_at(b->ko.coord, S_WHITE);
+	return key ? key : 1;  /* 0 marks empty slots */
+}
+
+static inline ttable_entry_t *
+ttable_bucket(ttable_t *tt, hash_t key)
+{
+	int mask = (1 << tt->bits) - 1;
+	return &tt->entries[key & mask & ~(TTABLE_WAYS - 1)];
+}
+
+static ttable_entry_t *
+ttable_find(ttable_t *tt, hash_t key)
+{
+	ttable_entry_t *e = ttable_bucket(tt, key);
+	for (int i = 0; i < TTABLE_WAYS; i++)
+		if (e[i].hash == key)
+			return &e[i];
+	return NULL;
+}
+
+/* This function may be called by multiple threads in parallel.
+ * Two threads racing for the same slot may mix up stats of the
+ * replaced position, which is harmless. */
+void
+ttable_update(ttable_t *tt, hash_t key, floating_t result)
+{
+	ttable_entry_t *e = ttable_bucket(tt, key);
+	ttable_entry_t *victim = &e[0];
+	for (int i = 0; i < TTABLE_WAYS; i++) {
+		if (e[i].hash == key) {
+			stats_add_result(&e[i].u, result, 1);
+			return;
+		}
+		if (e[i].u.playouts < victim->u.playouts)
+			victim = &e[i];
+	}
+
+	hash_t old = victim->hash;
+	if (!__sync_bool_compare_and_swap(&victim->hash, old, key))
+		return;
+	victim->u = (move_stats_t)move_stats(result, 1);
+}
+
+void
+ttable_node_enter(ttable_t *tt, tree_node_t *n, hash_t key)
+{
+	__sync_fetch_and_add(&tt->lookups, 1);
+	ttable_entry_t *e = ttable_find(tt, key);
+	if (!e)
+		return;
+	move_stats_t s = e->u;
+	if (!s.playouts || e->hash != key)
+		return;
+
+	__sync_fetch_and_add(&tt->hits, 1);
+	__sync_fetch_and_add(&tt->inherited, s.playouts);
+	stats_merge(&node_prior(n), &s);
+}
+
+void
+ttable_stats_reset(ttable_t *tt)
+{
+	tt->lookups = tt->hits = 0;
+	tt->inherited = 0;
+}
+
+void
+ttable_print_stats(ttable_t *tt, FILE *f)
+{
+	int used = 0;
+	for (int i = 0; i < (1 << tt->bits); i++)
+		used += !!tt->entries[i].hash;
+	fprintf(f, "transpositions: %d/%d new nodes hit (%.1f%%), %ld playouts inherited, table %d/%d used\n",
+		tt->hits, tt->lookups, tt->lookups ? tt->hits * 100.0 / tt->lookups : 0.0,
+		tt->inherited, used, 1 << tt->bits);
+}
@@ -0,0 +1,51 @@
+#ifndef PACHI_UCT_TTABLE_H
+#define PACHI_UCT_TTABLE_H
+
+/* Transposition table: UCT stats aggregated per position.
+ *
+ * The tree itself stays a tree: each node has its own stats and a single
+ * parent. In addition, every playout result is recorded in a bounded
+ * hash table keyed by the position reached at each step of the descent
+ * (board hash, color to play and ko). When the descent enters a node for
+ * the first time and the position was already searched through another
+ * move order (or before the tree got pruned), the stats gathered so far
+ * for this position are merged into the node prior, so the node doesn't
+ * have to be searched again from scratch. */
+
+#include "board.h"
+#include "stats.h"
+#include "uct/tree.h"
+
+typedef struct {
+	hash_t hash;
+	move_stats_t u;  /* From black's perspective, like node u stats. */
+} ttable_entry_t;
+
+typedef struct {
+	int bits;
+	ttable_entry_t *entries;
+
+	/* Statistics, reset with ttable_stats_reset() */
+	int lookups;     /* Nodes entered for the first time */
+	int hits;        /* ... whose position was already in the table */
+	long inherited;  /* Playouts merged into node priors on hits */
+} ttable_t;
+
+ttable_t *ttable_init(int bits);
+void ttable_done(ttable_t *tt);
+void ttable_clear(ttable_t *tt);
+
+/* Position key for board @b with @color to play. */
+hash_t ttable_key(board_t *b, enum stone color);
+
+/* Record playout result for position @key. */
+void ttable_update(ttable_t *tt, hash_t key, floating_t result);
+
+/* Node @n is entered for the first time and leads to position @key:
+ * merge stats for this position into the node prior. */
+void ttable_node_enter(ttable_t *tt, tree_node_t *n, hash_t key);
+
+void ttable_stats_reset(ttable_t *tt);
+void ttable_print_stats(ttable_t *tt, FILE *f);
+
+#endif
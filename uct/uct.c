@@ -1,4 +1,5 @@
 #include <assert.h>
+#include <inttypes.h>
 #include <math.h>
 #include <stdio.h>
 #include <stdlib.h>
@@ -17,6 +18,8 @@
 #include "playout.h"
 #include "playout/moggy.h"
 #include "playout/light.h"
+#include "playout/softmax.h"
+#include "tactics/ladder.h"
 #include "tactics/util.h"
 #include "timeinfo.h"
 #include "uct/dynkomi.h"
@@ -41,7 +44,10 @@ static void
 setup_state(uct_t *u, board_t *b, enum stone color)
 {
 	u->t = tree_init(b, color, u->fast_alloc ? u->max_tree_size : 0,
-			 u->max_pruned_size, u->pruning_threshold, u->local_tree_aging, u->stats_hbits);
+			 u->max_pruned_size, u->pruning_threshold, u->local_tree_aging, u->stats_hbits,
+			 u->tree_arena | (u->policy->wants_crit ? TREE_CRIT_STATS : 0));
+	u->t->gc_threads = u->threads;
+	u->t->pool = u->pool;
 	if (u->initial_extra_komi)
 		u->t->extra_komi = u->initial_extra_komi;
 	if (u->force_seed)
@@ -62,6 +68,7 @@ reset_state(uct_t *u)
 {
 	assert(u->t);
 	tree_done(u->t); u->t = NULL;
+	if (u->ttable)  ttable_clear(u->ttable);
 }
 
 static void
@@ -116,7 +123,7 @@ uct_pass_is_safe(uct_t *u, board_t *b, enum stone color, bool pass_all_alive, ch
 	if (pass_all_alive) {
 		*msg = "need to remove opponent dead groups first";
 		for (unsigned int i = 0; i < dead.moves; i++)
-			if (board_at(b, dead.move[i]) == stone_other(color))
+			if (board_at(b, group_base(b, dead.move[i])) == stone_other(color))
 				return false;
 		dead.moves = 0; // our dead stones are alive when pass_all_alive is true
 
@@ -156,7 +163,7 @@ uct_board_print(engine_t *e, board_t *b, FILE *f)
 void
 uct_mcowner_playouts(uct_t *u, board_t *b, enum stone color)
 {
-	playout_setup_t ps = playout_setup(u->gamelen, u->mercymin);
+	playout_setup_t ps = playout_setup(u->gamelen, u->mercymin, u->playout_cycles);
 	
 	/* TODO pick random last move, better playouts randomness */
 
@@ -242,7 +249,7 @@ uct_result(engine_t *e, board_t *b)
 	tree_node_t *n = u->t->root;
 	snprintf(reply, 1024, "%s %s %d %.2f %.1f",
 		 stone2str(color), coord2sstr(node_coord(n)),
-		 n->u.playouts, tree_node_get_value(u->t, -1, n->u.value),
+		 node_u(n).playouts, tree_node_get_value(u->t, -1, node_u(n).value),
 		 u->t->use_extra_komi ? u->t->extra_komi : 0);
 	return reply;
 }
@@ -256,11 +263,11 @@ uct_chat(engine_t *e, board_t *b, bool opponent, char *from, char *cmd)
 		return generic_chat(b, opponent, from, cmd, S_NONE, pass, 0, 1, u->threads, 0.0, 0.0, "");
 
 	tree_node_t *n = u->t->root;
-	double winrate = tree_node_get_value(u->t, -1, n->u.value);
+	double winrate = tree_node_get_value(u->t, -1, node_u(n).value);
 	double extra_komi = u->t->use_extra_komi && fabs(u->t->extra_komi) >= 0.5 ? u->t->extra_komi : 0;
 	char *score_est = ownermap_score_est_str(b, &u->ownermap);
 
-	return generic_chat(b, opponent, from, cmd, u->t->root_color, node_coord(n), n->u.playouts, 1,
+	return generic_chat(b, opponent, from, cmd, u->t->root_color, node_coord(n), node_u(n).playouts, 1,
 			    u->threads, winrate, extra_komi, score_est);
 }
 
@@ -329,12 +336,15 @@ uct_done(engine_t *e)
 
 	free(u->banner);
 	uct_pondering_stop(u);
+	uct_pool_done(u);
 	if (u->t)             reset_state(u);
 	if (u->dynkomi)       u->dynkomi->done(u->dynkomi);
 	if (u->policy)        u->policy->done(u->policy);
 	if (u->random_policy) u->random_policy->done(u->random_policy);
 	playout_policy_done(u->playout);
 	uct_prior_done(u->prior);
+	if (u->ttable)        ttable_done(u->ttable);
+	if (u->dcnn_queue)    dcnn_queue_done(u->dcnn_queue);
 #ifdef PACHI_PLUGINS
 	pluginset_done(u->plugins);
 #endif
@@ -342,11 +352,27 @@ uct_done(engine_t *e)
 
 
 
+/* Ladder cache use during this search (@start: stats before search). */
+static void
+uct_ladder_cache_stats(ladder_cache_stats_t *start)
+{
+	ladder_cache_stats_t lc;  ladder_cache_stats(&lc);
+	uint64_t lookups = lc.lookups - start->lookups;
+	uint64_t hits = lc.hits - start->hits;
+	uint64_t stores = lc.stores - start->stores;
+	if (!lookups)
+		return;
+	double avg = (stores ? (double)(lc.stored_ticks - start->stored_ticks) / stores : 0);
+	fprintf(stderr, "ladder cache: %" PRIu64 " lookups, %" PRIu64 " hits (%.1f%%), %" PRIu64 " stored, ~%.1fM " TICKS_UNIT " reading saved\n",
+		lookups, hits, 100.0 * hits / lookups, stores, hits * avg / 1e6);
+}
+
 /* Run time-limited MCTS search on foreground. */
 static int
 uct_search(uct_t *u, board_t *b, time_info_t *ti, enum stone color, tree_t *t, bool print_progress)
 {
 	uct_search_state_t s;
+	ladder_cache_stats_t lc;  ladder_cache_stats(&lc);
 	uct_search_start(u, b, color, t, ti, &s);
 	if (UDEBUGL(2) && s.base_playouts > 0)
 		fprintf(stderr, "<pre-simulated %d games>\n", s.base_playouts);
@@ -379,6 +405,13 @@ uct_search(uct_t *u, board_t *b, time_info_t *ti, enum stone color, tree_t *t, b
 			t->avg_score.value, t->avg_score.playouts,
 			u->dynkomi->score.value, u->dynkomi->score.playouts,
 			u->dynkomi->value.value, u->dynkomi->value.playouts);
+	if (UDEBUGL(2))
+		uct_ladder_cache_stats(&lc);
+	if (UDEBUGL(3)) {
+		strbuf(buf, 4096);
+		if (playout_moggy_stats(buf))
+			fprintf(stderr, "%s", buf->str);
+	}
 	if (print_progress)
 		uct_progress_status(u, t, color, ctx->games, NULL);
 
@@ -387,7 +420,7 @@ uct_search(uct_t *u, board_t *b, time_info_t *ti, enum stone color, tree_t *t, b
 		time_info_t debug_ti;
 		debug_ti.period = TT_MOVE;
 		debug_ti.dim = TD_GAMES;
-		debug_ti.len.games = t->root->u.playouts + u->debug_after.playouts;
+		debug_ti.len.games = node_u(t->root).playouts + u->debug_after.playouts;
 		debug_ti.len.games_max = 0;
 
 		board_print_ownermap(b, stderr, &u->ownermap);
@@ -401,7 +434,7 @@ uct_search(uct_t *u, board_t *b, time_info_t *ti, enum stone color, tree_t *t, b
 		u->playout->debug_level = u->debug_after.level;
 		uct_halt = false;
 
-		uct_playouts(u, b, color, t, &debug_ti);
+		uct_playouts(u, b, color, t, &debug_ti, NULL);
 		tree_dump(t, u->dumpthres);
 
 		uct_halt = true;
@@ -505,8 +538,13 @@ genmove(engine_t *e, board_t *b, time_info_t *ti, enum stone color, bool pass_al
 
 	uct_genmove_setup(u, b, color);
 
+	if (u->ttable)  ttable_stats_reset(u->ttable);
+	if (u->dcnn_queue)  dcnn_queue_stats_reset(u->dcnn_queue);
+	double early_stop_saved = u->early_stop_saved;
+	u->walk_ticks = u->playout_ticks = 0;
+
         /* Start the Monte Carlo Tree Search! */
-	int base_playouts = u->t->root->u.playouts;
+	int base_playouts = node_u(u->t->root).playouts;
 	int played_games = uct_search(u, b, ti, color, u->t, false);
 
 	tree_node_t *best;
@@ -517,6 +555,14 @@ genmove(engine_t *e, board_t *b, time_info_t *ti, enum stone color, bool pass_al
 		double mcts_time  = time_now() - u->mcts_time_start + 0.000001; /* avoid divide by zero */
 		fprintf(stderr, "genmove in %0.2fs, mcts %0.2fs (%d games/s, %d games/s/thread)\n",
 			total_time, mcts_time, (int)(played_games/mcts_time), (int)(played_games/mcts_time/u->threads));
+		if (u->ttable)  ttable_print_stats(u->ttable, stderr);
+		if (u->dcnn_queue)  dcnn_queue_print_stats(u->dcnn_queue, stderr);
+		if (u->time_tree && u->walk_ticks)
+			fprintf(stderr, "tree walk: %.1f%% of playout time outside playouts\n",
+				100.0 * (u->walk_ticks - u->playout_ticks) / u->walk_ticks);
+		if (u->early_stop_saved > early_stop_saved)
+			fprintf(stderr, "early stop saved %0.2fs (this game: %d early stops, %0.2fs saved)\n",
+				u->early_stop_saved - early_stop_saved, u->early_stops, u->early_stop_saved);
 	}
 
 	uct_progress_status(u, u->t, color, played_games, best_coord);
@@ -631,12 +677,12 @@ uct_get_best_moves_at(uct_t *u, tree_node_t *parent, coord_t *best_c, float *bes
 	
 	/* Find best moves */
 	for (tree_node_t *n = parent->children; n; n = n->sibling)
-		if (n->u.playouts >= min_playouts)
-			best_moves_add_full(node_coord(n), n->u.playouts, n, best_c, best_r, (void**)best_n, nbest);
+		if (node_u(n).playouts >= min_playouts)
+			best_moves_add_full(node_coord(n), node_u(n).playouts, n, best_c, best_r, (void**)best_n, nbest);
 
 	if (winrates)  /* Get winrates */
 		for (int i = 0; i < nbest && best_n[i]; i++)
-			best_r[i] = tree_node_get_value(u->t, 1, best_n[i]->u.value);
+			best_r[i] = tree_node_get_value(u->t, 1, node_u(best_n[i]).value);
 }
 
 /* Get best moves with at least @min_playouts.
@@ -666,6 +712,22 @@ uct_best_moves(engine_t *e, board_t *b, time_info_t *ti, enum stone color,
 		reset_state(u);
 }
 
+void
+uct_walk_ticks(engine_t *e, uint64_t *walk, uint64_t *playouts)
+{
+	uct_t *u = (uct_t*)e->data;
+	*walk = u->walk_ticks;
+	*playouts = u->playout_ticks;
+}
+
+bool
+uct_engine_pass_is_safe(engine_t *e, board_t *b, enum stone color, bool pass_all_alive, char **msg)
+{
+	uct_t *u = (uct_t*)e->data;
+	ownermap_init(&u->ownermap);
+	return uct_pass_is_safe(u, b, color, pass_all_alive, msg);
+}
+
 bool
 uct_gentbook(engine_t *e, board_t *b, time_info_t *ti, enum stone color)
 {
@@ -675,7 +737,7 @@ uct_gentbook(engine_t *e, board_t *b, time_info_t *ti, enum stone color)
 
 	if (ti->dim == TD_GAMES) {
 		/* Don't count in games that already went into the tbook. */
-		ti->len.games += u->t->root->u.playouts;
+		ti->len.games += node_u(u->t->root).playouts;
 	}
 	uct_search(u, b, ti, color, u->t, true);
 
@@ -690,7 +752,8 @@ uct_dumptbook(engine_t *e, board_t *b, enum stone color)
 {
 	uct_t *u = (uct_t*)e->data;
 	tree_t *t = tree_init(b, color, u->fast_alloc ? u->max_tree_size : 0,
-			      u->max_pruned_size, u->pruning_threshold, u->local_tree_aging, 0);
+			      u->max_pruned_size, u->pruning_threshold, u->local_tree_aging, 0,
+			      u->tree_arena | (u->policy->wants_crit ? TREE_CRIT_STATS : 0));
 	tree_load(t, b);
 	tree_dump(t, 0);
 	tree_done(t);
@@ -720,7 +783,7 @@ uct_evaluate_one(engine_t *e, board_t *b, time_info_t *ti, coord_t c, enum stone
 	if (!best) {
 		bestval = NAN; // the opponent has no reply!
 	} else {
-		bestval = tree_node_get_value(u->t, 1, best->u.value);
+		bestval = tree_node_get_value(u->t, 1, node_u(best).value);
 	}
 
 	reset_state(u); // clean our junk
@@ -920,12 +983,14 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 		 * moggy is the default policy with large
 		 * amount of domain-specific knowledge and
 		 * heuristics. light is a simple uniformly
-		 * random move selection policy. */
+		 * random move selection policy. softmax samples
+		 * moves from 3x3 pattern gammas (experimental). */
 		char *playoutarg = strchr(optval, ':');
 		if (playoutarg)
 			*playoutarg++ = 0;
 		if      (!strcasecmp(optval, "moggy"))  u->playout = playout_moggy_init(playoutarg, b);
 		else if (!strcasecmp(optval, "light"))  u->playout = playout_light_init(playoutarg, b);
+		else if (!strcasecmp(optval, "softmax"))  u->playout = playout_softmax_init(playoutarg, b);
 		else    option_error("UCT: Invalid playout policy %s\n", optval);
 	}
 	else if (!strcasecmp(optname, "prior") && optval) {  NEED_RESET
@@ -949,6 +1014,12 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 		 * in moves. */
 		u->gamelen = atoi(optval);
 	}
+	else if (!strcasecmp(optname, "playout_cycles")) {
+		/* Stop simulation early when a position repeats
+		 * (long ko fights, triple ko ...) instead of
+		 * playing on until gamelen. */
+		u->playout_cycles = !optval || atoi(optval);
+	}
 	else if (!strcasecmp(optname, "expand_p") && optval) {
 		/* Expand UCT nodes after it has been
 		 * visited this many times. */
@@ -992,7 +1063,36 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 
 	else if (!strcasecmp(optname, "threads") && optval) {
 		/* Default: 1 thread per core. */
+		if (atoi(optval) < 1)
+			option_error("UCT: Invalid threads %s\n", optval);
 		u->threads = atoi(optval);
+		if (!setup) {
+			uct_pondering_stop(u);
+			uct_pool_update(u);
+		}
+	}
+	else if (!strcasecmp(optname, "pin_threads")) {
+		/* Pin each search thread to a different cpu
+		 * (linux only). */
+		u->pin_threads = !optval || atoi(optval);
+		if (!setup) {
+			uct_pondering_stop(u);
+			uct_pool_update(u);
+		}
+	}
+	else if (!strcasecmp(optname, "time_tree")) {
+		/* Measure time spent in tree descent, expansion and
+		 * updates apart from the playouts themselves.
+		 * Shown in genmove log, used by pachi --bench. */
+		u->time_tree = !optval || atoi(optval);
+	}
+	else if (!strcasecmp(optname, "ownermap_merge") && optval) {
+		/* Each search thread fills its own ownermap and adds
+		 * it to the shared one every N playouts (and at the
+		 * end of the search). Avoids lost updates and cache
+		 * line bouncing on the shared ownermap with many
+		 * threads. 0: all threads fill the shared ownermap. */
+		u->ownermap_merge = atoi(optval);
 	}
 	else if (!strcasecmp(optname, "thread_model") && optval) {
 		if (!strcasecmp(optval, "tree")) {
@@ -1022,6 +1122,30 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 	else if (!strcasecmp(optname, "fast_alloc")) {  NEED_RESET
 		u->fast_alloc = !optval || atoi(optval);
 	}
+	else if (!strcasecmp(optname, "huge_pages") && optval) {  NEED_RESET
+		/* Back fast_alloc tree with huge pages to reduce TLB misses
+		 * during tree descent (linux only):
+		 *   thp       transparent huge pages (madvise)
+		 *   explicit  reserved huge pages (MAP_HUGETLB), needs
+		 *             /proc/sys/vm/nr_hugepages set. Falls back to thp.
+		 *   none      default */
+		u->tree_arena &= ~(TREE_ARENA_THP | TREE_ARENA_HUGETLB);
+		if      (!strcasecmp(optval, "thp"))       u->tree_arena |= TREE_ARENA_THP;
+		else if (!strcasecmp(optval, "explicit"))  u->tree_arena |= TREE_ARENA_HUGETLB;
+		else if (strcasecmp(optval, "none"))
+			option_error("UCT: Invalid huge_pages value %s\n", optval);
+	}
+	else if (!strcasecmp(optname, "numa") && optval) {  NEED_RESET
+		/* Numa placement of fast_alloc tree pages (linux only):
+		 *   local       pages go to the node of the thread which
+		 *               first touches them (default)
+		 *   interleave  spread pages over all nodes, so no node
+		 *               gets all the traffic */
+		if      (!strcasecmp(optval, "interleave"))  u->tree_arena |= TREE_ARENA_INTERLEAVE;
+		else if (!strcasecmp(optval, "local"))       u->tree_arena &= ~TREE_ARENA_INTERLEAVE;
+		else
+			option_error("UCT: Invalid numa value %s\n", optval);
+	}
 	else if (!strcasecmp(optname, "pruning_threshold") && optval) {  NEED_RESET
 		/* Force pruning at beginning of a move if the tree consumes
 		 * more than this [MiB]. Default is 10% of max_tree_size.
@@ -1029,6 +1153,16 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 		 * This option is meaningful only for fast_alloc. */
 		u->pruning_threshold = atol(optval) * 1048576;
 	}
+	else if (!strcasecmp(optname, "transpositions")) {  NEED_RESET
+		/* Share stats between positions reached through different
+		 * move orders using a transposition table of 2^N entries
+		 * (default 20 if no value given, 0 to disable). Stats for
+		 * a position already searched get merged into the prior of
+		 * nodes reaching it. See uct/ttable.h */
+		u->ttable_bits = optval ? atoi(optval) : 20;
+		if (u->ttable_bits && (u->ttable_bits < 2 || u->ttable_bits > 30))
+			option_error("UCT: Invalid transpositions %s\n", optval);
+	}
 	else if (!strcasecmp(optname, "reset_tree")) {
 		/* Reset tree before each genmove ?
 		 * Default is to reuse previous tree when not using dcnn. 
@@ -1042,6 +1176,28 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 		/* Keep searching even during opponent's turn. */
 		u->pondering_opt = !optval || atoi(optval);
 	}
+	else if (!strcasecmp(optname, "ponder_gc")) {
+		/* Garbage collect the tree while pondering when it grows
+		 * over pruning_threshold, instead of after opponent's move
+		 * on our time. Search pauses during collection.
+		 * Only for fast_alloc. */
+		u->ponder_gc = !optval || atoi(optval);
+	}
+	else if (!strcasecmp(optname, "dcnn_batch") && optval) {  NEED_RESET
+		/* Use dcnn for all nodes, not just the root: positions of new
+		 * nodes are evaluated asynchronously by a separate thread in
+		 * batches of this size, dcnn priors get merged when ready.
+		 * 0 (default) disables. See uct/dcnn_queue.h */
+		u->dcnn_batch = atoi(optval);
+		if (u->dcnn_batch < 0)
+			option_error("UCT: Invalid dcnn_batch %s\n", optval);
+	}
+	else if (!strcasecmp(optname, "dcnn_queue") && optval) {  NEED_RESET
+		/* Max positions waiting for async dcnn evaluation, new
+		 * nodes don't get dcnn priors beyond that.
+		 * Default is 16 * dcnn_batch. */
+		u->dcnn_queue_size = atoi(optval);
+	}
 	else if (!strcasecmp(optname, "dcnn_pondering_prior") && optval) {
 		/* Dcnn pondering: prior guesses for next move.
 		 * When pondering with dcnn we need to guess opponent's next move:
@@ -1070,7 +1226,8 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 	else if (!strcasecmp(optname, "best2_ratio") && optval) {
 		/* If set, prolong simulating while
 		 * first_best/second_best playouts ratio
-		 * is less than best2_ratio. */
+		 * is less than best2_ratio.
+		 * Not used with stop_confidence for walltime search. */
 		u->best2_ratio = atof(optval);
 	}
 	else if (!strcasecmp(optname, "bestr_ratio") && optval) {
@@ -1079,6 +1236,16 @@ uct_setoption(engine_t *e, board_t *b, const char *optname, char *optval,
 		 * is more than bestr_ratio. */
 		u->bestr_ratio = atof(optval);
 	}
+	else if (!strcasecmp(optname, "stop_confidence") && optval) {
+		/* Stop searching early once no other move can take over
+		 * best move with the remaining time: it is too far behind
+		 * in playouts, or its value upper confidence bound is below
+		 * best's lower bound. Bounds are Wilson score intervals
+		 * stop_confidence standard deviations wide, 0 disables.
+		 * Past desired time, keep searching up to worst time while
+		 * this doesn't hold (instead of best2_ratio). */
+		u->stop_confidence = atof(optval);
+	}
 	else if (!strcasecmp(optname, "max_maintime_ratio") && optval) {
 		/* If set and while not in byoyomi, prolong simulating no more than
 		 * max_maintime_ratio times the normal desired thinking time. */
@@ -1384,6 +1551,7 @@ uct_state_init(engine_t *e, board_t *b)
 	u->genmove_reset_tree = false;
 
 	u->threads = get_nprocessors();
+	u->ownermap_merge = 64;
 	u->thread_model = TM_TREEVL;
 	u->virtual_loss = 1;
 
@@ -1397,6 +1565,7 @@ uct_state_init(engine_t *e, board_t *b)
 	// 2.5 is clearly too much, but seems to compensate well for overly stern time allocations.
 	// TODO: Further tuning and experiments with better time allocation schemes.
 	u->best2_ratio = 2.5;
+	u->stop_confidence = 3.0;
 	// Higher values of max_maintime_ratio sometimes cause severe time trouble in tournaments
 	// It might be necessary to reduce it to 1.5 on large board, but more tuning is needed.
 	u->max_maintime_ratio = 2.0;
@@ -1469,8 +1638,15 @@ uct_state_init(engine_t *e, board_t *b)
 	}
 
 	if (!u->dynkomi)		u->dynkomi = uct_dynkomi_init_linear(u, NULL, b);
+	if (u->ttable_bits)		u->ttable = ttable_init(u->ttable_bits);
+	if (u->dcnn_batch && using_dcnn(b)) {
+		if (u->dcnn_queue_size < u->dcnn_batch)  u->dcnn_queue_size = 16 * u->dcnn_batch;
+		u->dcnn_queue = dcnn_queue_init(b, u->dcnn_batch, u->dcnn_queue_size, u->prior->dcnn_eqex);
+	}
 	if (!u->banner)                 u->banner = strdup("Pachi %s, Have a nice game !");
 
+	uct_pool_init(u);
+
 	/* Some things remain uninitialized for now - the opening tbook
 	 * is not loaded and the tree not set up. */
 	/* This will be initialized in setup_state() at the first move
@@ -5,6 +5,13 @@
 
 void engine_uct_init(engine_t *e, board_t *b);
 
+/* Last search time in uct_playout() and in leaf playouts (time_tree
+ * option, ticks_now() units, all threads). */
+void uct_walk_ticks(engine_t *e, uint64_t *walk, uint64_t *playouts);
+
+/* uct_pass_is_safe() with a fresh ownermap, for tests. */
+bool uct_engine_pass_is_safe(engine_t *e, board_t *b, enum stone color, bool pass_all_alive, char **msg);
+
 bool uct_gentbook(engine_t *e, board_t *b, time_info_t *ti, enum stone color);
 void uct_dumptbook(engine_t *e, board_t *b, enum stone color);
 
@@ -14,6 +14,7 @@
 #include "playout.h"
 #include "random.h"
 #include "tactics/util.h"
+#include "timeinfo.h"
 #include "uct/dynkomi.h"
 #include "uct/internal.h"
 #include "uct/search.h"
@@ -40,7 +41,7 @@ uct_progress_text(FILE *fh, uct_t *u, tree_t *t, enum stone color, int playouts)
 		return;
 	}
 	fprintf(fh, "[%d] ", playouts);
-	fprintf(fh, "best %.1f%% ", 100 * tree_node_get_value(t, 1, best->u.value));
+	fprintf(fh, "best %.1f%% ", 100 * tree_node_get_value(t, 1, node_u(best).value));
 
 	/* Dynamic komi */
 	if (t->use_extra_komi)
@@ -49,7 +50,7 @@ uct_progress_text(FILE *fh, uct_t *u, tree_t *t, enum stone color, int playouts)
 	/* Best sequence */
 	fprintf(fh, "| seq ");
 	for (int depth = 0; depth < 4; depth++) {
-		if (best && best->u.playouts >= 25) {
+		if (best && node_u(best).playouts >= 25) {
 			fprintf(fh, "%3s ", coord2sstr(node_coord(best)));
 			best = u->policy->choose(u->policy, best, b, color, resign);
 		}
@@ -111,7 +112,7 @@ uct_progress_lz(FILE *fh, uct_t *u, tree_t *t, enum stone color)
 		tree_node_t *n = tree_get_node(node, best_c[i]);
 		while (1) {
 			n = u->policy->choose(u->policy, n, b, color, resign);
-			if (!n || n->u.playouts < 100) break;
+			if (!n || node_u(n).playouts < 100) break;
 			fprintf(fh, "%s ", coord2sstr(node_coord(n)));
 		}
 	}
@@ -129,7 +130,7 @@ uct_progress_gogui_sequence(uct_t *u, tree_t *t, enum stone color, int playouts)
 	tree_node_t *best = u->policy->choose(u->policy, t->root, t->board, color, resign);
 	if (!best) {  fprintf(stderr, "... No moves left\n"); return;  }
 	
-	for (int i = 0; i < n && best && best->u.playouts >= 50; i++) {
+	for (int i = 0; i < n && best && node_u(best).playouts >= 50; i++) {
 		seq[i] = node_coord(best);
 		best = u->policy->choose(u->policy, best, t->board, color, resign);
 	}
@@ -180,7 +181,7 @@ uct_progress_json(FILE *fh, uct_t *u, tree_t *t, enum stone color, int playouts,
 			/* Best move */
 			fprintf(fh, ", \"best\": {\"%s\": %f}",
 				coord2sstr(best->coord),
-				tree_node_get_value(t, 1, best->u.value));
+				tree_node_get_value(t, 1, node_u(best).value));
 		}
 	}
 
@@ -191,7 +192,7 @@ uct_progress_json(FILE *fh, uct_t *u, tree_t *t, enum stone color, int playouts,
 	tree_node_t *best = t->root->children;
 	while (best) {        /* XXX clean this up, use uct_get_best_moves() instead */
 		int c = 0;
-		while ((!can[c] || best->u.playouts > can[c]->u.playouts) && ++c < cans);
+		while ((!can[c] || node_u(best).playouts > node_u(can[c]).playouts) && ++c < cans);
 		for (int d = 0; d < c; d++) can[d] = can[d + 1];
 		if (c > 0) can[c - 1] = best;
 		best = best->sibling;
@@ -203,11 +204,11 @@ uct_progress_json(FILE *fh, uct_t *u, tree_t *t, enum stone color, int playouts,
 		fprintf(fh, "[");
 		best = can[cans];
 		for (int depth = 0; depth < 20; depth++) {
-			if (!best || best->u.playouts < 1) break;
+			if (!best || node_u(best).playouts < 1) break;
 			fprintf(fh, "%s{\"%s\": [%.3f, %i]}", depth > 0 ? "," : "",
 				coord2sstr(best->coord),
-				tree_node_get_value(t, 1, best->u.value),
-				best->u.playouts);
+				tree_node_get_value(t, 1, node_u(best).value),
+				node_u(best).playouts);
 			best = u->policy->choose(u->policy, best, t->board, color, resign);
 		}
 		fprintf(fh, "]%s", cans > 0 ? ", " : "");
@@ -292,7 +293,7 @@ typedef struct {
 
 static int
 uct_leaf_node(uct_t *u, board_t *b, enum stone player_color,
-              playout_amafmap_t *amaf,
+              playout_amafmap_t *amaf, ownermap_t *ownermap,
 	      uct_descent_t *descent, int *dlen,
 	      tree_node_t *significant[2],
               tree_t *t, tree_node_t *n, enum stone node_color,
@@ -303,13 +304,13 @@ uct_leaf_node(uct_t *u, board_t *b, enum stone player_color,
 
 	if (UDEBUGL(7))
 		fprintf(stderr, "%s*-- UCT playout #%d start [%s] %f\n",
-			spaces, n->u.playouts, coord2sstr(node_coord(n)),
-			tree_node_get_value(t, -parity, n->u.value));
+			spaces, node_u(n).playouts, coord2sstr(node_coord(n)),
+			tree_node_get_value(t, -parity, node_u(n).value));
 
-	playout_setup_t ps = playout_setup(u->gamelen, u->mercymin);
+	playout_setup_t ps = playout_setup(u->gamelen, u->mercymin, u->playout_cycles);
 	int result = playout_play_game(&ps, b, next_color,
 				       u->playout_amaf ? amaf : NULL,
-				       &u->ownermap, u->playout);
+				       ownermap, u->playout);
 	if (next_color == S_WHITE) {
 		/* We need the result from black's perspective. */
 		result = - result;
@@ -336,7 +337,7 @@ scale_value(uct_t *u, board_t *b, enum stone node_color, tree_node_t *significan
 		if (u->val_bytemp) {
 			/* xvalue is 0 at 0.5, 1 at 0 or 1 */
 			/* No correction for parity necessary. */
-			double xvalue = significant[node_color - 1] ? fabs(significant[node_color - 1]->u.value - 0.5) * 2 : 0;
+			double xvalue = significant[node_color - 1] ? fabs(node_u(significant[node_color - 1]).value - 0.5) * 2 : 0;
 			scale = u->val_bytemp_min + (u->val_scale - u->val_bytemp_min) * xvalue;
 		}
 
@@ -395,7 +396,7 @@ record_local_sequence(uct_t *u, tree_t *t, board_t *endb,
 
 	/* Pick the right local tree root... */
 	tree_node_t *lnode = seq_color == S_BLACK ? t->ltree_black : t->ltree_white;
-	lnode->u.playouts++;
+	node_u(lnode).playouts++;
 
 	/* ...determine the sequence value... */
 	double sval = 0.5;
@@ -435,7 +436,7 @@ record_local_sequence(uct_t *u, tree_t *t, board_t *endb,
 			stone2str(color), rval, descent[di].node->d);
 		lnode = tree_get_node2(t, lnode, node_coord(descent[di++].node), true);
 		assert(lnode);
-		stats_add_result(&lnode->u, rval, pval);
+		stats_add_result(&node_u(lnode), rval, pval);
 	}
 
 	/* Add lnode for tenuki (pass) if we descended further. */
@@ -444,14 +445,15 @@ record_local_sequence(uct_t *u, tree_t *t, board_t *endb,
 		LTREE_DEBUG fprintf(stderr, "pass ");
 		lnode = tree_get_node2(t, lnode, pass, true);
 		assert(lnode);
-		stats_add_result(&lnode->u, rval, pval);
+		stats_add_result(&node_u(lnode), rval, pval);
 	}
 	
 	LTREE_DEBUG fprintf(stderr, "\n");
 }
 
 static tree_node_t *
-uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color, tree_t *t, int *presult)
+uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color, tree_t *t,
+		    ownermap_t *ownermap, int *presult)
 {
 	playout_amafmap_t amaf;
 	amaf.gamelen = amaf.game_baselen = 0;
@@ -479,9 +481,13 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 	 * with higher than configured number of playouts). For black
 	 * and white. */
 	tree_node_t *significant[2] = { NULL, NULL };
-	if (n->u.playouts >= u->significant_threshold)
+	if (node_u(n).playouts >= u->significant_threshold)
 		significant[node_color - 1] = n;
 
+	/* Positions reached along the descent, for the transposition table. */
+	hash_t tt_keys[DESCENT_DLEN];
+	int tt_len = 0;
+
 	int result;
 	int pass_limit = board_rsize(b2) * board_rsize(b2) / 2;
 	int passes = is_pass(last_move(b).coord) && b->moves > 0;
@@ -490,7 +496,7 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 	static char spaces[] = "\0                                                      ";
 	/* /debug */
 	if (UDEBUGL(8))
-		fprintf(stderr, "--- (#%d) UCT walk with color %d\n", t->root->u.playouts, player_color);
+		fprintf(stderr, "--- (#%d) UCT walk with color %d\n", node_u(t->root).playouts, player_color);
 
 	while (!tree_leaf_node(n) && passes < 2) {
 		spaces[dlen - 1] = ' '; spaces[dlen] = 0;
@@ -520,7 +526,7 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 
 		/*** Perform the descent: */
 
-		if (descent[dlen].node->u.playouts >= u->significant_threshold)
+		if (node_u(descent[dlen].node).playouts >= u->significant_threshold)
 			significant[node_color - 1] = descent[dlen].node;
 
 		seq_value.playouts += descent[dlen].value.playouts;
@@ -530,8 +536,8 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 		if (UDEBUGL(7))
 			fprintf(stderr, "%s+-- UCT sent us to [%s:%d] %d,%f\n",
 			        spaces, coord2sstr(node_coord(n)),
-				node_coord(n), n->u.playouts,
-				tree_node_get_value(t, parity, n->u.value));
+				node_coord(n), node_u(n).playouts,
+				tree_node_get_value(t, parity, node_u(n).value));
 
 		if (u->virtual_loss)
 			__sync_fetch_and_add(&n->descents, u->virtual_loss);
@@ -543,7 +549,7 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 		    || b2->superko_violation) {
 			if (UDEBUGL(4)) {
 				for (tree_node_t *ni = n; ni; ni = ni->parent)
-					fprintf(stderr, "%s<%" PRIhash "> ", coord2sstr(node_coord(ni)), ni->hash);
+					fprintf(stderr, "%s<%p> ", coord2sstr(node_coord(ni)), ni);
 				fprintf(stderr, "marking invalid %s node %d,%d res %d group %d spk %d\n",
 				        stone2str(node_color), coord_x(node_coord(n)), coord_y(node_coord(n)),
 					res, group_at(b2, m.coord), b2->superko_violation);
@@ -560,6 +566,12 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 		else                         passes = 0;
 
 		enum stone next_color = stone_other(node_color);
+		if (u->ttable) {
+			hash_t key = tt_keys[tt_len++] = ttable_key(b2, next_color);
+			if (!node_u(n).playouts
+			    && !(__sync_fetch_and_or(&n->hints, TREE_HINT_TTABLE) & TREE_HINT_TTABLE))
+				ttable_node_enter(u->ttable, n, key);
+		}
 		/* We need to make sure only one thread expands the node. If
 		 * we are unlucky enough for two threads to meet in the same
 		 * node, the latter one will simply do another simulation from
@@ -568,7 +580,7 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 		 * The size test must be before the test&set not after, to allow
 		 * expansion of the node later if enough nodes have been freed. */
 		if (tree_leaf_node(n)
-		    && n->u.playouts - u->virtual_loss >= u->expand_p && t->nodes_size < u->max_tree_size
+		    && node_u(n).playouts - u->virtual_loss >= u->expand_p && t->nodes_size < u->max_tree_size
 		    && !__sync_lock_test_and_set(&n->is_expanded, 1))
 			tree_expand_node(t, n, b2, next_color, u, -parity);
 	}
@@ -587,7 +599,10 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 	// assert(tree_leaf_node(n));
 	/* In case of parallel tree search, the assertion might
 	 * not hold if two threads chew on the same node. */
-	result = uct_leaf_node(u, b2, player_color, &amaf, descent, &dlen, significant, t, n, node_color, spaces);
+	uint64_t leaf_start = (u->time_tree ? ticks_now() : 0);
+	result = uct_leaf_node(u, b2, player_color, &amaf, ownermap, descent, &dlen, significant, t, n, node_color, spaces);
+	if (u->time_tree)
+		__sync_fetch_and_add(&u->playout_ticks, ticks_now() - leaf_start);
 
 	if (u->policy->wants_amaf && u->playout_amaf_cutoff) {
 		unsigned int cutoff = amaf.game_baselen;
@@ -600,6 +615,8 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 	assert(n == t->root || n->parent);
 	floating_t rval = scale_value(u, b, node_color, significant, result);
 	u->policy->update(u->policy, t, n, node_color, player_color, &amaf, b2, rval);
+	for (int i = 0; i < tt_len; i++)
+		ttable_update(u->ttable, tt_keys[i], rval);
 
 	stats_add_result(&t->avg_score, (float)result / 2, 1);
 	if (t->use_extra_komi) {
@@ -642,13 +659,14 @@ uct_playout_descent(uct_t *u, board_t *b, board_t *b2, enum stone player_color,
 }
 
 int
-uct_playout(uct_t *u, board_t *b, enum stone player_color, tree_t *t)
+uct_playout(uct_t *u, board_t *b, enum stone player_color, tree_t *t, ownermap_t *ownermap)
 {
+	uint64_t walk_start = (u->time_tree ? ticks_now() : 0);
 	board_t b2;
-	board_copy(&b2, b);
+	board_copy_live(&b2, b);
 	
 	int result;
-	tree_node_t *n = uct_playout_descent(u, b, &b2, player_color, t, &result);
+	tree_node_t *n = uct_playout_descent(u, b, &b2, player_color, t, ownermap, &result);
 	
 	/* We need to undo the virtual loss we added during descend. */
 	if (u->virtual_loss) {
@@ -658,14 +676,27 @@ uct_playout(uct_t *u, board_t *b, enum stone player_color, tree_t *t)
 	}
 
 	board_done(&b2);
+	if (u->time_tree)
+		__sync_fetch_and_add(&u->walk_ticks, ticks_now() - walk_start);
 	return result;
 }
 
 int
-uct_playouts(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti)
+uct_playouts(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti, ownermap_t *ownermap)
 {
+	if (!ownermap) {
+		int i;
+		for (i = 0; !uct_halt; i++)
+			uct_playout(u, b, color, t, &u->ownermap);
+		return i;
+	}
+
 	int i;
-	for (i = 0; !uct_halt; i++)
-		uct_playout(u, b, color, t);
+	for (i = 0; !uct_halt; i++) {
+		uct_playout(u, b, color, t, ownermap);
+		if (ownermap->playouts >= u->ownermap_merge)
+			ownermap_merge(b, &u->ownermap, ownermap);
+	}
+	ownermap_merge(b, &u->ownermap, ownermap);
 	return i;
 }
@@ -5,7 +5,9 @@
 
 void uct_progress_status(uct_t *u, tree_t *t, enum stone color, int playouts, coord_t *final);
 
-int uct_playout(uct_t *u, board_t *b, enum stone player_color, tree_t *t);
-int uct_playouts(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti);
+int uct_playout(uct_t *u, board_t *b, enum stone player_color, tree_t *t, ownermap_t *ownermap);
+/* Playouts until uct_halt. If @ownermap is given playouts fill it and it gets
+ * merged into u->ownermap every u->ownermap_merge playouts and at the end. */
+int uct_playouts(uct_t *u, board_t *b, enum stone color, tree_t *t, time_info_t *ti, ownermap_t *ownermap);
 
 #endif